@@ -0,0 +1,29 @@
+#include "alloc_counter.h"
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local size_t global_new_count = 0;
+
+}  // namespace
+
+size_t GetThreadNewCount() {
+    return global_new_count;
+}
+
+void* operator new(size_t size) {
+    ++global_new_count;
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
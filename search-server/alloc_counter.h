@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+
+// Вызовы глобального operator new в текущем потоке: по ним видно, ходит ли код в общую кучу.
+// Считает замена operator new из alloc_counter.cpp. Она действует на весь исполняемый файл, поэтому
+// alloc_counter.cpp компонуется только в замеры и тесты, а не в библиотеку.
+size_t GetThreadNewCount();
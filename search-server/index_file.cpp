@@ -0,0 +1,231 @@
+#include "index_file.h"
+#include <fstream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SEARCH_SERVER_HAS_MMAP 1
+#endif
+
+uint64_t ComputeChecksum(std::string_view data, uint64_t hash) {
+    for (const char c : data) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void BinaryWriter::WriteString(std::string_view text) {
+    Write(static_cast<uint32_t>(text.size()));
+    buffer_.append(text);
+}
+
+void BinaryWriter::Align() {
+    buffer_.append((INDEX_FILE_ALIGNMENT - buffer_.size() % INDEX_FILE_ALIGNMENT) % INDEX_FILE_ALIGNMENT, '\0');
+}
+
+const std::string& BinaryWriter::GetBuffer() const {
+    return buffer_;
+}
+
+BinaryReader::BinaryReader(std::string_view data) : data_(data) {
+}
+
+std::string_view BinaryReader::ReadString() {
+    const auto size = Read<uint32_t>();
+    return {Take(size), size};
+}
+
+void BinaryReader::Align() {
+    Take((INDEX_FILE_ALIGNMENT - offset_ % INDEX_FILE_ALIGNMENT) % INDEX_FILE_ALIGNMENT);
+}
+
+bool BinaryReader::AtEnd() const {
+    return data_.empty();
+}
+
+const char* BinaryReader::Take(size_t size) {
+    if (size > data_.size()) {
+        throw std::runtime_error("index file is truncated");
+    }
+    const char* result = data_.data();
+    data_.remove_prefix(size);
+    offset_ += size;
+    return result;
+}
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef SEARCH_SERVER_HAS_MMAP
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open index file " + path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+        void* mapping = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            mapping_ = mapping;
+            mapping_size_ = static_cast<size_t>(file_stat.st_size);
+        }
+    }
+    close(fd);
+    if (mapping_ != nullptr) {
+        return;
+    }
+#endif
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("cannot open index file " + path);
+    }
+    buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+MappedFile::~MappedFile() {
+#ifdef SEARCH_SERVER_HAS_MMAP
+    if (mapping_ != nullptr) {
+        munmap(mapping_, mapping_size_);
+    }
+#endif
+}
+
+std::string_view MappedFile::GetData() const {
+    if (mapping_ != nullptr) {
+        return { static_cast<const char*>(mapping_), mapping_size_ };
+    }
+    return buffer_;
+}
+
+IndexFileWriter::IndexFileWriter(const std::string& path)
+    : path_(path)
+    , temp_path_(path + ".tmp") {
+    file_ = std::fopen(temp_path_.c_str(), "wb");
+    if (file_ == nullptr) {
+        throw std::runtime_error("cannot write index file " + path_);
+    }
+    // Место под заголовок: он известен только после всех данных
+    const IndexFileHeader header{};
+    if (std::fwrite(&header, sizeof(header), 1, file_) != 1) {
+        ThrowWriteError();
+    }
+    buffer_.reserve(BUFFER_SIZE);
+}
+
+IndexFileWriter::~IndexFileWriter() {
+    if (file_ != nullptr) {
+        std::fclose(file_);
+        std::remove(temp_path_.c_str());
+    }
+}
+
+void IndexFileWriter::WriteString(std::string_view text) {
+    Write(static_cast<uint32_t>(text.size()));
+    WriteBytes(text);
+}
+
+void IndexFileWriter::WriteBytes(std::string_view data) {
+    checksum_ = ComputeChecksum(data, checksum_);
+    payload_size_ += data.size();
+    if (buffer_.size() + data.size() <= BUFFER_SIZE) {
+        buffer_.append(data);
+        return;
+    }
+    // Большой массив пишется мимо буфера
+    Flush();
+    if (data.size() >= BUFFER_SIZE) {
+        if (std::fwrite(data.data(), 1, data.size(), file_) != data.size()) {
+            ThrowWriteError();
+        }
+    }
+    else {
+        buffer_.append(data);
+    }
+}
+
+void IndexFileWriter::Align() {
+    const char zeros[INDEX_FILE_ALIGNMENT] = {};
+    WriteBytes({zeros, (INDEX_FILE_ALIGNMENT - payload_size_ % INDEX_FILE_ALIGNMENT) % INDEX_FILE_ALIGNMENT});
+}
+
+void IndexFileWriter::Commit() {
+    Flush();
+    IndexFileHeader header{};
+    std::memcpy(header.magic, INDEX_FILE_MAGIC, sizeof(header.magic));
+    header.version = INDEX_FILE_VERSION;
+    header.payload_size = payload_size_;
+    header.checksum = checksum_;
+    if (std::fseek(file_, 0, SEEK_SET) != 0 || std::fwrite(&header, sizeof(header), 1, file_) != 1
+        || std::fflush(file_) != 0) {
+        ThrowWriteError();
+    }
+#ifdef SEARCH_SERVER_HAS_MMAP
+    if (fsync(fileno(file_)) != 0) {
+        ThrowWriteError();
+    }
+#endif
+    const int close_result = std::fclose(file_);
+    file_ = nullptr;
+    if (close_result != 0) {
+        std::remove(temp_path_.c_str());
+        ThrowWriteError();
+    }
+#ifndef SEARCH_SERVER_HAS_MMAP
+    // rename вне POSIX не заменяет существующий файл
+    std::remove(path_.c_str());
+#endif
+    if (std::rename(temp_path_.c_str(), path_.c_str()) != 0) {
+        std::remove(temp_path_.c_str());
+        ThrowWriteError();
+    }
+#ifdef SEARCH_SERVER_HAS_MMAP
+    // Переименование попадает на диск вместе с каталогом
+    const size_t slash = path_.rfind('/');
+    const std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path_.substr(0, slash);
+    const int directory_fd = open(directory.c_str(), O_RDONLY);
+    if (directory_fd >= 0) {
+        fsync(directory_fd);
+        close(directory_fd);
+    }
+#endif
+}
+
+void IndexFileWriter::Flush() {
+    if (!buffer_.empty() && std::fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size()) {
+        ThrowWriteError();
+    }
+    buffer_.clear();
+}
+
+void IndexFileWriter::ThrowWriteError() const {
+    throw std::runtime_error("cannot write index file " + path_);
+}
+
+void WriteIndexFile(const std::string& path, std::string_view payload) {
+    IndexFileWriter writer(path);
+    writer.WriteBytes(payload);
+    writer.Commit();
+}
+
+std::string_view CheckIndexFile(std::string_view file_data, bool verify_checksum) {
+    IndexFileHeader header;
+    if (file_data.size() < sizeof(header)) {
+        throw std::runtime_error("index file is truncated");
+    }
+    std::memcpy(&header, file_data.data(), sizeof(header));
+    if (std::memcmp(header.magic, INDEX_FILE_MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("not a search server index file");
+    }
+    if (header.version != INDEX_FILE_VERSION) {
+        throw std::runtime_error("unsupported index file version " + std::to_string(header.version));
+    }
+    const std::string_view payload = file_data.substr(sizeof(header));
+    if (payload.size() != header.payload_size) {
+        throw std::runtime_error("index file size does not match its header");
+    }
+    if (verify_checksum && ComputeChecksum(payload) != header.checksum) {
+        throw std::runtime_error("index file checksum mismatch");
+    }
+    return payload;
+}
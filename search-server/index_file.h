@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Формат файла индекса: заголовок IndexFileHeader, за ним данные длиной payload_size.
+// Числа записываются в порядке байт машины (little-endian на x86/ARM).
+// Версия 2: настройки поиска и номера документов вместо id в списках вхождений.
+// Версия 3: массивы выровнены по INDEX_FILE_ALIGNMENT от начала данных (заголовок кратен ему), поэтому
+// списки вхождений читаются прямо из отображенного файла; у каждого списка записан наибольший TF.
+const char INDEX_FILE_MAGIC[8] = {'S', 'R', 'C', 'H', 'I', 'D', 'X', '\0'};
+const uint32_t INDEX_FILE_VERSION = 3;
+const size_t INDEX_FILE_ALIGNMENT = 8;
+
+struct IndexFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t payload_size;
+    uint64_t checksum;  // FNV-1a по данным
+};
+static_assert(sizeof(IndexFileHeader) % INDEX_FILE_ALIGNMENT == 0);
+
+const uint64_t CHECKSUM_SEED = 14695981039346656037ULL;
+
+// FNV-1a. Данные можно считать по частям: hash - сумма предыдущих частей.
+uint64_t ComputeChecksum(std::string_view data, uint64_t hash = CHECKSUM_SEED);
+
+// Последовательная запись значений в буфер
+class BinaryWriter {
+public:
+    template <typename T>
+    void Write(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        buffer_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    // Массив пишется целиком, без длины
+    template <typename T>
+    void WriteArray(const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        buffer_.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    void WriteString(std::string_view text);
+
+    // Дополняет данные нулями до кратной INDEX_FILE_ALIGNMENT длины
+    void Align();
+
+    const std::string& GetBuffer() const;
+
+private:
+    std::string buffer_;
+};
+
+// Последовательное чтение значений из буфера. При выходе за конец бросает std::runtime_error.
+class BinaryReader {
+public:
+    explicit BinaryReader(std::string_view data);
+
+    template <typename T>
+    T Read() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value;
+        std::memcpy(&value, Take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    std::vector<T> ReadArray(size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (count > data_.size() / sizeof(T)) {
+            throw std::runtime_error("index file is truncated");
+        }
+        std::vector<T> values(count);
+        std::memcpy(values.data(), Take(count * sizeof(T)), count * sizeof(T));
+        return values;
+    }
+
+    // Массив без копии: указатель в данные, которые должны жить дольше него. Массив должен быть выровнен.
+    template <typename T>
+    const T* ReadArrayInPlace(size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (count > data_.size() / sizeof(T)) {
+            throw std::runtime_error("index file is truncated");
+        }
+        if (reinterpret_cast<uintptr_t>(data_.data()) % alignof(T) != 0) {
+            throw std::runtime_error("misaligned array in index file");
+        }
+        return reinterpret_cast<const T*>(Take(count * sizeof(T)));
+    }
+
+    std::string_view ReadString();
+
+    // Пропускает дополнение до кратной INDEX_FILE_ALIGNMENT длины прочитанного
+    void Align();
+
+    bool AtEnd() const;
+
+private:
+    const char* Take(size_t size);
+
+    std::string_view data_;
+    size_t offset_ = 0;  // прочитано байт
+};
+
+// Файл только для чтения, отображенный в память (mmap): страницы подгружаются при обращении, без копии в куче.
+// Отображение живет, пока жив объект, поэтому из него можно читать все время работы сервера.
+// Где отображение недоступно (не POSIX, пустой файл, отказ mmap), файл читается в буфер целиком.
+// Ошибка открытия - std::runtime_error.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view GetData() const;
+
+private:
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    std::string buffer_;
+};
+
+// Потоковая запись файла индекса без копии всех данных в памяти. Данные пишутся во временный файл path + ".tmp"
+// с подсчетом контрольной суммы по ходу записи, Commit дописывает заголовок в начало, сбрасывает файл на диск
+// и переименовывает его в path. Файл path поэтому всегда либо прежний, либо новый целиком, а сервер,
+// отобразивший прежний файл в память, продолжает читать его страницы. Без Commit временный файл удаляется.
+// Ошибки ввода-вывода - std::runtime_error.
+class IndexFileWriter {
+public:
+    explicit IndexFileWriter(const std::string& path);
+    ~IndexFileWriter();
+
+    IndexFileWriter(const IndexFileWriter&) = delete;
+    IndexFileWriter& operator=(const IndexFileWriter&) = delete;
+
+    template <typename T>
+    void Write(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        WriteBytes({reinterpret_cast<const char*>(&value), sizeof(T)});
+    }
+
+    // Массив пишется целиком, без длины
+    template <typename T>
+    void WriteArray(const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        WriteBytes({reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T)});
+    }
+
+    void WriteString(std::string_view text);
+
+    void WriteBytes(std::string_view data);
+
+    // Дополняет данные нулями до кратной INDEX_FILE_ALIGNMENT длины
+    void Align();
+
+    void Commit();
+
+private:
+    void Flush();
+    [[noreturn]] void ThrowWriteError() const;
+
+    static const size_t BUFFER_SIZE = 1 << 20;
+
+    std::string path_;
+    std::string temp_path_;
+    std::FILE* file_ = nullptr;
+    std::string buffer_;
+    uint64_t payload_size_ = 0;
+    uint64_t checksum_ = CHECKSUM_SEED;
+};
+
+// Записывает заголовок с контрольной суммой и данные в файл (через IndexFileWriter)
+void WriteIndexFile(const std::string& path, std::string_view payload);
+
+// Проверяет заголовок, версию, размер и (если verify_checksum) контрольную сумму содержимого файла индекса.
+// Без контрольной суммы данные не читаются. Возвращает данные без заголовка (ссылку в file_data).
+std::string_view CheckIndexFile(std::string_view file_data, bool verify_checksum = true);
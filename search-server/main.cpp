@@ -1,3 +1,4 @@
+#include <cstdlib>
 #include "document.h"
 #include "paginator.h"
 #include "read_input_functions.h"
@@ -27,6 +28,10 @@ int main() {
     // первый запрос удален, 1437 запросов с нулевым результатом
     request_queue.AddFindRequest("sparrow"s);
     cout << "Total empty requests: "s << request_queue.GetNoResultRequests() << endl;
+    cout << "Empty result rate: "s << request_queue.GetNoResultRate()
+         << ", p50 latency: "s << request_queue.GetLatencyPercentile(0.5).count() << " ns"s
+         << ", p99 latency: "s << request_queue.GetLatencyPercentile(0.99).count() << " ns"s
+         << ", QPS: "s << request_queue.GetQueriesPerSecond() << endl;
 
     auto test_docs = search_server.FindTopDocuments("dog"s);
     PrintDocument(test_docs);
@@ -41,6 +46,8 @@ int main() {
         cout << "Page break"s << endl;
     }
 
+#ifdef _WIN32
     system("pause");
+#endif
     return 0;
 }
\ No newline at end of file
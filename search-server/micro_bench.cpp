@@ -0,0 +1,761 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <sstream>
+#include <thread>
+#include "alloc_counter.h"
+#include "document.h"
+#include "log_duration.h"
+#include "paginator.h"
+#include "posting_set_operations.h"
+#include "process_queries.h"
+#include "query_arena.h"
+#include "query_cache.h"
+#include "query_stats.h"
+#include "read_input_functions.h"
+#include "request_queue.h"
+#include "search_server.h"
+#include "segmented_search_server.h"
+#include "snapshot_search_server.h"
+#include "string_processing.h"
+#include "term_dictionary.h"
+
+using namespace std;
+
+string GenerateWord(mt19937& generator, int max_length) {
+    const int length = uniform_int_distribution(1, max_length)(generator);
+    string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.push_back(uniform_int_distribution('a', 'z')(generator));
+    }
+    return word;
+}
+
+vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
+    vector<string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int max_word_count) {
+    const int word_count = uniform_int_distribution(1, max_word_count)(generator);
+    string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (!query.empty()) {
+            query.push_back(' ');
+        }
+        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
+    }
+    return query;
+}
+
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
+    }
+    return queries;
+}
+
+// Сравнение пакетной обработки запросов с последовательным циклом по FindTopDocuments
+void BenchmarkProcessQueries() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 2'000, 25);
+    const auto documents = GenerateQueries(generator, dictionary, 20'000, 10);
+
+    SearchServer search_server(dictionary[0]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    const auto queries = GenerateQueries(generator, dictionary, 2'000, 7);
+
+    size_t serial_count = 0;
+    {
+        LOG_DURATION("Serial FindTopDocuments loop"s);
+        for (const string& query : queries) {
+            serial_count += search_server.FindTopDocuments(query).size();
+        }
+    }
+    size_t joined_count = 0;
+    {
+        LOG_DURATION("ProcessQueriesJoined"s);
+        for ([[maybe_unused]] const Document& document : ProcessQueriesJoined(search_server, queries)) {
+            ++joined_count;
+        }
+    }
+    cout << "Documents found: "s << serial_count << " / "s << joined_count << endl;
+}
+
+// Отбор K лучших документов против полной сортировки (K = число документов) на широких запросах
+void BenchmarkTopDocumentCount() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 100, 5);
+    const auto documents = GenerateQueries(generator, dictionary, 50'000, 20);
+
+    SearchServer search_server;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    const auto queries = GenerateQueries(generator, dictionary, 50, 5);
+
+    for (const size_t count : {size_t{5}, size_t{100}, size_t{1000}, documents.size()}) {
+        search_server.SetMaxResultDocumentCount(count);
+        LOG_DURATION("FindTopDocuments, K = "s + to_string(count));
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(query);
+        }
+    }
+}
+
+// Задержка коротких запросов по редким словам: здесь заметна стоимость разбора запроса и расчета IDF
+void BenchmarkShortQueries() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 50'000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 20'000, 10);
+
+    SearchServer search_server;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    const auto queries = GenerateQueries(generator, dictionary, 200'000, 3);
+
+    size_t found = 0;
+    LogDuration guard("Short queries x "s + to_string(queries.size()));
+    for (const string& query : queries) {
+        found += search_server.FindTopDocuments(query).size();
+    }
+    cout << "Short queries found: "s << found << endl;
+}
+
+// Скорость чтения из нескольких потоков, пока писатель добавляет документы с постоянной частотой
+void BenchmarkSnapshotReads() {
+    using namespace std::chrono;
+
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 5'000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 20'000, 10);
+    const auto queries = GenerateQueries(generator, dictionary, 1'000, 3);
+
+    SnapshotSearchServer search_server;
+    const int initial_count = 10'000;
+    for (int i = 0; i < initial_count; ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    search_server.Publish();
+
+    const auto duration = 1s;
+    const int documents_per_publish = 100;
+    const auto publish_interval = 20ms;  // 5000 документов в секунду
+    atomic_bool stop = false;
+    atomic_size_t query_count = 0;
+
+    thread writer([&] {
+        int document_id = initial_count;
+        while (!stop && document_id + documents_per_publish <= static_cast<int>(documents.size())) {
+            const auto next_publish = steady_clock::now() + publish_interval;
+            for (int i = 0; i < documents_per_publish; ++i, ++document_id) {
+                search_server.AddDocument(document_id, documents[document_id], DocumentStatus::ACTUAL, {1, 2, 3});
+            }
+            search_server.Publish();
+            this_thread::sleep_until(next_publish);
+        }
+    });
+    vector<thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&, i] {
+            for (size_t query = i; !stop; query = (query + 1) % queries.size()) {
+                search_server.FindTopDocuments(queries[query]);
+                ++query_count;
+            }
+        });
+    }
+    this_thread::sleep_for(duration);
+    stop = true;
+    writer.join();
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    cout << "Snapshot reads while ingesting: "s << query_count / duration_cast<seconds>(duration).count()
+         << " QPS, documents: "s << search_server.GetDocumentCount() << endl;
+}
+
+// Время старта в зависимости от размера корпуса: разбор всех документов через AddDocument против загрузки
+// сохраненного индекса с полной проверкой и без нее. Без проверки списки вхождений не читаются при загрузке,
+// и время должно расти только с числом документов и слов, а не с объемом списков; первый поиск подгружает
+// страницы своих списков. Файл после SaveIndex уже в кеше страниц, поэтому время чтения с диска не входит.
+void BenchmarkIndexStartup() {
+    using namespace std::chrono;
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    const auto queries = GenerateQueries(generator, dictionary, 100, 3);
+    const string path = (filesystem::temp_directory_path() / "search_server_benchmark.idx"s).string();
+    const auto milliseconds_since = [](steady_clock::time_point start_time) {
+        return duration_cast<microseconds>(steady_clock::now() - start_time).count() / 1000.0;
+    };
+
+    for (const int document_count : {12'500, 50'000, 200'000}) {
+        const auto documents = GenerateQueries(generator, dictionary, document_count, 20);
+        auto start_time = steady_clock::now();
+        {
+            SearchServer search_server;
+            for (size_t i = 0; i < documents.size(); ++i) {
+                search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+            }
+            search_server.Freeze();
+            search_server.SaveIndex(path);
+        }
+        cout << "Startup with "s << document_count << " documents ("s << filesystem::file_size(path) / 1024 / 1024
+             << " MB index), ms: AddDocument "s << milliseconds_since(start_time);
+
+        start_time = steady_clock::now();
+        {
+            const SearchServer search_server = SearchServer::OpenIndex(path, IndexVerification::FULL);
+            cout << ", OpenIndex FULL "s << milliseconds_since(start_time);
+        }
+        start_time = steady_clock::now();
+        const SearchServer search_server = SearchServer::OpenIndex(path, IndexVerification::TRUSTED);
+        cout << ", OpenIndex TRUSTED "s << milliseconds_since(start_time);
+        start_time = steady_clock::now();
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(query);
+        }
+        cout << ", then "s << queries.size() << " queries "s << milliseconds_since(start_time) << endl;
+    }
+    filesystem::remove(path);
+}
+
+// Пропускная способность потоковой загрузки документов
+void BenchmarkBulkLoad() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 100'000, 20);
+
+    stringstream input;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        input << i << '\t' << static_cast<int>(DocumentStatus::ACTUAL) << '\t' << "1 2 3"s << '\t' << documents[i] << '\n';
+    }
+    SearchServer search_server;
+    cout << "Bulk load: "s << LoadDocuments(search_server, input) << endl;
+}
+
+// Повтор журнала запросов с распределением Ципфа: без кеша и через QueryCache
+void BenchmarkQueryCache() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 2'000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 20'000, 10);
+    const auto distinct_queries = GenerateQueries(generator, dictionary, 5'000, 4);
+
+    SearchServer search_server;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+
+    // Вероятность i-го по популярности запроса пропорциональна 1 / (i + 1)
+    vector<double> weights(distinct_queries.size());
+    for (size_t i = 0; i < weights.size(); ++i) {
+        weights[i] = 1.0 / (i + 1);
+    }
+    discrete_distribution<size_t> zipf(weights.begin(), weights.end());
+    vector<string_view> query_log(20'000);
+    for (auto& query : query_log) {
+        query = distinct_queries[zipf(generator)];
+    }
+
+    {
+        LOG_DURATION("Zipf query log without cache"s);
+        for (const string_view query : query_log) {
+            search_server.FindTopDocuments(query);
+        }
+    }
+    QueryCache cache(search_server, 2'000);
+    {
+        LOG_DURATION("Zipf query log with QueryCache"s);
+        for (const string_view query : query_log) {
+            cache.FindTopDocuments(query);
+        }
+    }
+    cout << "Query cache hits: "s << cache.GetHits() << ", misses: "s << cache.GetMisses() << endl;
+}
+
+void BenchmarkStatusFilter() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 2'000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 20'000, 10);
+    const auto queries = GenerateQueries(generator, dictionary, 2'000, 4);
+
+    SearchServer search_server;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], static_cast<DocumentStatus>(i % 4), {1, 2, 3});
+    }
+
+    {
+        LOG_DURATION("Status filter via predicate"s);
+        for (const string_view query : queries) {
+            search_server.FindTopDocuments(query, [](int, DocumentStatus status, int) {
+                return status == DocumentStatus::BANNED;
+            });
+        }
+    }
+    {
+        LOG_DURATION("Status filter via bitmap"s);
+        for (const string_view query : queries) {
+            search_server.FindTopDocuments(query, DocumentStatus::BANNED);
+        }
+    }
+}
+
+vector<int> GenerateSortedIds(mt19937& generator, size_t count, int max_id) {
+    vector<int> ids(count);
+    for (int& id : ids) {
+        id = uniform_int_distribution(0, max_id)(generator);
+    }
+    sort(ids.begin(), ids.end());
+    ids.erase(unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
+
+void BenchmarkSetOperations() {
+    mt19937 generator;
+    const int max_id = 2'000'000;
+    const vector<int> long_ids = GenerateSortedIds(generator, 1'000'000, max_id);
+    const SetOperationsKernel best_kernel = GetSetOperationsKernel();
+
+    // Длина короткого списка от 1/1 до 1/1000 длинного: до 1/32 работает поблочное сравнение, дальше галоп
+    for (const size_t short_count : {1'000'000, 100'000, 10'000, 1'000}) {
+        const vector<int> short_ids = GenerateSortedIds(generator, short_count, max_id);
+        const int repeat_count = static_cast<int>(10'000'000 / (long_ids.size() + short_ids.size())) + 1;
+        for (const SetOperationsKernel kernel : {SetOperationsKernel::SCALAR, SetOperationsKernel::SSE42,
+                                                 SetOperationsKernel::AVX2}) {
+            SetSetOperationsKernel(kernel);
+            if (GetSetOperationsKernel() != kernel) {
+                continue;
+            }
+            pmr::vector<uint32_t> positions;
+            LOG_DURATION("Intersect "s + to_string(long_ids.size()) + " x "s + to_string(short_ids.size())
+                                + " ("s + GetSetOperationsKernelName(kernel) + ", "s + to_string(repeat_count)
+                                + " times)"s);
+            for (int i = 0; i < repeat_count; ++i) {
+                positions.clear();
+                IntersectSorted(long_ids, short_ids, positions);
+            }
+        }
+    }
+    SetSetOperationsKernel(best_kernel);
+}
+
+void BenchmarkMinusWords() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 200, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 50'000, 20);
+    vector<string> queries;
+    for (int i = 0; i < 500; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, 3) + " -"s + GenerateQuery(generator, dictionary, 1));
+    }
+
+    SearchServer search_server;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    {
+        LOG_DURATION("Queries with minus words, any word"s);
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(query);
+        }
+    }
+    search_server.SetQueryMode(QueryMode::ALL_WORDS);
+    {
+        LOG_DURATION("Queries with minus words, all words"s);
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(query);
+        }
+    }
+}
+
+// Память на одно вхождение и время запросов для несжатых и сжатых списков вхождений
+void BenchmarkPostingFormats() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 100'000, 50);
+    const auto queries = GenerateQueries(generator, dictionary, 2'000, 5);
+
+    SearchServer search_server;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    for (const PostingFormat format : {PostingFormat::PLAIN, PostingFormat::COMPRESSED}) {
+        search_server.SetPostingFormat(format);
+        search_server.Freeze();
+        const string format_name = format == PostingFormat::PLAIN ? "plain"s : "compressed"s;
+        cout << "Postings ("s << format_name << "): "s
+             << static_cast<double>(search_server.GetPostingMemoryUsage()) / search_server.GetPostingCount()
+             << " bytes per posting"s << endl;
+        LOG_DURATION("Queries over "s + format_name + " postings"s);
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(query);
+        }
+    }
+}
+
+// Последовательный поиск частых слов: релевантность миллионов вхождений копится в плотном массиве по номерам
+void BenchmarkDenseRelevance() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 100, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 200'000, 20);
+    const auto queries = GenerateQueries(generator, dictionary, 20, 10);
+
+    SearchServer search_server;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    cout << "Postings in index: "s << search_server.GetPostingCount() << endl;
+    LOG_DURATION("Queries over frequent words"s);
+    for (const string& query : queries) {
+        search_server.FindTopDocuments(query);
+    }
+}
+
+// Поиск из многих потоков: после прогрева запрос берет у operator new только память под результат
+void BenchmarkQueryArena() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 2'000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 50'000, 20);
+    const auto queries = GenerateQueries(generator, dictionary, 2'000, 7);
+
+    SearchServer search_server;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+
+    const int thread_count = max(2u, thread::hardware_concurrency());
+    atomic<size_t> new_count(0);
+    const size_t upstream_count_before = QueryArena::GetTotalUpstreamAllocationCount();
+    {
+        LOG_DURATION("Queries from "s + to_string(thread_count) + " threads"s);
+        vector<thread> threads;
+        for (int t = 0; t < thread_count; ++t) {
+            threads.emplace_back([&search_server, &queries, &new_count] {
+                for (const string& query : queries) {
+                    search_server.FindTopDocuments(query);
+                }
+                // Второй проход идет по прогретой арене и накопителю
+                const size_t count_before = GetThreadNewCount();
+                for (const string& query : queries) {
+                    search_server.FindTopDocuments(query);
+                }
+                new_count += GetThreadNewCount() - count_before;
+            });
+        }
+        for (thread& worker : threads) {
+            worker.join();
+        }
+    }
+    cout << "Global new calls per warm query: "s
+         << static_cast<double>(new_count) / (thread_count * queries.size())
+         << ", arena blocks taken: "s << QueryArena::GetTotalUpstreamAllocationCount() - upstream_count_before << endl;
+}
+
+// Глубокая страница запроса с миллионом найденных документов: отбор всех лучших до нее против отбора одной страницы
+void BenchmarkDeepPage() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 1'000, 10);
+    const size_t document_count = 1'000'000;
+    const size_t page = 1'000;
+    const size_t page_size = 20;
+
+    SearchServer search_server;
+    for (size_t i = 0; i < document_count; ++i) {
+        search_server.AddDocument(i, "hit "s + GenerateQuery(generator, dictionary, 3), DocumentStatus::ACTUAL,
+                                  {static_cast<int>(i % 100)});
+    }
+    {
+        LOG_DURATION("Page "s + to_string(page) + " via FindTopDocuments and Paginate"s);
+        search_server.SetMaxResultDocumentCount((page + 1) * page_size);
+        const auto documents = search_server.FindTopDocuments("hit"s);
+        const auto pages = Paginate(documents, page_size);
+        cout << "Documents on page: "s << next(pages.begin(), page)->size() << endl;
+    }
+    {
+        LOG_DURATION("Page "s + to_string(page) + " via FindDocumentsPage"s);
+        cout << "Documents on page: "s << search_server.FindDocumentsPage("hit"s, page, page_size).size() << endl;
+    }
+}
+
+void BenchmarkDynamicPruning() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 5'000, 10);
+    // Частоты слов по закону Ципфа, как в текстах: частота слова обратно пропорциональна его номеру
+    vector<double> word_weights(dictionary.size());
+    for (size_t i = 0; i < word_weights.size(); ++i) {
+        word_weights[i] = 1.0 / (i + 1);
+    }
+    discrete_distribution<size_t> word_index(word_weights.begin(), word_weights.end());
+    const auto generate_text = [&generator, &dictionary, &word_index](int word_count) {
+        string text;
+        for (int i = 0; i < word_count; ++i) {
+            text += dictionary[word_index(generator)] + " "s;
+        }
+        return text;
+    };
+    SearchServer search_server;
+    for (int i = 0; i < 200'000; ++i) {
+        search_server.AddDocument(i, generate_text(30), DocumentStatus::ACTUAL, {i % 100});
+    }
+    vector<string> queries;
+    for (int i = 0; i < 200; ++i) {
+        queries.push_back(generate_text(12));
+    }
+
+    for (const bool dynamic_pruning : {false, true}) {
+        search_server.SetDynamicPruning(dynamic_pruning);
+        SearchServer::ResetPruningStats();
+        size_t document_count = 0;
+        {
+            LOG_DURATION(dynamic_pruning ? "Long queries with dynamic pruning"s : "Long queries, all postings"s);
+            for (const string& query : queries) {
+                document_count += search_server.FindTopDocuments(query).size();
+            }
+        }
+        const SearchServer::PruningStats stats = SearchServer::GetPruningStats();
+        cout << "Documents: "s << document_count;
+        if (dynamic_pruning) {
+            cout << ", postings skipped: "s << stats.query_postings - stats.scored_postings
+                 << " of "s << stats.query_postings;
+        }
+        cout << endl;
+    }
+}
+
+void BenchmarkTermDictionary() {
+    using namespace std::chrono;
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300'000, 12);
+    const size_t words_per_document = 10;
+
+    SearchServer search_server;
+    for (size_t i = 0; i + words_per_document <= dictionary.size(); i += words_per_document) {
+        string text;
+        for (size_t j = i; j < i + words_per_document; ++j) {
+            text += dictionary[j] + " "s;
+        }
+        search_server.AddDocument(i / words_per_document, text, DocumentStatus::ACTUAL, {1});
+    }
+    const double word_count = search_server.GetWordCount();
+    cout << "Words: "s << search_server.GetWordCount() << ", bytes per word in tree: "s
+         << search_server.GetDictionaryMemoryUsage() / word_count;
+    search_server.Freeze();
+    cout << ", in TermDictionary: "s << search_server.GetDictionaryMemoryUsage() / word_count << endl;
+
+    // Слова для поиска - отдельные копии, половина из них есть в словаре
+    vector<string> lookup_words;
+    for (int i = 0; i < 1'000'000; ++i) {
+        string word = dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+        if (i % 2 == 1) {
+            word.back() = '_';
+        }
+        lookup_words.push_back(move(word));
+    }
+    const auto print_ns_per_lookup = [&lookup_words](const string& name, const auto& contains) {
+        const auto start_time = steady_clock::now();
+        size_t found_count = 0;
+        for (const string& word : lookup_words) {
+            found_count += contains(word);
+        }
+        const auto duration = duration_cast<nanoseconds>(steady_clock::now() - start_time);
+        cout << name << ": "s << duration.count() / lookup_words.size() << " ns/lookup, found "s << found_count << endl;
+    };
+    const map<string, int, less<>> tree = [&dictionary] {
+        map<string, int, less<>> result;
+        for (const string& word : dictionary) {
+            result.emplace(word, 0);
+        }
+        return result;
+    }();
+    const TermDictionary term_dictionary(vector<string_view>(dictionary.begin(), dictionary.end()));
+    print_ns_per_lookup("std::map"s, [&tree](string_view word) {
+        return tree.count(word);
+    });
+    print_ns_per_lookup("TermDictionary"s, [&term_dictionary](string_view word) {
+        return term_dictionary.Contains(word);
+    });
+
+    {
+        LOG_DURATION("Prefix queries x 10000"s);
+        size_t document_count = 0;
+        for (int i = 0; i < 10'000; ++i) {
+            const string& word = dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+            document_count += search_server.FindTopDocuments(word.substr(0, 3) + "*"s).size();
+        }
+        cout << "Documents: "s << document_count << endl;
+    }
+}
+
+void BenchmarkSegmentedIngest() {
+    using namespace std::chrono;
+
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 80'000, 20);
+    const auto queries = GenerateQueries(generator, dictionary, 1'000, 3);
+    const size_t window_size = 20'000;
+    const int documents_per_publish = 2'000;
+
+    // Загрузка в одном потоке и поиск в другом; по окнам видно, растет ли цена загрузки вместе с индексом
+    const auto run = [&](const string& name, auto& search_server, auto publish) {
+        atomic_bool stop = false;
+        microseconds max_query_time{};
+        size_t query_count = 0;
+        thread reader([&] {
+            for (size_t query = 0; !stop; query = (query + 1) % queries.size()) {
+                const auto start_time = steady_clock::now();
+                search_server.FindTopDocuments(queries[query]);
+                max_query_time = max(max_query_time, duration_cast<microseconds>(steady_clock::now() - start_time));
+                ++query_count;
+            }
+        });
+        cout << name << " ingest ms per "s << window_size << " documents:"s;
+        for (size_t window_begin = 0; window_begin < documents.size(); window_begin += window_size) {
+            const auto start_time = steady_clock::now();
+            for (size_t i = window_begin; i < window_begin + window_size; ++i) {
+                search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+                if ((i + 1) % documents_per_publish == 0) {
+                    publish();
+                }
+            }
+            cout << " "s << duration_cast<milliseconds>(steady_clock::now() - start_time).count();
+        }
+        stop = true;
+        reader.join();
+        cout << "; queries: "s << query_count << ", max query ms: "s << max_query_time.count() / 1000 << endl;
+    };
+
+    {
+        SnapshotSearchServer search_server;
+        run("Snapshot (Publish every "s + to_string(documents_per_publish) + ")"s, search_server,
+            [&search_server] { search_server.Publish(); });
+    }
+    {
+        SegmentedSearchServer search_server;
+        run("Segmented"s, search_server, [] {});
+        search_server.WaitForMerges();
+        const SegmentedSearchServer::Stats stats = search_server.GetStats();
+        cout << "Segments: "s << stats.segment_count << ", merges: "s << stats.merge_count
+             << ", merged documents: "s << stats.merged_document_count
+             << ", merge ms total/max: "s << stats.total_merge_time.count() / 1000
+             << "/"s << stats.max_merge_time.count() / 1000 << endl;
+    }
+}
+
+// Разбивка времени запросов по фазам из SearchServer::GetStats и цена самого сбора на запрос
+void BenchmarkQueryStats() {
+    using namespace std::chrono;
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 2'000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 50'000, 20);
+    vector<string> queries;
+    for (int i = 0; i < 20'000; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, 3) + " -"s + GenerateQuery(generator, dictionary, 1));
+    }
+
+    SearchServer search_server;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    const auto start_time = steady_clock::now();
+    for (const string& query : queries) {
+        search_server.FindTopDocuments(query, [](int document_id, DocumentStatus, int) {
+            return document_id % 2 == 0;
+        });
+    }
+    const auto query_time = duration_cast<nanoseconds>(steady_clock::now() - start_time) / queries.size();
+
+    const SearchStats stats = search_server.GetStats();
+    cout << "Queries: "s << stats.query_count << ", timed: "s << stats.timed_query_count
+         << ", p50: "s << stats.query_latency.GetQuantile(0.5).count() << " ns"s
+         << ", p99: "s << stats.query_latency.GetQuantile(0.99).count() << " ns"s << endl;
+    for (size_t phase = 0; phase < QUERY_PHASE_COUNT; ++phase) {
+        cout << "  "s << GetQueryPhaseName(static_cast<QueryPhase>(phase)) << ": "s
+             << stats.phase_times[phase].count() / max<uint64_t>(stats.timed_query_count, 1) << " ns/query"s << endl;
+    }
+    for (size_t counter = 0; counter < QUERY_COUNTER_COUNT; ++counter) {
+        cout << "  "s << GetQueryCounterName(static_cast<QueryCounter>(counter)) << ": "s
+             << stats.counters[counter] / max<uint64_t>(stats.query_count, 1) << " per query"s << endl;
+    }
+
+    // Та же работа, что сбор делает в FindTopDocuments, без самого поиска
+    QueryStatsRecorder recorder;
+    const int repeat_count = 1'000'000;
+    const auto stats_start_time = steady_clock::now();
+    for (int i = 0; i < repeat_count; ++i) {
+        QueryTrace trace(QueryStatsRecorder::ShouldTimeQuery());
+        trace.Start();
+        for (size_t phase = 0; phase < QUERY_PHASE_COUNT; ++phase) {
+            trace.FinishPhase(static_cast<QueryPhase>(phase));
+        }
+        for (size_t counter = 0; counter < QUERY_COUNTER_COUNT; ++counter) {
+            trace.Add(static_cast<QueryCounter>(counter), i);
+        }
+        recorder.Record(trace);
+    }
+    const auto stats_time = duration_cast<nanoseconds>(steady_clock::now() - stats_start_time) / repeat_count;
+    cout << "Query: "s << query_time.count() << " ns, stats collection: "s << stats_time.count() << " ns"s << endl;
+
+    QueryTrace trace;
+    search_server.FindTopDocuments(queries.front(), DocumentStatus::ACTUAL, trace);
+    cout << "Trace of \""s << queries.front() << "\": "s << trace.GetTotalTime().count() << " ns, postings touched "s
+         << trace.GetCounter(QueryCounter::POSTINGS_TOUCHED) << endl;
+}
+
+struct MicroBenchmark {
+    const char* name;
+    void (*run)();
+};
+
+// Замеры отдельных оптимизаций на небольших синтетических данных.
+// Без аргументов запускаются все, иначе - перечисленные по имени (например, QueryArena DeepPage).
+int main(int argc, char* argv[]) {
+    const MicroBenchmark benchmarks[] = {
+        { "ProcessQueries", BenchmarkProcessQueries },
+        { "TopDocumentCount", BenchmarkTopDocumentCount },
+        { "ShortQueries", BenchmarkShortQueries },
+        { "SnapshotReads", BenchmarkSnapshotReads },
+        { "IndexStartup", BenchmarkIndexStartup },
+        { "BulkLoad", BenchmarkBulkLoad },
+        { "QueryCache", BenchmarkQueryCache },
+        { "StatusFilter", BenchmarkStatusFilter },
+        { "SetOperations", BenchmarkSetOperations },
+        { "MinusWords", BenchmarkMinusWords },
+        { "PostingFormats", BenchmarkPostingFormats },
+        { "DenseRelevance", BenchmarkDenseRelevance },
+        { "QueryArena", BenchmarkQueryArena },
+        { "DeepPage", BenchmarkDeepPage },
+        { "DynamicPruning", BenchmarkDynamicPruning },
+        { "TermDictionary", BenchmarkTermDictionary },
+        { "SegmentedIngest", BenchmarkSegmentedIngest },
+        { "QueryStats", BenchmarkQueryStats },
+    };
+    int run_count = 0;
+    for (const MicroBenchmark& benchmark : benchmarks) {
+        bool is_selected = argc == 1;
+        for (int i = 1; i < argc; ++i) {
+            is_selected = is_selected || strcmp(argv[i], benchmark.name) == 0;
+        }
+        if (is_selected) {
+            benchmark.run();
+            ++run_count;
+        }
+    }
+    if (run_count == 0) {
+        cerr << "Unknown benchmark"s << endl;
+        return 1;
+    }
+    return 0;
+}
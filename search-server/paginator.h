@@ -1,8 +1,9 @@
 #pragma once
 
+#include <cstddef>
 #include <iostream>
+#include <iterator>
 #include <stdexcept>
-#include <vector>
 #include "document.h"
 
 template <typename PaginatorIterator>
@@ -29,31 +30,84 @@ private:
     size_t page_size_;
 };
 
+// Страницы строятся по ходу обхода: хранится только начало текущей страницы, таблица страниц не заводится.
+// Достаточно однонаправленных итераторов; при переходе к следующей странице итератор сдвигается
+// не дальше конца диапазона.
 template <typename Iterator>
 class Paginator {
 public:
-    Paginator (Iterator begin, Iterator end, size_t page_size) {
-        if (page_size == 0) {
-            throw std::invalid_argument("Incorrect page size");
+    class PageIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = IteratorRange<Iterator>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        PageIterator(Iterator begin, Iterator end, size_t page_size)
+            : page_(begin, begin, 0)
+            , end_(end)
+            , page_size_(page_size) {
+            FindPageEnd(begin);
+        }
+
+        reference operator*() const {
+            return page_;
+        }
+        pointer operator->() const {
+            return &page_;
         }
 
-        for (size_t i = distance(begin, end); i > 0; ) {
-            auto size = std::min(i, page_size);
-            auto page_end = begin + size;
-            pages_.push_back({begin, page_end, size});
-            begin = page_end;
-            i -= size;
+        PageIterator& operator++() {
+            FindPageEnd(page_.End());
+            return *this;
+        }
+        PageIterator operator++(int) {
+            PageIterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const PageIterator& other) const {
+            return page_.Begin() == other.page_.Begin();
+        }
+        bool operator!=(const PageIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        void FindPageEnd(Iterator page_begin) {
+            Iterator page_end = page_begin;
+            size_t size = 0;
+            while (size < page_size_ && page_end != end_) {
+                ++page_end;
+                ++size;
+            }
+            page_ = IteratorRange<Iterator>(page_begin, page_end, size);
+        }
+
+        IteratorRange<Iterator> page_;
+        Iterator end_;
+        size_t page_size_;
+    };
+
+    Paginator (Iterator begin, Iterator end, size_t page_size)
+        : begin_(begin), end_(end), page_size_(page_size) {
+        if (page_size == 0) {
+            throw std::invalid_argument("Incorrect page size");
         }
     }
-    auto begin() const {
-        return pages_.begin();
+    PageIterator begin() const {
+        return PageIterator(begin_, end_, page_size_);
     }
-    auto end() const {
-        return pages_.end();
+    PageIterator end() const {
+        return PageIterator(end_, end_, page_size_);
     }
 
 private:
-    std::vector<IteratorRange<Iterator>> pages_;
+    Iterator begin_;
+    Iterator end_;
+    size_t page_size_;
 };
 
 template <typename Container>
@@ -70,7 +124,7 @@ std::ostream& std::operator<<(std::ostream& out, const IteratorRange<Iterator>&
     return out;
 }
 
-// Перегрузка для вывода Paginator (всех страниц - вектора страниц в классе Paginator)
+// Перегрузка для вывода Paginator (всех страниц по очереди)
 template <typename Iterator>
 std::ostream& std::operator<<(std::ostream& out, const Paginator<Iterator>& paginator) {
     for (const auto& page : paginator) {
@@ -0,0 +1,444 @@
+#include "posting_list.h"
+#include "posting_set_operations.h"
+#include <algorithm>
+#include <cmath>
+
+PostingList::Cursor::Cursor(const PostingList& postings)
+    : postings_(&postings)
+    , size_(postings.size())
+    , document_ids_(postings.GetDocumentIds().data())
+    , term_freqs_(postings.GetTermFreqs().data()) {
+    if (postings_->is_compressed_ && !AtEnd()) {
+        EnterBlock(0);
+    }
+}
+
+void PostingList::Cursor::Advance(int document_id) {
+    if (AtEnd()) {
+        return;
+    }
+    if (!postings_->is_compressed_) {
+        // Искомый id обычно недалеко: граница ищется шагами 1, 2, 4, ..., затем двоичным поиском
+        size_t low = position_;
+        size_t step = 1;
+        size_t high = low;
+        while (high < size_ && document_ids_[high] < document_id) {
+            low = high + 1;
+            high += step;
+            step *= 2;
+        }
+        high = std::min(high, size_);
+        position_ = std::lower_bound(document_ids_ + low, document_ids_ + high, document_id) - document_ids_;
+        return;
+    }
+    if (document_id_ >= document_id) {
+        return;
+    }
+    // Блоки, где все id меньше искомого, пропускаются по последним id без распаковки
+    const std::vector<SkipEntry>& skip_entries = postings_->skip_entries_;
+    if (skip_entries[block_].last_document_id < document_id) {
+        const auto skip_it = std::lower_bound(skip_entries.begin() + block_ + 1, skip_entries.end(), document_id,
+            [](const SkipEntry& entry, int value) {
+                return entry.last_document_id < value;
+            });
+        if (skip_it == skip_entries.end()) {
+            position_ = size_;
+            return;
+        }
+        EnterBlock(skip_it - skip_entries.begin());
+    }
+    while (document_id_ < document_id) {
+        Next();
+    }
+}
+
+void PostingList::Cursor::EnterBlock(size_t block) {
+    const std::vector<SkipEntry>& skip_entries = postings_->skip_entries_;
+    block_ = block;
+    position_ = skip_entries[block].first_position;
+    block_end_ = block + 1 < skip_entries.size() ? skip_entries[block + 1].first_position : size_;
+    data_ = postings_->compressed_document_ids_.data() + skip_entries[block].offset;
+    document_id_ = 0;
+    ReadDocumentId();
+}
+
+namespace {
+
+void AppendVarint(uint32_t value, std::vector<uint8_t>& out) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Первый id - разность с нулем, остальные - с предыдущим
+void EncodeBlock(const int* document_ids, size_t count, std::vector<uint8_t>& out) {
+    int previous_id = 0;
+    for (size_t i = 0; i < count; ++i) {
+        AppendVarint(static_cast<uint32_t>(document_ids[i] - previous_id), out);
+        previous_id = document_ids[i];
+    }
+}
+
+}  // namespace
+
+PostingList::PostingList(std::vector<int> document_ids, std::vector<double> term_freqs)
+    : document_ids_(std::move(document_ids))
+    , term_freqs_(std::move(term_freqs)) {
+    if (!term_freqs_.empty()) {
+        max_term_freq_ = *std::max_element(term_freqs_.begin(), term_freqs_.end());
+    }
+    UpdateLogDocumentFreq();
+}
+
+PostingList::PostingList(ArrayView<int> document_ids, ArrayView<double> term_freqs, double max_term_freq)
+    : max_term_freq_(max_term_freq)
+    , is_mapped_(true)
+    , mapped_document_ids_(document_ids)
+    , mapped_term_freqs_(term_freqs) {
+    UpdateLogDocumentFreq();
+}
+
+void PostingList::CopyMappedArrays() {
+    if (!is_mapped_) {
+        return;
+    }
+    document_ids_.assign(mapped_document_ids_.begin(), mapped_document_ids_.end());
+    term_freqs_.assign(mapped_term_freqs_.begin(), mapped_term_freqs_.end());
+    is_mapped_ = false;
+    mapped_document_ids_ = {};
+    mapped_term_freqs_ = {};
+}
+
+void PostingList::Add(int document_id, double term_freq) {
+    CopyMappedArrays();
+    if (is_compressed_) {
+        AddCompressed(document_id, term_freq);
+        return;
+    }
+    // Обычно id растут, и документ дописывается в конец без поиска
+    if (document_ids_.empty() || document_ids_.back() < document_id) {
+        document_ids_.push_back(document_id);
+        term_freqs_.push_back(term_freq);
+        max_term_freq_ = std::max(max_term_freq_, term_freq);
+        UpdateLogDocumentFreq();
+        return;
+    }
+    const auto it = std::lower_bound(document_ids_.begin(), document_ids_.end(), document_id);
+    const auto index = it - document_ids_.begin();
+    if (*it == document_id) {
+        term_freqs_[index] += term_freq;
+        max_term_freq_ = std::max(max_term_freq_, term_freqs_[index]);
+        return;
+    }
+    document_ids_.insert(it, document_id);
+    term_freqs_.insert(term_freqs_.begin() + index, term_freq);
+    max_term_freq_ = std::max(max_term_freq_, term_freq);
+    UpdateLogDocumentFreq();
+}
+
+bool PostingList::Remove(int document_id) {
+    if (is_mapped_ && !Contains(document_id)) {
+        return false;
+    }
+    CopyMappedArrays();
+    if (is_compressed_) {
+        return RemoveCompressed(document_id);
+    }
+    const auto it = std::lower_bound(document_ids_.begin(), document_ids_.end(), document_id);
+    if (it == document_ids_.end() || *it != document_id) {
+        return false;
+    }
+    term_freqs_.erase(term_freqs_.begin() + (it - document_ids_.begin()));
+    document_ids_.erase(it);
+    UpdateLogDocumentFreq();
+    return true;
+}
+
+void PostingList::AddCompressed(int document_id, double term_freq) {
+    // Дописывание в конец: разность с последним id, последний блок заполнен - новый блок
+    if (skip_entries_.empty() || skip_entries_.back().last_document_id < document_id) {
+        if (skip_entries_.empty() || GetBlockSize(skip_entries_.size() - 1) >= COMPRESSED_BLOCK_SIZE) {
+            skip_entries_.push_back({ document_id, static_cast<uint32_t>(compressed_document_ids_.size()),
+                                      static_cast<uint32_t>(compressed_size_) });
+            AppendVarint(static_cast<uint32_t>(document_id), compressed_document_ids_);
+        }
+        else {
+            AppendVarint(static_cast<uint32_t>(document_id - skip_entries_.back().last_document_id),
+                         compressed_document_ids_);
+            skip_entries_.back().last_document_id = document_id;
+        }
+        compressed_term_freqs_.push_back(static_cast<float>(term_freq));
+        max_term_freq_ = std::max<double>(max_term_freq_, compressed_term_freqs_.back());
+        ++compressed_size_;
+        UpdateLogDocumentFreq();
+        return;
+    }
+    const size_t block = FindBlock(document_id);
+    std::vector<int> block_ids;
+    DecodeBlock(block, block_ids);
+    const auto it = std::lower_bound(block_ids.begin(), block_ids.end(), document_id);
+    const size_t position = skip_entries_[block].first_position + (it - block_ids.begin());
+    if (*it == document_id) {
+        float& stored_term_freq = compressed_term_freqs_[position];
+        stored_term_freq = static_cast<float>(stored_term_freq + term_freq);
+        max_term_freq_ = std::max<double>(max_term_freq_, stored_term_freq);
+        return;
+    }
+    block_ids.insert(it, document_id);
+    compressed_term_freqs_.insert(compressed_term_freqs_.begin() + position, static_cast<float>(term_freq));
+    max_term_freq_ = std::max<double>(max_term_freq_, compressed_term_freqs_[position]);
+    ReplaceBlock(block, block_ids);
+    UpdateLogDocumentFreq();
+}
+
+bool PostingList::RemoveCompressed(int document_id) {
+    if (skip_entries_.empty()) {
+        return false;
+    }
+    const size_t block = FindBlock(document_id);
+    if (skip_entries_[block].last_document_id < document_id) {
+        return false;
+    }
+    std::vector<int> block_ids;
+    DecodeBlock(block, block_ids);
+    const auto it = std::lower_bound(block_ids.begin(), block_ids.end(), document_id);
+    if (it == block_ids.end() || *it != document_id) {
+        return false;
+    }
+    compressed_term_freqs_.erase(compressed_term_freqs_.begin() + skip_entries_[block].first_position
+                                 + (it - block_ids.begin()));
+    block_ids.erase(it);
+    ReplaceBlock(block, block_ids);
+    UpdateLogDocumentFreq();
+    return true;
+}
+
+size_t PostingList::GetBlockSize(size_t block) const {
+    const size_t block_end = block + 1 < skip_entries_.size() ? skip_entries_[block + 1].first_position
+                                                              : compressed_size_;
+    return block_end - skip_entries_[block].first_position;
+}
+
+size_t PostingList::FindBlock(int document_id) const {
+    const auto skip_it = std::lower_bound(skip_entries_.begin(), skip_entries_.end(), document_id,
+        [](const SkipEntry& entry, int value) {
+            return entry.last_document_id < value;
+        });
+    return skip_it == skip_entries_.end() ? skip_entries_.size() - 1 : skip_it - skip_entries_.begin();
+}
+
+void PostingList::DecodeBlock(size_t block, std::vector<int>& document_ids) const {
+    Cursor cursor(*this);
+    cursor.EnterBlock(block);
+    const size_t block_size = GetBlockSize(block);
+    document_ids.reserve(block_size + 1);
+    for (size_t i = 0; i < block_size; ++i, cursor.Next()) {
+        document_ids.push_back(cursor.GetDocumentId());
+    }
+}
+
+void PostingList::ReplaceBlock(size_t block, const std::vector<int>& document_ids) {
+    const size_t old_begin = skip_entries_[block].offset;
+    const size_t old_end = block + 1 < skip_entries_.size() ? skip_entries_[block + 1].offset
+                                                            : compressed_document_ids_.size();
+    const size_t first_position = skip_entries_[block].first_position;
+    const size_t old_count = GetBlockSize(block);
+
+    std::vector<uint8_t> encoded;
+    std::vector<SkipEntry> new_entries;
+    const size_t part_count = document_ids.empty() ? 0 : document_ids.size() > MAX_COMPRESSED_BLOCK_SIZE ? 2 : 1;
+    for (size_t part = 0; part < part_count; ++part) {
+        const size_t begin = part == 0 ? 0 : document_ids.size() / 2;
+        const size_t end = part + 1 == part_count ? document_ids.size() : document_ids.size() / 2;
+        new_entries.push_back({ document_ids[end - 1], static_cast<uint32_t>(old_begin + encoded.size()),
+                                static_cast<uint32_t>(first_position + begin) });
+        EncodeBlock(document_ids.data() + begin, end - begin, encoded);
+    }
+
+    const size_t old_size = old_end - old_begin;
+    if (encoded.size() > old_size) {
+        compressed_document_ids_.insert(compressed_document_ids_.begin() + old_end, encoded.size() - old_size, 0);
+    }
+    else {
+        compressed_document_ids_.erase(compressed_document_ids_.begin() + old_begin + encoded.size(),
+                                       compressed_document_ids_.begin() + old_end);
+    }
+    std::copy(encoded.begin(), encoded.end(), compressed_document_ids_.begin() + old_begin);
+
+    skip_entries_.erase(skip_entries_.begin() + block);
+    skip_entries_.insert(skip_entries_.begin() + block, new_entries.begin(), new_entries.end());
+    const int64_t offset_delta = static_cast<int64_t>(encoded.size()) - static_cast<int64_t>(old_size);
+    const int64_t count_delta = static_cast<int64_t>(document_ids.size()) - static_cast<int64_t>(old_count);
+    for (size_t i = block + new_entries.size(); i < skip_entries_.size(); ++i) {
+        skip_entries_[i].offset = static_cast<uint32_t>(skip_entries_[i].offset + offset_delta);
+        skip_entries_[i].first_position = static_cast<uint32_t>(skip_entries_[i].first_position + count_delta);
+    }
+    compressed_size_ = static_cast<size_t>(static_cast<int64_t>(compressed_size_) + count_delta);
+}
+
+bool PostingList::Contains(int document_id) const {
+    if (!is_compressed_) {
+        const ArrayView<int> document_ids = GetDocumentIds();
+        return std::binary_search(document_ids.begin(), document_ids.end(), document_id);
+    }
+    Cursor cursor(*this);
+    cursor.Advance(document_id);
+    return !cursor.AtEnd() && cursor.GetDocumentId() == document_id;
+}
+
+size_t PostingList::size() const {
+    return is_compressed_ ? compressed_size_ : is_mapped_ ? mapped_document_ids_.size() : document_ids_.size();
+}
+
+bool PostingList::empty() const {
+    return size() == 0;
+}
+
+double PostingList::GetLogDocumentFreq() const {
+    return log_document_freq_;
+}
+
+void PostingList::UpdateLogDocumentFreq() {
+    log_document_freq_ = empty() ? 0.0 : std::log(static_cast<double>(size()));
+}
+
+double PostingList::GetMaxTermFreq() const {
+    return max_term_freq_;
+}
+
+ArrayView<int> PostingList::GetDocumentIds() const {
+    return is_mapped_ ? mapped_document_ids_ : ArrayView<int>(document_ids_.data(), document_ids_.size());
+}
+
+ArrayView<double> PostingList::GetTermFreqs() const {
+    return is_mapped_ ? mapped_term_freqs_ : ArrayView<double>(term_freqs_.data(), term_freqs_.size());
+}
+
+void PostingList::AppendDocumentIds(std::pmr::vector<int>& out) const {
+    if (!is_compressed_) {
+        const ArrayView<int> document_ids = GetDocumentIds();
+        out.insert(out.end(), document_ids.begin(), document_ids.end());
+        return;
+    }
+    out.reserve(out.size() + compressed_size_);
+    for (Cursor cursor(*this); !cursor.AtEnd(); cursor.Next()) {
+        out.push_back(cursor.GetDocumentId());
+    }
+}
+
+void PostingList::KeepContained(std::pmr::vector<int>& document_ids) const {
+    size_t kept_count = 0;
+    if (!is_compressed_) {
+        std::pmr::vector<uint32_t> positions(document_ids.get_allocator());
+        IntersectSorted(document_ids, GetDocumentIds(), positions);
+        for (const uint32_t position : positions) {
+            document_ids[kept_count++] = document_ids[position];
+        }
+    }
+    else {
+        Cursor cursor(*this);
+        for (const int document_id : document_ids) {
+            cursor.Advance(document_id);
+            if (cursor.AtEnd()) {
+                break;
+            }
+            if (cursor.GetDocumentId() == document_id) {
+                document_ids[kept_count++] = document_id;
+            }
+        }
+    }
+    document_ids.resize(kept_count);
+}
+
+void PostingList::AppendTermFreqs(const std::pmr::vector<int>& document_ids, std::vector<double>& out) const {
+    out.reserve(out.size() + document_ids.size());
+    if (!is_compressed_) {
+        std::pmr::vector<uint32_t> positions;
+        positions.reserve(document_ids.size());
+        IntersectSorted(GetDocumentIds(), document_ids, positions);
+        const ArrayView<double> term_freqs = GetTermFreqs();
+        for (const uint32_t position : positions) {
+            out.push_back(term_freqs[position]);
+        }
+        return;
+    }
+    Cursor cursor(*this);
+    for (const int document_id : document_ids) {
+        cursor.Advance(document_id);
+        out.push_back(cursor.GetTermFreq());
+    }
+}
+
+bool PostingList::IsCompressed() const {
+    return is_compressed_;
+}
+
+bool PostingList::IsMapped() const {
+    return is_mapped_;
+}
+
+void PostingList::Compress() {
+    if (is_compressed_) {
+        return;
+    }
+    // Чужие массивы кодируются сразу, без копии
+    const ArrayView<int> document_ids = GetDocumentIds();
+    const ArrayView<double> term_freqs = GetTermFreqs();
+    compressed_size_ = document_ids.size();
+    compressed_document_ids_.clear();
+    compressed_document_ids_.reserve(compressed_size_ * 2);
+    compressed_term_freqs_.assign(term_freqs.begin(), term_freqs.end());
+    // Округление до float может увеличить TF, поэтому оценка берется по сжатым значениям
+    max_term_freq_ = compressed_term_freqs_.empty()
+        ? 0.0 : *std::max_element(compressed_term_freqs_.begin(), compressed_term_freqs_.end());
+    skip_entries_.clear();
+    skip_entries_.reserve((compressed_size_ + COMPRESSED_BLOCK_SIZE - 1) / COMPRESSED_BLOCK_SIZE);
+    for (size_t begin = 0; begin < compressed_size_; begin += COMPRESSED_BLOCK_SIZE) {
+        const size_t end = std::min(begin + COMPRESSED_BLOCK_SIZE, compressed_size_);
+        skip_entries_.push_back({ document_ids[end - 1], static_cast<uint32_t>(compressed_document_ids_.size()),
+                                  static_cast<uint32_t>(begin) });
+        EncodeBlock(document_ids.data() + begin, end - begin, compressed_document_ids_);
+    }
+    compressed_document_ids_.shrink_to_fit();
+
+    is_compressed_ = true;
+    is_mapped_ = false;
+    mapped_document_ids_ = {};
+    mapped_term_freqs_ = {};
+    std::vector<int>().swap(document_ids_);
+    std::vector<double>().swap(term_freqs_);
+}
+
+void PostingList::Decompress() {
+    if (!is_compressed_) {
+        return;
+    }
+    document_ids_.reserve(compressed_size_);
+    term_freqs_.reserve(compressed_size_);
+    for (Cursor cursor(*this); !cursor.AtEnd(); cursor.Next()) {
+        document_ids_.push_back(cursor.GetDocumentId());
+        term_freqs_.push_back(cursor.GetTermFreq());
+    }
+    is_compressed_ = false;
+    compressed_size_ = 0;
+    std::vector<uint8_t>().swap(compressed_document_ids_);
+    std::vector<float>().swap(compressed_term_freqs_);
+    std::vector<SkipEntry>().swap(skip_entries_);
+}
+
+size_t PostingList::GetMemoryUsage() const {
+    return document_ids_.capacity() * sizeof(int) + term_freqs_.capacity() * sizeof(double)
+        + compressed_document_ids_.capacity() * sizeof(uint8_t)
+        + compressed_term_freqs_.capacity() * sizeof(float)
+        + skip_entries_.capacity() * sizeof(SkipEntry);
+}
+
+void PostingList::ShrinkToFit() {
+    document_ids_.shrink_to_fit();
+    term_freqs_.shrink_to_fit();
+    compressed_document_ids_.shrink_to_fit();
+    compressed_term_freqs_.shrink_to_fit();
+    skip_entries_.shrink_to_fit();
+}
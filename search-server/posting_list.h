@@ -0,0 +1,223 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// Список вхождений слова: отсортированные по возрастанию id документов и их TF в параллельных массивах.
+//
+// Список можно сжать (Compress): id хранятся разностями с соседом в varint-кодировке блоками по
+// COMPRESSED_BLOCK_SIZE, первый id блока - целиком, поэтому блоки декодируются независимо. TF хранится как float:
+// значение округляется один раз, при сжатии или добавлении, и при распаковке и повторном сжатии уже не меняется.
+// Для каждого блока запоминаются последний id, смещение и номер первого вхождения, по ним Cursor::Advance
+// перепрыгивает блоки, не распаковывая их. Add и Remove у сжатого списка перекодируют только затронутый блок:
+// дописывание в конец идет без перекодирования, блок, выросший до MAX_COMPRESSED_BLOCK_SIZE, делится пополам,
+// опустевший блок удаляется.
+//
+// Несжатый список может читать массивы из чужой памяти (отображенного в память файла индекса) без копии.
+// Такой список только для чтения: первое изменение копирует массивы в свои.
+
+// Массив в чужой памяти: указатель и длина
+template <typename T>
+class ArrayView {
+public:
+    ArrayView() = default;
+    ArrayView(const T* data, size_t size) : data_(data), size_(size) {
+    }
+
+    const T* data() const {
+        return data_;
+    }
+    size_t size() const {
+        return size_;
+    }
+    bool empty() const {
+        return size_ == 0;
+    }
+    const T* begin() const {
+        return data_;
+    }
+    const T* end() const {
+        return data_ + size_;
+    }
+    const T& operator[](size_t index) const {
+        return data_[index];
+    }
+
+private:
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+class PostingList {
+public:
+    static const size_t COMPRESSED_BLOCK_SIZE = 128;
+    static const size_t MAX_COMPRESSED_BLOCK_SIZE = 2 * COMPRESSED_BLOCK_SIZE;
+
+    // Последовательный обход списка в любом формате; сжатый распаковывается по ходу обхода.
+    // Действителен, пока список не меняется.
+    class Cursor {
+    public:
+        explicit Cursor(const PostingList& postings);
+
+        bool AtEnd() const;
+        int GetDocumentId() const;
+        double GetTermFreq() const;
+
+        void Next();
+
+        // Переходит к первому вхождению с id >= document_id (назад не возвращается)
+        void Advance(int document_id);
+
+    private:
+        friend class PostingList;
+
+        void ReadDocumentId();
+        void EnterBlock(size_t block);
+
+        const PostingList* postings_;
+        size_t size_;
+        const int* document_ids_;  // массивы несжатого списка
+        const double* term_freqs_;
+        size_t position_ = 0;
+        size_t block_ = 0;  // текущий блок сжатого списка
+        size_t block_end_ = 0;  // номер первого вхождения следующего блока
+        int document_id_ = 0;
+        const uint8_t* data_ = nullptr;  // следующий байт сжатых id
+    };
+
+    PostingList() = default;
+
+    // Готовые массивы (например, из файла индекса). id должны идти по возрастанию.
+    PostingList(std::vector<int> document_ids, std::vector<double> term_freqs);
+
+    // Массивы в чужой памяти, которая должна жить дольше списка и его копий; не копируются до первого изменения.
+    // max_term_freq - наибольший TF массива (см. GetMaxTermFreq), чтобы не читать массив целиком.
+    PostingList(ArrayView<int> document_ids, ArrayView<double> term_freqs, double max_term_freq);
+
+    // Добавляет TF документа. Если документ уже есть в списке, TF суммируется.
+    void Add(int document_id, double term_freq);
+
+    // Удаляет документ из списка. Возвращает false, если документа в списке не было.
+    bool Remove(int document_id);
+
+    bool Contains(int document_id) const;
+
+    size_t size() const;
+    bool empty() const;
+
+    // log(size()), пересчитывается при изменении длины списка. Нужен для IDF без вызова log при поиске.
+    double GetLogDocumentFreq() const;
+
+    // Не меньше наибольшего TF списка: при добавлении растет, при удалении не уменьшается,
+    // точно пересчитывается при сжатии. Дает верхнюю оценку вклада слова в релевантность.
+    double GetMaxTermFreq() const;
+
+    // Массивы несжатого списка; у сжатого они пусты, читать его нужно через Cursor
+    ArrayView<int> GetDocumentIds() const;
+    ArrayView<double> GetTermFreqs() const;
+
+    // Дописывает в out id документов списка в любом формате
+    void AppendDocumentIds(std::pmr::vector<int>& out) const;
+
+    // Оставляет в document_ids (по возрастанию) только id, которые есть в списке.
+    // Временная память берется из ресурса самого document_ids.
+    void KeepContained(std::pmr::vector<int>& document_ids) const;
+
+    // Дописывает в out TF документов document_ids (по возрастанию, все должны быть в списке).
+    // Не выделяет память из ресурса document_ids, поэтому можно вызывать из других потоков.
+    void AppendTermFreqs(const std::pmr::vector<int>& document_ids, std::vector<double>& out) const;
+
+    bool IsCompressed() const;
+    // Читает ли список массивы в чужой памяти
+    bool IsMapped() const;
+    void Compress();
+    void Decompress();
+
+    // Байт памяти под вхождения (с учетом зарезервированной памяти массивов); чужие массивы не считаются
+    size_t GetMemoryUsage() const;
+
+    // Освобождает зарезервированную, но не занятую память массивов
+    void ShrinkToFit();
+
+private:
+    struct SkipEntry {
+        int last_document_id;
+        uint32_t offset;  // начало блока в compressed_document_ids_
+        uint32_t first_position;  // номер первого вхождения блока в списке
+    };
+
+    void UpdateLogDocumentFreq();
+
+    // Перед изменением: копирует чужие массивы в свои
+    void CopyMappedArrays();
+
+    size_t GetBlockSize(size_t block) const;
+
+    // Первый блок, последний id которого не меньше document_id, или последний блок
+    size_t FindBlock(int document_id) const;
+
+    void DecodeBlock(size_t block, std::vector<int>& document_ids) const;
+
+    // Кодирует document_ids на место блока block: пустой блок удаляется, слишком большой делится пополам.
+    // Смещения и номера вхождений следующих блоков сдвигаются; TF меняет вызывающий.
+    void ReplaceBlock(size_t block, const std::vector<int>& document_ids);
+
+    void AddCompressed(int document_id, double term_freq);
+    bool RemoveCompressed(int document_id);
+
+    std::vector<int> document_ids_;
+    std::vector<double> term_freqs_;
+    double log_document_freq_ = 0.0;
+    double max_term_freq_ = 0.0;
+
+    bool is_mapped_ = false;
+    ArrayView<int> mapped_document_ids_;
+    ArrayView<double> mapped_term_freqs_;
+
+    bool is_compressed_ = false;
+    size_t compressed_size_ = 0;
+    std::vector<uint8_t> compressed_document_ids_;
+    std::vector<float> compressed_term_freqs_;
+    std::vector<SkipEntry> skip_entries_;
+};
+
+// Переход к следующему вхождению вызывается на каждое вхождение при поиске, поэтому он в заголовке
+
+inline bool PostingList::Cursor::AtEnd() const {
+    return position_ >= size_;
+}
+
+inline int PostingList::Cursor::GetDocumentId() const {
+    return postings_->is_compressed_ ? document_id_ : document_ids_[position_];
+}
+
+inline double PostingList::Cursor::GetTermFreq() const {
+    return postings_->is_compressed_ ? postings_->compressed_term_freqs_[position_] : term_freqs_[position_];
+}
+
+inline void PostingList::Cursor::Next() {
+    ++position_;
+    if (postings_->is_compressed_ && !AtEnd()) {
+        if (position_ == block_end_) {
+            EnterBlock(block_ + 1);
+        }
+        else {
+            ReadDocumentId();
+        }
+    }
+}
+
+// Разность с предыдущим id: по 7 бит в байте, старший бит - признак продолжения
+inline void PostingList::Cursor::ReadDocumentId() {
+    uint32_t delta = 0;
+    int shift = 0;
+    uint8_t byte = 0;
+    do {
+        byte = *data_++;
+        delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    document_id_ += static_cast<int>(delta);
+}
@@ -0,0 +1,323 @@
+#include "posting_set_operations.h"
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define POSTING_SET_OPERATIONS_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Во сколько раз один массив должен быть длиннее другого, чтобы искать по нему галопом
+const size_t GALLOP_RATIO = 32;
+
+// Первая позиция не раньше from, где data[pos] >= value: шаг удваивается, затем двоичный поиск
+size_t GallopLowerBound(const int* data, size_t size, size_t from, int value) {
+    size_t low = from;
+    size_t step = 1;
+    while (low + step < size && data[low + step] < value) {
+        low += step;
+        step *= 2;
+    }
+    return std::lower_bound(data + low, data + std::min(low + step, size), value) - data;
+}
+
+void GallopIntersectSmallFirst(const int* a, size_t a_size, const int* b, size_t b_size, std::pmr::vector<uint32_t>& out) {
+    size_t j = 0;
+    for (size_t i = 0; i < a_size; ++i) {
+        j = GallopLowerBound(b, b_size, j, a[i]);
+        if (j == b_size) {
+            return;
+        }
+        if (b[j] == a[i]) {
+            out.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+void GallopIntersectSmallSecond(const int* a, size_t a_size, const int* b, size_t b_size, std::pmr::vector<uint32_t>& out) {
+    size_t i = 0;
+    for (size_t j = 0; j < b_size; ++j) {
+        i = GallopLowerBound(a, a_size, i, b[j]);
+        if (i == a_size) {
+            return;
+        }
+        if (a[i] == b[j]) {
+            out.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+void GallopDifferenceSmallFirst(const int* a, size_t a_size, const int* b, size_t b_size, std::pmr::vector<uint32_t>& out) {
+    size_t j = 0;
+    for (size_t i = 0; i < a_size; ++i) {
+        j = GallopLowerBound(b, b_size, j, a[i]);
+        if (j == b_size || b[j] != a[i]) {
+            out.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+void GallopDifferenceSmallSecond(const int* a, size_t a_size, const int* b, size_t b_size, std::pmr::vector<uint32_t>& out) {
+    size_t i = 0;
+    for (size_t j = 0; j < b_size && i < a_size; ++j) {
+        size_t next = GallopLowerBound(a, a_size, i, b[j]);
+        for (; i < next; ++i) {
+            out.push_back(static_cast<uint32_t>(i));
+        }
+        if (next < a_size && a[next] == b[j]) {
+            i = next + 1;
+        }
+    }
+    for (; i < a_size; ++i) {
+        out.push_back(static_cast<uint32_t>(i));
+    }
+}
+
+// Слияние с позиции (i, j). Все элементы b до j меньше a[i].
+void ScalarMerge(const int* a, size_t a_size, const int* b, size_t b_size, size_t i, size_t j,
+                 bool keep_matched, std::pmr::vector<uint32_t>& out) {
+    while (i < a_size && j < b_size) {
+        if (a[i] < b[j]) {
+            if (!keep_matched) {
+                out.push_back(static_cast<uint32_t>(i));
+            }
+            ++i;
+        }
+        else {
+            if (a[i] == b[j]) {
+                if (keep_matched) {
+                    out.push_back(static_cast<uint32_t>(i));
+                }
+                ++i;
+            }
+            ++j;
+        }
+    }
+    if (!keep_matched) {
+        for (; i < a_size; ++i) {
+            out.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+#ifdef POSTING_SET_OPERATIONS_X86
+
+// Выписывает позиции блока a, начинающегося с start: совпавшие (бит в mask) или несовпавшие
+void EmitBlock(size_t start, unsigned width, unsigned mask, bool keep_matched, std::pmr::vector<uint32_t>& out) {
+    unsigned selected = keep_matched ? mask : ~mask & ((1u << width) - 1);
+    while (selected != 0) {
+        out.push_back(static_cast<uint32_t>(start + __builtin_ctz(selected)));
+        selected &= selected - 1;
+    }
+}
+
+// Дорабатывает после поблочного прохода. Если блок a на позиции i целиком в массиве, поблочный проход
+// остановился из-за конца b, и часть совпадений блока уже набрана в mask; остаток b сравнивается поэлементно.
+void FinishBlockMerge(const int* a, size_t a_size, const int* b, size_t b_size, size_t i, size_t j,
+                      unsigned width, unsigned mask, bool keep_matched, std::pmr::vector<uint32_t>& out) {
+    if (i + width <= a_size) {
+        for (unsigned k = 0; k < width; ++k) {
+            bool is_matched = (mask >> k) & 1u;
+            if (!is_matched) {
+                while (j < b_size && b[j] < a[i + k]) {
+                    ++j;
+                }
+                is_matched = j < b_size && b[j] == a[i + k];
+            }
+            if (is_matched == keep_matched) {
+                out.push_back(static_cast<uint32_t>(i + k));
+            }
+        }
+        i += width;
+    }
+    ScalarMerge(a, a_size, b, b_size, i, j, keep_matched, out);
+}
+
+// Блок из 4 элементов a сравнивается со всеми 4 элементами блока b за 4 сравнения (b сдвигается по кругу).
+// Продвигается блок с меньшим максимумом; совпадения блока a копятся в mask, пока он не пройден.
+__attribute__((target("sse4.2")))
+void BlockMergeSse42(const int* a, size_t a_size, const int* b, size_t b_size,
+                     bool keep_matched, std::pmr::vector<uint32_t>& out) {
+    size_t i = 0;
+    size_t j = 0;
+    unsigned mask = 0;
+    while (i + 4 <= a_size && j + 4 <= b_size) {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+        __m128i equal = _mm_cmpeq_epi32(va, vb);
+        equal = _mm_or_si128(equal, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+        equal = _mm_or_si128(equal, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+        equal = _mm_or_si128(equal, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+        mask |= static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(equal)));
+
+        const int a_max = a[i + 3];
+        const int b_max = b[j + 3];
+        if (a_max <= b_max) {
+            EmitBlock(i, 4, mask, keep_matched, out);
+            i += 4;
+            mask = 0;
+        }
+        if (b_max <= a_max) {
+            j += 4;
+        }
+    }
+    FinishBlockMerge(a, a_size, b, b_size, i, j, 4, mask, keep_matched, out);
+}
+
+// То же для блоков из 8 элементов: 8 сравнений с циклическими сдвигами блока b
+__attribute__((target("avx2")))
+void BlockMergeAvx2(const int* a, size_t a_size, const int* b, size_t b_size,
+                    bool keep_matched, std::pmr::vector<uint32_t>& out) {
+    const __m256i rotate1 = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+    const __m256i rotate2 = _mm256_setr_epi32(2, 3, 4, 5, 6, 7, 0, 1);
+    const __m256i rotate3 = _mm256_setr_epi32(3, 4, 5, 6, 7, 0, 1, 2);
+    const __m256i rotate4 = _mm256_setr_epi32(4, 5, 6, 7, 0, 1, 2, 3);
+    const __m256i rotate5 = _mm256_setr_epi32(5, 6, 7, 0, 1, 2, 3, 4);
+    const __m256i rotate6 = _mm256_setr_epi32(6, 7, 0, 1, 2, 3, 4, 5);
+    const __m256i rotate7 = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
+
+    size_t i = 0;
+    size_t j = 0;
+    unsigned mask = 0;
+    while (i + 8 <= a_size && j + 8 <= b_size) {
+        const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j));
+        __m256i equal = _mm256_cmpeq_epi32(va, vb);
+        equal = _mm256_or_si256(equal, _mm256_cmpeq_epi32(va, _mm256_permutevar8x32_epi32(vb, rotate1)));
+        equal = _mm256_or_si256(equal, _mm256_cmpeq_epi32(va, _mm256_permutevar8x32_epi32(vb, rotate2)));
+        equal = _mm256_or_si256(equal, _mm256_cmpeq_epi32(va, _mm256_permutevar8x32_epi32(vb, rotate3)));
+        equal = _mm256_or_si256(equal, _mm256_cmpeq_epi32(va, _mm256_permutevar8x32_epi32(vb, rotate4)));
+        equal = _mm256_or_si256(equal, _mm256_cmpeq_epi32(va, _mm256_permutevar8x32_epi32(vb, rotate5)));
+        equal = _mm256_or_si256(equal, _mm256_cmpeq_epi32(va, _mm256_permutevar8x32_epi32(vb, rotate6)));
+        equal = _mm256_or_si256(equal, _mm256_cmpeq_epi32(va, _mm256_permutevar8x32_epi32(vb, rotate7)));
+        mask |= static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(equal)));
+
+        const int a_max = a[i + 7];
+        const int b_max = b[j + 7];
+        if (a_max <= b_max) {
+            EmitBlock(i, 8, mask, keep_matched, out);
+            i += 8;
+            mask = 0;
+        }
+        if (b_max <= a_max) {
+            j += 8;
+        }
+    }
+    FinishBlockMerge(a, a_size, b, b_size, i, j, 8, mask, keep_matched, out);
+}
+
+#endif  // POSTING_SET_OPERATIONS_X86
+
+SetOperationsKernel DetectKernel() {
+#ifdef POSTING_SET_OPERATIONS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SetOperationsKernel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return SetOperationsKernel::SSE42;
+    }
+#endif
+    return SetOperationsKernel::SCALAR;
+}
+
+SetOperationsKernel GetSupportedKernel() {
+    static const SetOperationsKernel supported_kernel = DetectKernel();
+    return supported_kernel;
+}
+
+std::atomic<SetOperationsKernel>& ActiveKernel() {
+    static std::atomic<SetOperationsKernel> active_kernel(GetSupportedKernel());
+    return active_kernel;
+}
+
+void BlockMerge(const int* a, size_t a_size, const int* b, size_t b_size, bool keep_matched,
+                std::pmr::vector<uint32_t>& out) {
+    switch (ActiveKernel().load(std::memory_order_relaxed)) {
+#ifdef POSTING_SET_OPERATIONS_X86
+    case SetOperationsKernel::AVX2:
+        BlockMergeAvx2(a, a_size, b, b_size, keep_matched, out);
+        return;
+    case SetOperationsKernel::SSE42:
+        BlockMergeSse42(a, a_size, b, b_size, keep_matched, out);
+        return;
+#endif
+    default:
+        ScalarMerge(a, a_size, b, b_size, 0, 0, keep_matched, out);
+    }
+}
+
+}  // namespace
+
+void IntersectSorted(const int* a, size_t a_size, const int* b, size_t b_size, std::pmr::vector<uint32_t>& out) {
+    if (a_size == 0 || b_size == 0) {
+        return;
+    }
+    if (a_size * GALLOP_RATIO < b_size) {
+        GallopIntersectSmallFirst(a, a_size, b, b_size, out);
+    }
+    else if (b_size * GALLOP_RATIO < a_size) {
+        GallopIntersectSmallSecond(a, a_size, b, b_size, out);
+    }
+    else {
+        BlockMerge(a, a_size, b, b_size, true, out);
+    }
+}
+
+void DifferenceSorted(const int* a, size_t a_size, const int* b, size_t b_size, std::pmr::vector<uint32_t>& out) {
+    if (a_size * GALLOP_RATIO < b_size) {
+        GallopDifferenceSmallFirst(a, a_size, b, b_size, out);
+    }
+    else if (b_size * GALLOP_RATIO < a_size) {
+        GallopDifferenceSmallSecond(a, a_size, b, b_size, out);
+    }
+    else {
+        BlockMerge(a, a_size, b, b_size, false, out);
+    }
+}
+
+void UnionSorted(const int* a, size_t a_size, const int* b, size_t b_size, std::pmr::vector<int>& out) {
+    if (a_size < b_size) {
+        std::swap(a, b);
+        std::swap(a_size, b_size);
+    }
+    out.reserve(out.size() + a_size + b_size);
+    if (b_size * GALLOP_RATIO >= a_size) {
+        std::set_union(a, a + a_size, b, b + b_size, std::back_inserter(out));
+        return;
+    }
+    // Короткий массив вставляется в длинный: отрезки длинного между его элементами копируются целиком
+    size_t i = 0;
+    for (size_t j = 0; j < b_size; ++j) {
+        size_t next = GallopLowerBound(a, a_size, i, b[j]);
+        out.insert(out.end(), a + i, a + next);
+        if (next < a_size && a[next] == b[j]) {
+            ++next;
+        }
+        out.push_back(b[j]);
+        i = next;
+    }
+    out.insert(out.end(), a + i, a + a_size);
+}
+
+SetOperationsKernel GetSetOperationsKernel() {
+    return ActiveKernel().load();
+}
+
+void SetSetOperationsKernel(SetOperationsKernel kernel) {
+    ActiveKernel().store(std::min(kernel, GetSupportedKernel()));
+}
+
+const char* GetSetOperationsKernelName(SetOperationsKernel kernel) {
+    switch (kernel) {
+    case SetOperationsKernel::AVX2:
+        return "avx2";
+    case SetOperationsKernel::SSE42:
+        return "sse4.2";
+    default:
+        return "scalar";
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// Операции над отсортированными по возрастанию массивами номеров документов без повторов.
+// Пересечение и разность выбирают элементы первого массива и возвращают их позиции в нем
+// (по позициям вызывающий берет из параллельных массивов TF). Объединение возвращает сами значения.
+// Результат дописывается в конец out.
+//
+// Если один массив намного короче другого, используется поиск галопом по длинному массиву,
+// иначе - поблочное сравнение AVX2 или SSE4.2 (набор команд выбирается один раз при первом вызове)
+// либо обычное слияние, если процессор их не поддерживает.
+
+// Позиции элементов a, которые есть в b
+void IntersectSorted(const int* a, size_t a_size, const int* b, size_t b_size, std::pmr::vector<uint32_t>& out);
+
+// Позиции элементов a, которых нет в b
+void DifferenceSorted(const int* a, size_t a_size, const int* b, size_t b_size, std::pmr::vector<uint32_t>& out);
+
+// Значения из a или b
+void UnionSorted(const int* a, size_t a_size, const int* b, size_t b_size, std::pmr::vector<int>& out);
+
+// Обертки для контейнеров с data() и size() (std::vector, std::pmr::vector)
+template <typename LhsIds, typename RhsIds>
+void IntersectSorted(const LhsIds& a, const RhsIds& b, std::pmr::vector<uint32_t>& out) {
+    IntersectSorted(a.data(), a.size(), b.data(), b.size(), out);
+}
+
+template <typename LhsIds, typename RhsIds>
+void DifferenceSorted(const LhsIds& a, const RhsIds& b, std::pmr::vector<uint32_t>& out) {
+    DifferenceSorted(a.data(), a.size(), b.data(), b.size(), out);
+}
+
+template <typename LhsIds, typename RhsIds>
+void UnionSorted(const LhsIds& a, const RhsIds& b, std::pmr::vector<int>& out) {
+    UnionSorted(a.data(), a.size(), b.data(), b.size(), out);
+}
+
+enum class SetOperationsKernel {
+    SCALAR,
+    SSE42,
+    AVX2,
+};
+
+// Набор команд, выбранный для поблочного сравнения
+SetOperationsKernel GetSetOperationsKernel();
+
+// Принудительный выбор набора команд (для сравнения реализаций). Набор, который процессор
+// не поддерживает, заменяется лучшим доступным. Не потокобезопасно относительно идущих операций.
+void SetSetOperationsKernel(SetOperationsKernel kernel);
+
+const char* GetSetOperationsKernelName(SetOperationsKernel kernel);
@@ -0,0 +1,100 @@
+#include "process_queries.h"
+#include <algorithm>
+#include <exception>
+#include <execution>
+#include <numeric>
+
+JoinedDocuments::Iterator::Iterator(const std::vector<std::vector<Document>>* results, size_t query_index,
+                                    size_t document_index)
+    : results_(results), query_index_(query_index), document_index_(document_index) {
+    SkipEmpty();
+}
+
+JoinedDocuments::Iterator::reference JoinedDocuments::Iterator::operator*() const {
+    return (*results_)[query_index_][document_index_];
+}
+
+JoinedDocuments::Iterator::pointer JoinedDocuments::Iterator::operator->() const {
+    return &**this;
+}
+
+JoinedDocuments::Iterator& JoinedDocuments::Iterator::operator++() {
+    ++document_index_;
+    SkipEmpty();
+    return *this;
+}
+
+JoinedDocuments::Iterator JoinedDocuments::Iterator::operator++(int) {
+    Iterator old = *this;
+    ++*this;
+    return old;
+}
+
+bool JoinedDocuments::Iterator::operator==(const Iterator& other) const {
+    return results_ == other.results_ && query_index_ == other.query_index_
+        && document_index_ == other.document_index_;
+}
+
+bool JoinedDocuments::Iterator::operator!=(const Iterator& other) const {
+    return !(*this == other);
+}
+
+void JoinedDocuments::Iterator::SkipEmpty() {
+    while (query_index_ < results_->size() && document_index_ >= (*results_)[query_index_].size()) {
+        ++query_index_;
+        document_index_ = 0;
+    }
+}
+
+JoinedDocuments::JoinedDocuments(std::vector<std::vector<Document>> results)
+    : results_(std::move(results)) {
+    for (const auto& documents : results_) {
+        size_ += documents.size();
+    }
+}
+
+JoinedDocuments::Iterator JoinedDocuments::begin() const {
+    return Iterator(&results_, 0, 0);
+}
+
+JoinedDocuments::Iterator JoinedDocuments::end() const {
+    return Iterator(&results_, results_.size(), 0);
+}
+
+size_t JoinedDocuments::size() const {
+    return size_;
+}
+
+bool JoinedDocuments::empty() const {
+    return size_ == 0;
+}
+
+std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server,
+                                                  const std::vector<std::string>& queries) {
+    std::vector<std::vector<Document>> results(queries.size());
+    // Исключение, вышедшее из параллельного алгоритма, завершило бы программу, поэтому ошибка каждого запроса
+    // запоминается рядом с его результатом и бросается уже после параллельного шага
+    std::vector<std::exception_ptr> errors(queries.size());
+    std::vector<size_t> indexes(queries.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(),
+        [&search_server, &queries, &results, &errors](size_t index) {
+            try {
+                results[index] = search_server.FindTopDocuments(queries[index]);
+            }
+            catch (...) {
+                errors[index] = std::current_exception();
+            }
+        });
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    return results;
+}
+
+JoinedDocuments ProcessQueriesJoined(const SearchServer& search_server,
+                                     const std::vector<std::string>& queries) {
+    return JoinedDocuments(ProcessQueries(search_server, queries));
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <iterator>
+#include <string>
+#include <vector>
+#include "document.h"
+#include "search_server.h"
+
+// Результаты пакета запросов, склеенные в одну последовательность документов.
+// Документы не копируются: обход идет по вложенным векторам, полученным от ProcessQueries.
+class JoinedDocuments {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Document;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Document*;
+        using reference = const Document&;
+
+        Iterator(const std::vector<std::vector<Document>>* results, size_t query_index, size_t document_index);
+
+        reference operator*() const;
+        pointer operator->() const;
+        Iterator& operator++();
+        Iterator operator++(int);
+
+        bool operator==(const Iterator& other) const;
+        bool operator!=(const Iterator& other) const;
+
+    private:
+        // Пропускаем запросы без результатов, чтобы итератор всегда указывал на документ или на конец
+        void SkipEmpty();
+
+        const std::vector<std::vector<Document>>* results_;
+        size_t query_index_;
+        size_t document_index_;
+    };
+
+    explicit JoinedDocuments(std::vector<std::vector<Document>> results);
+
+    Iterator begin() const;
+    Iterator end() const;
+
+    size_t size() const;
+    bool empty() const;
+
+private:
+    std::vector<std::vector<Document>> results_;
+    size_t size_ = 0;
+};
+
+// Параллельно выполняет FindTopDocuments для каждого запроса. Результаты идут в порядке запросов.
+// Если некорректны какие-то запросы, бросается исключение первого из них (по порядку в queries).
+std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server,
+                                                  const std::vector<std::string>& queries);
+
+// То же, что ProcessQueries, но результаты всех запросов идут подряд одной последовательностью
+JoinedDocuments ProcessQueriesJoined(const SearchServer& search_server,
+                                     const std::vector<std::string>& queries);
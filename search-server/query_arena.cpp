@@ -0,0 +1,87 @@
+#include "query_arena.h"
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+std::atomic<size_t> total_upstream_allocation_count(0);
+
+}  // namespace
+
+QueryArena& QueryArena::ForCurrentThread() {
+    thread_local QueryArena arena;
+    return arena;
+}
+
+size_t QueryArena::GetTotalUpstreamAllocationCount() {
+    return total_upstream_allocation_count.load(std::memory_order_relaxed);
+}
+
+void QueryArena::Reset() {
+    used_ = 0;
+    ++stats_.reset_count;
+    if (blocks_.size() <= 1) {
+        return;
+    }
+    const size_t retained_size = std::min(stats_.capacity, QUERY_ARENA_MAX_RETAINED);
+    blocks_.clear();
+    stats_.capacity = 0;
+    AddBlock(retained_size);
+}
+
+QueryArena::Stats QueryArena::GetStats() const {
+    return stats_;
+}
+
+void* QueryArena::do_allocate(size_t bytes, size_t alignment) {
+    ++stats_.allocation_count;
+    if (!blocks_.empty()) {
+        Block& block = blocks_.back();
+        void* pointer = block.data.get() + used_;
+        size_t space = block.size - used_;
+        if (std::align(alignment, bytes, pointer, space)) {
+            used_ = static_cast<std::byte*>(pointer) - block.data.get() + bytes;
+            return pointer;
+        }
+    }
+    // Блоки растут вдвое, чтобы большой запрос не брал много мелких блоков
+    const size_t last_size = blocks_.empty() ? QUERY_ARENA_INITIAL_SIZE / 2 : blocks_.back().size;
+    AddBlock(std::max(last_size * 2, bytes + alignment));
+    Block& block = blocks_.back();
+    void* pointer = block.data.get();
+    size_t space = block.size;
+    std::align(alignment, bytes, pointer, space);
+    used_ = static_cast<std::byte*>(pointer) - block.data.get() + bytes;
+    return pointer;
+}
+
+void QueryArena::do_deallocate(void*, size_t, size_t) {
+}
+
+bool QueryArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+void QueryArena::AddBlock(size_t size) {
+    // Без make_unique: обнулять блок не нужно
+    blocks_.push_back({ std::unique_ptr<std::byte[]>(new std::byte[size]), size });
+    used_ = 0;
+    stats_.capacity += size;
+    ++stats_.upstream_allocation_count;
+    total_upstream_allocation_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+QueryArenaScope::QueryArenaScope()
+    : arena_(QueryArena::ForCurrentThread()) {
+    ++arena_.scope_depth_;
+}
+
+QueryArenaScope::~QueryArenaScope() {
+    if (--arena_.scope_depth_ == 0) {
+        arena_.Reset();
+    }
+}
+
+std::pmr::memory_resource* QueryArenaScope::GetResource() const {
+    return &arena_;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+const size_t QUERY_ARENA_INITIAL_SIZE = 64 * 1024;  // первый блок арены, байт
+const size_t QUERY_ARENA_MAX_RETAINED = 16 * 1024 * 1024;  // больше этого арена между запросами не держит
+
+// Память для временных контейнеров одного запроса. Выделение - сдвиг указателя в текущем блоке,
+// освобождение ничего не делает, вся память возвращается разом в Reset. Если запрос не уместился в блок,
+// новый блок берется у operator new, а при Reset блоки заменяются одним блоком их общего размера,
+// поэтому следующие запросы того же размера в глобальную кучу не обращаются.
+// У каждого потока своя арена, и блокировок нет; память арены нельзя отдавать в другие потоки.
+class QueryArena : public std::pmr::memory_resource {
+public:
+    struct Stats {
+        size_t allocation_count = 0;  // выделений из арены
+        size_t upstream_allocation_count = 0;  // блоков, взятых у operator new
+        size_t reset_count = 0;
+        size_t capacity = 0;  // байт в блоках арены
+    };
+
+    QueryArena() = default;
+    QueryArena(const QueryArena&) = delete;
+    QueryArena& operator=(const QueryArena&) = delete;
+
+    // Арена текущего потока
+    static QueryArena& ForCurrentThread();
+
+    // Блоки, взятые у operator new всеми аренами программы
+    static size_t GetTotalUpstreamAllocationCount();
+
+    // Делает всю память арены снова свободной. Контейнеры на арене к этому моменту должны быть разрушены.
+    void Reset();
+
+    Stats GetStats() const;
+
+private:
+    friend class QueryArenaScope;
+
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    void AddBlock(size_t size);
+
+    std::vector<Block> blocks_;
+    size_t used_ = 0;  // занято в последнем блоке
+    size_t scope_depth_ = 0;
+    Stats stats_;
+};
+
+// Область одного запроса: арена потока сбрасывается, когда закрывается самая внешняя область.
+// Контейнеры на арене объявляются после области, чтобы разрушиться раньше нее.
+class QueryArenaScope {
+public:
+    QueryArenaScope();
+    ~QueryArenaScope();
+
+    QueryArenaScope(const QueryArenaScope&) = delete;
+    QueryArenaScope& operator=(const QueryArenaScope&) = delete;
+
+    std::pmr::memory_resource* GetResource() const;
+
+private:
+    QueryArena& arena_;
+};
@@ -0,0 +1,83 @@
+#include "query_cache.h"
+#include <functional>
+#include <stdexcept>
+
+QueryCache::QueryCache(const SearchServer& search_server, size_t capacity, size_t shard_count)
+    : search_server_(search_server)
+    , shard_capacity_(shard_count == 0 ? 0 : (capacity + shard_count - 1) / shard_count)
+    , shards_(shard_count) {
+    if (capacity == 0 || shard_count == 0) {
+        throw std::invalid_argument("cache capacity and shard count must be positive");
+    }
+}
+
+std::vector<Document> QueryCache::FindTopDocuments(std::string_view raw_query, DocumentStatus status) {
+    return FindTopDocumentsImpl(raw_query, MakeKey(raw_query, "status", std::to_string(static_cast<int>(status))),
+                                status);
+}
+
+uint64_t QueryCache::GetHits() const {
+    return hits_;
+}
+
+uint64_t QueryCache::GetMisses() const {
+    return misses_;
+}
+
+void QueryCache::Clear() {
+    for (Shard& shard : shards_) {
+        std::lock_guard guard(shard.mutex);
+        shard.positions.clear();
+        shard.entries.clear();
+    }
+}
+
+std::string QueryCache::MakeKey(std::string_view raw_query, std::string_view filter_kind,
+                               std::string_view filter) const {
+    std::string key = search_server_.GetCanonicalQuery(raw_query);
+    key.push_back('\0');
+    key.append(filter_kind);
+    key.push_back('\0');
+    key.append(filter);
+    return key;
+}
+
+QueryCache::Shard& QueryCache::GetShard(const std::string& key) {
+    return shards_[std::hash<std::string>{}(key) % shards_.size()];
+}
+
+bool QueryCache::Lookup(const std::string& key, std::vector<Document>& documents) {
+    Shard& shard = GetShard(key);
+    std::lock_guard guard(shard.mutex);
+    const auto position_it = shard.positions.find(key);
+    if (position_it == shard.positions.end()) {
+        return false;
+    }
+    const auto entry_it = position_it->second;
+    if (entry_it->second.index_version != search_server_.GetIndexVersion()) {
+        // Индекс изменился после расчета записи
+        shard.positions.erase(position_it);
+        shard.entries.erase(entry_it);
+        return false;
+    }
+    shard.entries.splice(shard.entries.begin(), shard.entries, entry_it);
+    documents = entry_it->second.documents;
+    return true;
+}
+
+void QueryCache::Store(std::string key, const std::vector<Document>& documents, uint64_t index_version) {
+    Shard& shard = GetShard(key);
+    std::lock_guard guard(shard.mutex);
+    // Запись могла появиться, пока этот поток искал сам
+    if (const auto position_it = shard.positions.find(key); position_it != shard.positions.end()) {
+        const auto entry_it = position_it->second;
+        shard.positions.erase(position_it);
+        shard.entries.erase(entry_it);
+    }
+    shard.entries.emplace_front(std::move(key), Entry{ index_version, documents });
+    shard.positions.emplace(shard.entries.front().first, shard.entries.begin());
+    if (shard.entries.size() > shard_capacity_) {
+        shard.positions.erase(shard.entries.back().first);
+        shard.entries.pop_back();
+    }
+}
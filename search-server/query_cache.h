@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "document.h"
+#include "search_server.h"
+
+// LRU-кеш результатов FindTopDocuments перед SearchServer.
+// Ключ - канонический вид запроса (SearchServer::GetCanonicalQuery) и метка фильтра, поэтому запросы,
+// отличающиеся порядком слов, повторами или стоп-словами, попадают в одну запись.
+// Запись помнит версию индекса, на которой посчитана: любое AddDocument/RemoveDocument меняет число документов,
+// а с ним IDF всех слов, поэтому после изменения индекса устаревшая запись считается промахом и пересчитывается.
+// Кеш разбит на шарды со своим мьютексом, читать можно из многих потоков (пока индекс не меняется).
+class QueryCache {
+public:
+    QueryCache(const SearchServer& search_server, size_t capacity, size_t shard_count = 16);
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL);
+
+    // Произвольный предикат кешируется под меткой predicate_tag: одна метка - один и тот же фильтр
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, std::string_view predicate_tag,
+                                           DocumentPredicate predicate);
+
+    uint64_t GetHits() const;
+    uint64_t GetMisses() const;
+
+    void Clear();
+
+private:
+    struct Entry {
+        uint64_t index_version;
+        std::vector<Document> documents;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<std::pair<std::string, Entry>> entries;  // от недавно использованных к давним
+        std::unordered_map<std::string_view, std::list<std::pair<std::string, Entry>>::iterator> positions;
+    };
+
+    // Канонический запрос, вид фильтра (статус или метка предиката) и сам фильтр: статус и метка
+    // с тем же текстом дают разные ключи
+    std::string MakeKey(std::string_view raw_query, std::string_view filter_kind, std::string_view filter) const;
+    Shard& GetShard(const std::string& key);
+
+    template <typename DocumentFilter>
+    std::vector<Document> FindTopDocumentsImpl(std::string_view raw_query, std::string key, DocumentFilter filter);
+
+    // Возвращает true и результат, если в кеше есть свежая запись
+    bool Lookup(const std::string& key, std::vector<Document>& documents);
+    void Store(std::string key, const std::vector<Document>& documents, uint64_t index_version);
+
+    const SearchServer& search_server_;
+    size_t shard_capacity_;
+    std::vector<Shard> shards_;
+    std::atomic<uint64_t> hits_ = 0;
+    std::atomic<uint64_t> misses_ = 0;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> QueryCache::FindTopDocuments(std::string_view raw_query, std::string_view predicate_tag,
+                                                   DocumentPredicate predicate) {
+    return FindTopDocumentsImpl(raw_query, MakeKey(raw_query, "predicate", predicate_tag), predicate);
+}
+
+template <typename DocumentFilter>
+std::vector<Document> QueryCache::FindTopDocumentsImpl(std::string_view raw_query, std::string key,
+                                                       DocumentFilter filter) {
+    std::vector<Document> documents;
+    if (Lookup(key, documents)) {
+        ++hits_;
+        return documents;
+    }
+    ++misses_;
+    const uint64_t index_version = search_server_.GetIndexVersion();
+    documents = search_server_.FindTopDocuments(raw_query, filter);
+    Store(std::move(key), documents, index_version);
+    return documents;
+}
@@ -0,0 +1,197 @@
+#include "query_stats.h"
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace {
+
+std::atomic<uint64_t> next_recorder_id(0);
+
+// Ячейки владельца, который пишет только сам: чтение и запись по отдельности дешевле атомарного сложения
+void AddOwned(std::atomic<uint64_t>& value, uint64_t delta) {
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+std::string_view GetQueryPhaseName(QueryPhase phase) {
+    switch (phase) {
+    case QueryPhase::PARSE:
+        return "parse";
+    case QueryPhase::POSTING_SCAN:
+        return "posting scan";
+    case QueryPhase::MINUS_FILTER:
+        return "minus filter";
+    case QueryPhase::TOP_K:
+        return "top-k";
+    case QueryPhase::RESULT_BUILD:
+        return "result build";
+    }
+    return "unknown";
+}
+
+std::string_view GetQueryCounterName(QueryCounter counter) {
+    switch (counter) {
+    case QueryCounter::POSTINGS_TOUCHED:
+        return "postings touched";
+    case QueryCounter::PREDICATE_CALLS:
+        return "predicate calls";
+    case QueryCounter::ERASED_BY_MINUS_WORDS:
+        return "erased by minus words";
+    case QueryCounter::MATCHED_DOCUMENTS:
+        return "matched documents";
+    case QueryCounter::ARENA_ALLOCATIONS:
+        return "arena allocations";
+    case QueryCounter::HEAP_ALLOCATIONS:
+        return "heap allocations";
+    }
+    return "unknown";
+}
+
+bool QueryTrace::IsTimed() const {
+    return is_timed_;
+}
+
+std::chrono::nanoseconds QueryTrace::GetPhaseTime(QueryPhase phase) const {
+    return phase_times_[static_cast<size_t>(phase)];
+}
+
+std::chrono::nanoseconds QueryTrace::GetTotalTime() const {
+    std::chrono::nanoseconds total_time{};
+    for (const auto phase_time : phase_times_) {
+        total_time += phase_time;
+    }
+    return total_time;
+}
+
+uint64_t QueryTrace::GetCounter(QueryCounter counter) const {
+    return counters_[static_cast<size_t>(counter)];
+}
+
+size_t LatencyHistogram::GetBucket(std::chrono::nanoseconds duration) {
+    if (duration.count() <= 0) {
+        return 0;
+    }
+    const auto nanoseconds = static_cast<uint64_t>(duration.count());
+#if defined(__GNUC__)
+    const size_t bucket = 64 - __builtin_clzll(nanoseconds);
+#else
+    size_t bucket = 0;
+    for (uint64_t rest = nanoseconds; rest > 0; rest >>= 1) {
+        ++bucket;
+    }
+#endif
+    return std::min(bucket, BUCKET_COUNT - 1);
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+    uint64_t count = 0;
+    for (const uint64_t bucket_count : buckets_) {
+        count += bucket_count;
+    }
+    return count;
+}
+
+uint64_t LatencyHistogram::GetBucketCount(size_t bucket) const {
+    return buckets_[bucket];
+}
+
+std::chrono::nanoseconds LatencyHistogram::GetQuantile(double quantile) const {
+    const uint64_t count = GetCount();
+    if (count == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    const auto rank = static_cast<uint64_t>(quantile * static_cast<double>(count - 1));
+    uint64_t seen = 0;
+    size_t bucket = 0;
+    for (; bucket + 1 < BUCKET_COUNT; ++bucket) {
+        seen += buckets_[bucket];
+        if (seen > rank) {
+            break;
+        }
+    }
+    return std::chrono::nanoseconds(bucket == 0 ? 0 : int64_t(1) << bucket);
+}
+
+void LatencyHistogram::Add(size_t bucket, uint64_t count) {
+    buckets_[bucket] += count;
+}
+
+QueryStatsRecorder::QueryStatsRecorder()
+    : id_(next_recorder_id.fetch_add(1, std::memory_order_relaxed)) {
+}
+
+QueryStatsRecorder::Slot& QueryStatsRecorder::GetThreadSlot() {
+    // Обычно поток раз за разом пишет в один сервер, поэтому последняя ячейка проверяется до таблицы
+    thread_local uint64_t last_id = std::numeric_limits<uint64_t>::max();
+    thread_local Slot* last_slot = nullptr;
+    if (last_id == id_) {
+        return *last_slot;
+    }
+    // Записи удаленных объектов вычищаются, когда таблица вырастает вдвое с прошлой чистки
+    auto& thread_slots = GetThreadSlots();
+    thread_local size_t prune_size = 16;
+    auto it = thread_slots.find(id_);
+    if (it == thread_slots.end()) {
+        if (thread_slots.size() >= prune_size) {
+            for (auto entry = thread_slots.begin(); entry != thread_slots.end();) {
+                entry = entry->second.alive.expired() ? thread_slots.erase(entry) : std::next(entry);
+            }
+            prune_size = std::max<size_t>(16, thread_slots.size() * 2);
+        }
+        std::lock_guard guard(slots_mutex_);
+        it = thread_slots.emplace(id_, ThreadSlot{ alive_, &slots_.emplace_back() }).first;
+    }
+    last_id = id_;
+    last_slot = it->second.slot;
+    return *last_slot;
+}
+
+std::unordered_map<uint64_t, QueryStatsRecorder::ThreadSlot>& QueryStatsRecorder::GetThreadSlots() {
+    thread_local std::unordered_map<uint64_t, ThreadSlot> thread_slots;
+    return thread_slots;
+}
+
+size_t QueryStatsRecorder::GetThreadTableSize() {
+    return GetThreadSlots().size();
+}
+
+void QueryStatsRecorder::Record(const QueryTrace& trace) {
+    Slot& slot = GetThreadSlot();
+    AddOwned(slot.query_count, 1);
+    for (size_t counter = 0; counter < QUERY_COUNTER_COUNT; ++counter) {
+        AddOwned(slot.counters[counter], trace.GetCounter(static_cast<QueryCounter>(counter)));
+    }
+    if (!trace.IsTimed()) {
+        return;
+    }
+    AddOwned(slot.timed_query_count, 1);
+    for (size_t phase = 0; phase < QUERY_PHASE_COUNT; ++phase) {
+        const auto phase_time = trace.GetPhaseTime(static_cast<QueryPhase>(phase));
+        AddOwned(slot.phase_nanoseconds[phase], phase_time.count());
+        AddOwned(slot.phase_latency[phase][LatencyHistogram::GetBucket(phase_time)], 1);
+    }
+    AddOwned(slot.query_latency[LatencyHistogram::GetBucket(trace.GetTotalTime())], 1);
+}
+
+SearchStats QueryStatsRecorder::GetStats() const {
+    SearchStats stats;
+    std::lock_guard guard(slots_mutex_);
+    for (const Slot& slot : slots_) {
+        stats.query_count += slot.query_count.load(std::memory_order_relaxed);
+        stats.timed_query_count += slot.timed_query_count.load(std::memory_order_relaxed);
+        for (size_t phase = 0; phase < QUERY_PHASE_COUNT; ++phase) {
+            stats.phase_times[phase] += std::chrono::nanoseconds(slot.phase_nanoseconds[phase].load(std::memory_order_relaxed));
+            for (size_t bucket = 0; bucket < LatencyHistogram::BUCKET_COUNT; ++bucket) {
+                stats.phase_latency[phase].Add(bucket, slot.phase_latency[phase][bucket].load(std::memory_order_relaxed));
+            }
+        }
+        for (size_t counter = 0; counter < QUERY_COUNTER_COUNT; ++counter) {
+            stats.counters[counter] += slot.counters[counter].load(std::memory_order_relaxed);
+        }
+        for (size_t bucket = 0; bucket < LatencyHistogram::BUCKET_COUNT; ++bucket) {
+            stats.query_latency.Add(bucket, slot.query_latency[bucket].load(std::memory_order_relaxed));
+        }
+    }
+    return stats;
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+// 1 - поиск собирает время фаз и счетчики, 0 - сбор вырезается при компиляции (QueryTrace остается нулевым).
+// Задается опцией CMake SEARCH_SERVER_STATS.
+#ifndef SEARCH_SERVER_STATS
+#define SEARCH_SERVER_STATS 1
+#endif
+
+constexpr bool QUERY_STATS_ENABLED = SEARCH_SERVER_STATS != 0;
+
+// Чтение часов сравнимо по цене с коротким запросом, поэтому для GetStats время замеряется у каждого
+// QUERY_TIMING_SAMPLE_PERIOD-го запроса потока (степень двойки); счетчики собираются у всех запросов.
+// Запрос с переданным QueryTrace замеряется всегда.
+const uint32_t QUERY_TIMING_SAMPLE_PERIOD = 16;
+
+// Фазы FindTopDocuments. Фазы идут одна за другой, и время каждой - от конца предыдущей,
+// поэтому на границу фаз приходится одно чтение часов.
+enum class QueryPhase {
+    PARSE,  // разбор запроса
+    POSTING_SCAN,  // обход списков вхождений и подсчет релевантности
+    MINUS_FILTER,  // сбор документов с минус-словами
+    TOP_K,  // отбор лучших
+    RESULT_BUILD,  // копирование результата
+};
+const size_t QUERY_PHASE_COUNT = 5;
+
+enum class QueryCounter {
+    POSTINGS_TOUCHED,  // вхождений плюс-слов, прочитанных при подсчете релевантности
+    PREDICATE_CALLS,  // вызовов предиката (фильтр по статусу предикат не вызывает)
+    ERASED_BY_MINUS_WORDS,  // вхождений плюс-слов (в режиме ALL_WORDS - документов), отброшенных минус-словами
+    MATCHED_DOCUMENTS,  // документов-кандидатов до отбора лучших
+    ARENA_ALLOCATIONS,  // выделений из арены запроса
+    HEAP_ALLOCATIONS,  // блоков арены, взятых у operator new
+};
+const size_t QUERY_COUNTER_COUNT = 6;
+
+std::string_view GetQueryPhaseName(QueryPhase phase);
+std::string_view GetQueryCounterName(QueryCounter counter);
+
+// Время фаз и счетчики одного запроса
+class QueryTrace {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // У незамеряемого запроса (is_timed == false) время фаз остается нулевым
+    explicit QueryTrace(bool is_timed = true);
+
+    bool IsTimed() const;
+    std::chrono::nanoseconds GetPhaseTime(QueryPhase phase) const;
+    std::chrono::nanoseconds GetTotalTime() const;
+    uint64_t GetCounter(QueryCounter counter) const;
+
+    // Начало первой фазы
+    void Start();
+
+    // Время с конца предыдущей фазы относится к phase
+    void FinishPhase(QueryPhase phase);
+
+    void Add(QueryCounter counter, uint64_t value);
+
+private:
+    std::array<std::chrono::nanoseconds, QUERY_PHASE_COUNT> phase_times_{};
+    std::array<uint64_t, QUERY_COUNTER_COUNT> counters_{};
+    Clock::time_point phase_start_;
+    bool is_timed_;
+};
+
+// Число длительностей по корзинам: в корзине i - от 2^(i-1) до 2^i наносекунд
+class LatencyHistogram {
+public:
+    static const size_t BUCKET_COUNT = 40;
+
+    static size_t GetBucket(std::chrono::nanoseconds duration);
+
+    uint64_t GetCount() const;
+    uint64_t GetBucketCount(size_t bucket) const;
+
+    // Верхняя граница корзины, в которую попадает доля quantile длительностей (0 для пустой гистограммы)
+    std::chrono::nanoseconds GetQuantile(double quantile) const;
+
+    void Add(size_t bucket, uint64_t count);
+
+private:
+    std::array<uint64_t, BUCKET_COUNT> buckets_{};
+};
+
+// Сводка по всем запросам сервера. Время и гистограммы - по замеренным запросам.
+struct SearchStats {
+    uint64_t query_count = 0;
+    uint64_t timed_query_count = 0;
+    std::array<std::chrono::nanoseconds, QUERY_PHASE_COUNT> phase_times{};  // сумма по замеренным запросам
+    std::array<uint64_t, QUERY_COUNTER_COUNT> counters{};  // сумма по всем запросам
+    LatencyHistogram query_latency;
+    std::array<LatencyHistogram, QUERY_PHASE_COUNT> phase_latency;
+};
+
+// Копит QueryTrace запросов. У каждого потока своя ячейка, и пишет в нее только он сам, поэтому запись
+// обходится без блокировок и атомарных операций чтения-изменения-записи. Блокировка берется, только когда
+// поток пишет впервые (заводит ячейку) и когда GetStats складывает ячейки.
+class QueryStatsRecorder {
+public:
+    QueryStatsRecorder();
+    QueryStatsRecorder(const QueryStatsRecorder&) = delete;
+    QueryStatsRecorder& operator=(const QueryStatsRecorder&) = delete;
+
+    // Замерять ли время очередного запроса текущего потока (см. QUERY_TIMING_SAMPLE_PERIOD)
+    static bool ShouldTimeQuery();
+
+    void Record(const QueryTrace& trace);
+
+    SearchStats GetStats() const;
+
+    // Записей в таблице ячеек текущего потока: объекты, в которые он писал, включая удаленные до очередной чистки
+    static size_t GetThreadTableSize();
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> query_count{0};
+        std::atomic<uint64_t> timed_query_count{0};
+        std::array<std::atomic<uint64_t>, QUERY_PHASE_COUNT> phase_nanoseconds{};
+        std::array<std::atomic<uint64_t>, QUERY_COUNTER_COUNT> counters{};
+        std::array<std::atomic<uint64_t>, LatencyHistogram::BUCKET_COUNT> query_latency{};
+        std::array<std::array<std::atomic<uint64_t>, LatencyHistogram::BUCKET_COUNT>, QUERY_PHASE_COUNT> phase_latency{};
+    };
+
+    struct ThreadSlot {
+        std::weak_ptr<const bool> alive;  // истек - объект удален, запись можно убрать
+        Slot* slot;
+    };
+
+    // Таблица ячеек потока по id объекта
+    static std::unordered_map<uint64_t, ThreadSlot>& GetThreadSlots();
+
+    Slot& GetThreadSlot();
+
+    const uint64_t id_;  // ячейки потока ищутся по id, а не по адресу: адрес может достаться новому объекту
+    const std::shared_ptr<const bool> alive_ = std::make_shared<const bool>(true);  // по нему потоки узнают об удалении
+    mutable std::mutex slots_mutex_;
+    std::deque<Slot> slots_;  // deque не перемещает ячейки при добавлении
+};
+
+inline QueryTrace::QueryTrace(bool is_timed)
+    : is_timed_(QUERY_STATS_ENABLED && is_timed) {
+}
+
+inline void QueryTrace::Start() {
+#if SEARCH_SERVER_STATS
+    if (is_timed_) {
+        phase_start_ = Clock::now();
+    }
+#endif
+}
+
+inline void QueryTrace::FinishPhase([[maybe_unused]] QueryPhase phase) {
+#if SEARCH_SERVER_STATS
+    if (!is_timed_) {
+        return;
+    }
+    const Clock::time_point now = Clock::now();
+    phase_times_[static_cast<size_t>(phase)] += now - phase_start_;
+    phase_start_ = now;
+#endif
+}
+
+inline void QueryTrace::Add([[maybe_unused]] QueryCounter counter, [[maybe_unused]] uint64_t value) {
+#if SEARCH_SERVER_STATS
+    counters_[static_cast<size_t>(counter)] += value;
+#endif
+}
+
+inline bool QueryStatsRecorder::ShouldTimeQuery() {
+    if constexpr (!QUERY_STATS_ENABLED) {
+        return false;
+    }
+    thread_local uint32_t query_number = 0;
+    return (query_number++ & (QUERY_TIMING_SAMPLE_PERIOD - 1)) == 0;
+}
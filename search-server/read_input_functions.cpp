@@ -1,5 +1,12 @@
 #include "read_input_functions.h"
-#include <iostream>
+#include <charconv>
+#include <chrono>
+#include <execution>
+#include <functional>
+#include <fstream>
+#include <future>
+#include <stdexcept>
+#include <string_view>
 
 std::string ReadLine() {
     std::string s;
@@ -12,4 +19,122 @@ int ReadLineWithNumber() {
     std::cin >> result;
     ReadLine();
     return result;
-}
\ No newline at end of file
+}
+
+double LoadStats::MegabytesPerSecond() const {
+    return seconds > 0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+double LoadStats::DocumentsPerSecond() const {
+    return seconds > 0 ? documents / seconds : 0.0;
+}
+
+std::ostream& operator<<(std::ostream& out, const LoadStats& stats) {
+    using namespace std::literals;
+    out << "loaded "s << stats.documents << " documents ("s << stats.bytes << " bytes) in "s
+        << stats.seconds << " s: "s << stats.MegabytesPerSecond() << " MB/s, "s
+        << stats.DocumentsPerSecond() << " docs/s"s;
+    return out;
+}
+
+namespace {
+
+struct Chunk {
+    std::vector<std::string> lines;
+    size_t first_line_number = 0;
+    size_t bytes = 0;
+};
+
+Chunk ReadChunk(std::istream& input, size_t chunk_size, size_t first_line_number) {
+    Chunk chunk;
+    chunk.first_line_number = first_line_number;
+    chunk.lines.reserve(chunk_size);
+    std::string line;
+    while (chunk.lines.size() < chunk_size && std::getline(input, line)) {
+        chunk.bytes += line.size() + 1;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        chunk.lines.push_back(std::move(line));
+        line.clear();
+    }
+    return chunk;
+}
+
+std::string_view NextField(std::string_view& line) {
+    const auto tab = line.find('\t');
+    const std::string_view field = line.substr(0, tab);
+    line.remove_prefix(tab == line.npos ? line.size() : tab + 1);
+    return field;
+}
+
+bool ParseInt(std::string_view text, int& value) {
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc() && end == text.data() + text.size();
+}
+
+RawDocument ParseDocumentLine(std::string_view line, size_t line_number) {
+    const auto fail = [line_number](const char* what) {
+        return std::invalid_argument("line " + std::to_string(line_number) + ": " + what);
+    };
+    RawDocument document;
+    if (!ParseInt(NextField(line), document.id)) {
+        throw fail("invalid document id");
+    }
+    int status = 0;
+    if (!ParseInt(NextField(line), status) || status < static_cast<int>(DocumentStatus::ACTUAL)
+        || status > static_cast<int>(DocumentStatus::REMOVED)) {
+        throw fail("invalid document status");
+    }
+    document.status = static_cast<DocumentStatus>(status);
+    for (const std::string_view rating_text : SplitIntoWords(NextField(line))) {
+        int rating = 0;
+        if (!ParseInt(rating_text, rating)) {
+            throw fail("invalid rating");
+        }
+        document.ratings.push_back(rating);
+    }
+    document.text = line;
+    return document;
+}
+
+}  // namespace
+
+LoadStats LoadDocuments(SearchServer& search_server, std::istream& input, size_t chunk_size) {
+    if (chunk_size == 0) {
+        throw std::invalid_argument("chunk size must be positive");
+    }
+    const auto start_time = std::chrono::steady_clock::now();
+    LoadStats stats;
+
+    Chunk chunk = ReadChunk(input, chunk_size, 1);
+    while (!chunk.lines.empty()) {
+        const size_t next_line_number = chunk.first_line_number + chunk.lines.size();
+        auto next_chunk = std::async(std::launch::async, ReadChunk, std::ref(input), chunk_size, next_line_number);
+
+        // Разбор служебных полей дешев и идет последовательно, текст на слова делится параллельно в AddDocuments
+        std::vector<RawDocument> documents;
+        documents.reserve(chunk.lines.size());
+        for (size_t i = 0; i < chunk.lines.size(); ++i) {
+            if (!chunk.lines[i].empty()) {
+                documents.push_back(ParseDocumentLine(chunk.lines[i], chunk.first_line_number + i));
+            }
+        }
+        search_server.AddDocuments(std::execution::par, documents);
+
+        stats.documents += documents.size();
+        stats.bytes += chunk.bytes;
+        chunk = next_chunk.get();
+    }
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    return stats;
+}
+
+LoadStats LoadDocuments(SearchServer& search_server, const std::string& path, size_t chunk_size) {
+    std::ifstream input(path);
+    if (!input) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    return LoadDocuments(search_server, input, chunk_size);
+}
@@ -1,7 +1,32 @@
 #pragma once
+#include <iostream>
 #include <string>
 #include <vector>
+#include "search_server.h"
 
 std::string ReadLine();
 
-int ReadLineWithNumber();
\ No newline at end of file
+int ReadLineWithNumber();
+
+// Итоги массовой загрузки документов
+struct LoadStats {
+    size_t documents = 0;
+    size_t bytes = 0;
+    double seconds = 0.0;
+
+    double MegabytesPerSecond() const;
+    double DocumentsPerSecond() const;
+};
+
+std::ostream& operator<<(std::ostream& out, const LoadStats& stats);
+
+// Потоковая загрузка документов. Формат строки (поля через табуляцию):
+//     id <TAB> status (число DocumentStatus) <TAB> рейтинги через пробел <TAB> текст
+// Строки читаются кусками по chunk_size. Следующий кусок читается, пока текущий разбирается на слова
+// в нескольких потоках и вносится в индекс, поэтому в памяти одновременно не больше двух кусков текста.
+// Пустые строки пропускаются, \r в конце строки отбрасывается. Ошибка формата - std::invalid_argument
+// с номером строки. Куски вносятся в индекс по одному: при ошибке в куске N куски 0..N-1 уже внесены,
+// а из куска N не вносится ни одна строка.
+LoadStats LoadDocuments(SearchServer& search_server, std::istream& input, size_t chunk_size = 4096);
+
+LoadStats LoadDocuments(SearchServer& search_server, const std::string& path, size_t chunk_size = 4096);
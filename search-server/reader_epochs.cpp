@@ -0,0 +1,35 @@
+#include "reader_epochs.h"
+#include <functional>
+#include <thread>
+
+ReaderEpochs::Guard::Guard(std::atomic<uint64_t>& slot) : slot_(slot) {
+}
+
+ReaderEpochs::Guard::~Guard() {
+    slot_.store(0);
+}
+
+ReaderEpochs::Guard ReaderEpochs::Pin() {
+    // Ячейка выбирается по потоку, чтобы разные потоки не делили одну кеш-линию; занятая - пропускается
+    const size_t first_slot = std::hash<std::thread::id>{}(std::this_thread::get_id()) % SLOT_COUNT;
+    for (size_t slot = first_slot;;) {
+        uint64_t expected = 0;
+        if (slots_[slot].epoch.compare_exchange_strong(expected, epoch_.load())) {
+            return Guard(slots_[slot].epoch);
+        }
+        slot = (slot + 1) % SLOT_COUNT;
+        // Заняты все ячейки: процессор отдается читателям, которые их освободят
+        if (slot == first_slot) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void ReaderEpochs::Synchronize() {
+    const uint64_t epoch = epoch_.fetch_add(1);
+    for (const Slot& slot : slots_) {
+        for (uint64_t value = slot.epoch.load(); value != 0 && value <= epoch; value = slot.epoch.load()) {
+            std::this_thread::yield();
+        }
+    }
+}
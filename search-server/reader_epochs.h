@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Учет читателей по эпохам (упрощенный RCU). Читатель на время чтения занимает ячейку с номером текущей эпохи:
+// одна атомарная операция на входе и одна на выходе, без блокировок и без общего счетчика ссылок.
+// Писатель, подменив общий указатель, вызывает Synchronize: она ждет, пока освободятся ячейки всех читателей,
+// вошедших до вызова, после чего старые данные никто не читает. Новые читатели уже видят новый указатель
+// и Synchronize не задерживают. Все операции seq_cst: подмена указателя упорядочена с входом читателей.
+class ReaderEpochs {
+public:
+    static const size_t SLOT_COUNT = 64;  // одновременных читателей больше этого ждут свободную ячейку, уступая процессор
+
+    // Ячейка читателя; освобождается в деструкторе
+    class Guard {
+    public:
+        explicit Guard(std::atomic<uint64_t>& slot);
+        ~Guard();
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        std::atomic<uint64_t>& slot_;
+    };
+
+    // Вход читателя. Общий указатель нужно загружать после Pin, и пока Guard жив, данные по нему не освобождаются.
+    Guard Pin();
+
+    // Ждет выхода читателей, вошедших до вызова. Нельзя вызывать из потока, который сам держит Guard.
+    void Synchronize();
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{0};  // 0 - ячейка свободна
+    };
+
+    std::atomic<uint64_t> epoch_{1};
+    std::array<Slot, SLOT_COUNT> slots_;
+};
@@ -1,18 +1,155 @@
+#include <algorithm>
+#include <cmath>
 #include <string>
+#include <thread>
 #include "request_queue.h"
 
 RequestQueue::RequestQueue(const SearchServer& search_server) : search_server_(search_server) {  
 }
 
-void RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus raw_status) {
-    return AddFindRequest(raw_query, [raw_status]([[maybe_unused]] int document_id, DocumentStatus status, int rating [[maybe_unused]] )
-        { return status == raw_status; } );
+std::vector<Document> RequestQueue::AddFindRequest(std::string_view raw_query, DocumentStatus raw_status) {
+    // Статус передается серверу как есть: для него там быстрый путь без вызова предиката
+    return AddFindRequest<DocumentStatus>(raw_query, raw_status);
 }
 
-void RequestQueue::AddFindRequest(const std::string& raw_query) {
+std::vector<Document> RequestQueue::AddFindRequest(std::string_view raw_query) {
     return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
 }
 
+void RequestQueue::AddRequestRecord(std::string_view raw_query, size_t hit_count, std::chrono::nanoseconds latency,
+                                    Clock::time_point end_time) {
+    const uint64_t sequence = next_sequence_.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = requests_[sequence % min_in_day_];
+    // Ячейку освобождает запись на круг раньше; обычно она давно дописана
+    const uint64_t previous_version = sequence >= min_in_day_ ? 2 * (sequence - min_in_day_ + 1) : 0;
+    while (slot.version.load(std::memory_order_acquire) != previous_version) {
+        std::this_thread::yield();
+    }
+    // Окно заполнено: самая старая запись уходит вместе со своим вкладом в счетчики
+    if (previous_version != 0) {
+        if (slot.hit_count.load(std::memory_order_relaxed) == 0) {
+            no_result_requests_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        const auto old_latency = std::chrono::nanoseconds(slot.latency.load(std::memory_order_relaxed));
+        latency_histogram_[GetLatencyBucket(old_latency)].fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    slot.version.store(2 * sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.timestamp.store(end_time.time_since_epoch().count(), std::memory_order_relaxed);
+    slot.latency.store(latency.count(), std::memory_order_relaxed);
+    slot.hit_count.store(static_cast<uint32_t>(std::min<size_t>(hit_count, UINT32_MAX)), std::memory_order_relaxed);
+    slot.query_hash.store(std::hash<std::string_view>{}(raw_query), std::memory_order_relaxed);
+    slot.version.store(2 * sequence + 2, std::memory_order_release);
+
+    if (hit_count == 0) {
+        no_result_requests_.fetch_add(1, std::memory_order_relaxed);
+    }
+    latency_histogram_[GetLatencyBucket(latency)].fetch_add(1, std::memory_order_relaxed);
+    recorded_count_.fetch_add(1, std::memory_order_release);
+}
+
 int RequestQueue::GetNoResultRequests() const {
-    return no_result_requests_;
-}
\ No newline at end of file
+    return std::max(no_result_requests_.load(std::memory_order_relaxed), 0);
+}
+
+double RequestQueue::GetNoResultRate() const {
+    const size_t window_size = GetWindowSize();
+    return window_size == 0 ? 0.0 : std::min(1.0, GetNoResultRequests() * 1.0 / window_size);
+}
+
+std::chrono::nanoseconds RequestQueue::GetLatencyPercentile(double percentile) const {
+    // Снимок гистограммы; во время записей его сумма может на несколько записей отличаться от окна
+    std::array<uint32_t, latency_bucket_count_> histogram;
+    size_t request_count = 0;
+    for (int bucket = 0; bucket < latency_bucket_count_; ++bucket) {
+        histogram[bucket] = latency_histogram_[bucket].load(std::memory_order_relaxed);
+        request_count += histogram[bucket];
+    }
+    if (request_count == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    // Номер запроса (с единицы), задержку которого ищем среди упорядоченных задержек окна
+    const auto rank = std::max<size_t>(1, static_cast<size_t>(std::ceil(std::clamp(percentile, 0.0, 1.0) * request_count)));
+    size_t seen = 0;
+    for (int bucket = 0; bucket < latency_bucket_count_; ++bucket) {
+        seen += histogram[bucket];
+        if (seen >= rank) {
+            return GetLatencyBucketUpperBound(bucket);
+        }
+    }
+    return GetLatencyBucketUpperBound(latency_bucket_count_ - 1);
+}
+
+double RequestQueue::GetQueriesPerSecond() const {
+    const uint64_t end = next_sequence_.load(std::memory_order_relaxed);
+    if (end < 2) {
+        return 0.0;
+    }
+    // Самая новая дописанная запись и самая старая еще не вытесненная; недописанные и вытесненные пропускаются
+    const uint64_t first = end > static_cast<uint64_t>(min_in_day_) ? end - min_in_day_ : 0;
+    Clock::time_point newest;
+    uint64_t newest_sequence = end - 1;
+    while (!ReadTimestamp(newest_sequence, newest)) {
+        if (newest_sequence == first) {
+            return 0.0;
+        }
+        --newest_sequence;
+    }
+    Clock::time_point oldest;
+    uint64_t oldest_sequence = first;
+    while (!ReadTimestamp(oldest_sequence, oldest)) {
+        if (++oldest_sequence >= newest_sequence) {
+            return 0.0;
+        }
+    }
+    if (oldest_sequence >= newest_sequence) {
+        return 0.0;
+    }
+    const std::chrono::duration<double> window = newest - oldest;
+    return window.count() > 0 ? (newest_sequence - oldest_sequence) / window.count() : 0.0;
+}
+
+bool RequestQueue::ReadTimestamp(uint64_t sequence, Clock::time_point& timestamp) const {
+    const Slot& slot = requests_[sequence % min_in_day_];
+    const uint64_t version = 2 * sequence + 2;
+    if (slot.version.load(std::memory_order_acquire) != version) {
+        return false;
+    }
+    const int64_t ticks = slot.timestamp.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.version.load(std::memory_order_relaxed) != version) {
+        return false;
+    }
+    timestamp = Clock::time_point(Clock::duration(ticks));
+    return true;
+}
+
+size_t RequestQueue::GetWindowSize() const {
+    return static_cast<size_t>(std::min<uint64_t>(recorded_count_.load(std::memory_order_acquire), min_in_day_));
+}
+
+int RequestQueue::GetLatencyBucket(std::chrono::nanoseconds latency) {
+    const auto value = static_cast<uint64_t>(std::max<int64_t>(latency.count(), 1));
+    int power = 63;
+    while ((value >> power) == 0) {
+        --power;
+    }
+    if (power < latency_sub_bucket_bits_) {
+        return static_cast<int>(value);
+    }
+    const auto sub_bucket = (value >> (power - latency_sub_bucket_bits_)) & ((1 << latency_sub_bucket_bits_) - 1);
+    return (power << latency_sub_bucket_bits_) + static_cast<int>(sub_bucket);
+}
+
+std::chrono::nanoseconds RequestQueue::GetLatencyBucketUpperBound(int bucket) {
+    const int power = bucket >> latency_sub_bucket_bits_;
+    if (power < latency_sub_bucket_bits_) {
+        return std::chrono::nanoseconds(bucket);
+    }
+    const uint64_t sub_bucket = bucket & ((1 << latency_sub_bucket_bits_) - 1);
+    const int shift = power - latency_sub_bucket_bits_;
+    // Значения корзины: [(4 + sub) << shift, (5 + sub) << shift)
+    const uint64_t upper = (((1ULL << latency_sub_bucket_bits_) + sub_bucket + 1) << shift) - 1;
+    return std::chrono::nanoseconds(static_cast<int64_t>(std::min<uint64_t>(upper, INT64_MAX)));
+}
@@ -1,55 +1,93 @@
 #pragma once
 
-#include <deque>
-#include <string>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string_view>
 #include <vector>
 #include "search_server.h"
 
+// Статистика последних min_in_day_ запросов. Для каждого запроса хранится только компактная запись
+// (время, задержка, число найденных документов, хеш запроса) в кольцевом буфере фиксированного размера,
+// поэтому память не зависит ни от длины запросов, ни от размера результатов.
+//
+// Запись идет без блокировок: номер записи берется атомарным fetch_add и задает ячейку кольца, ячейка
+// публикуется счетчиком версии (seqlock), счетчики окна и гистограмма - атомарные. Писатель ждет ячейку,
+// только если ее предыдущий владелец, отстающий на целый круг, еще не дописал свою запись.
 class RequestQueue {
 public:
+    using Clock = std::chrono::steady_clock;
+
     explicit RequestQueue(const SearchServer& search_server);
 
+    // Методы поиска и статистики можно вызывать из разных потоков одновременно. Пока идут записи,
+    // статистика может отставать от них на записи, которые еще не дописаны.
     template <typename DocumentPredicate>
-    void AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
+    std::vector<Document> AddFindRequest(std::string_view raw_query, DocumentPredicate document_predicate);
+
+    std::vector<Document> AddFindRequest(std::string_view raw_query, DocumentStatus raw_status);
+
+    std::vector<Document> AddFindRequest(std::string_view raw_query);
 
-    void AddFindRequest(const std::string& raw_query, DocumentStatus raw_status);
+    // Учитывает запрос, выполненный мимо очереди (например, ответ QueryCache)
+    void AddRequestRecord(std::string_view raw_query, size_t hit_count, std::chrono::nanoseconds latency,
+                          Clock::time_point end_time);
 
-    void AddFindRequest(const std::string& raw_query);
-    
+    // Все методы статистики работают за O(1) по окну
     int GetNoResultRequests() const;
 
+    // Доля запросов без результата в окне, от 0 до 1
+    double GetNoResultRate() const;
+
+    // Задержка, которую не превышает заданная доля запросов окна (0.5 - медиана, 0.99 - p99).
+    // Оценка сверху: граница корзины гистограммы (четыре корзины на степень двойки) больше задержки
+    // не более чем на 25%.
+    std::chrono::nanoseconds GetLatencyPercentile(double percentile) const;
+
+    // Запросов в секунду между самым старым и самым новым запросом окна
+    double GetQueriesPerSecond() const;
+
 private:
-    struct QueryResult {
-        std::string raw_query;
-        std::vector<Document> result;
+    // Ячейка кольца. version: 0 - пусто, 2 * (номер + 1) - 1 - запись с этим номером пишется, 2 * (номер + 1) - готова.
+    // Поля атомарные (relaxed), согласованность их набора дает version. Своя кеш-линия: соседние номера
+    // пишут разные потоки.
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> version{0};
+        std::atomic<int64_t> timestamp{0};  // Clock::time_point в тиках
+        std::atomic<int64_t> latency{0};  // наносекунды
+        std::atomic<uint32_t> hit_count{0};
+        std::atomic<uint64_t> query_hash{0};
     };
-    std::deque<QueryResult> requests_;
+
+    // Гистограмма задержек: корзина (степень двойки, два следующих бита), 64 * 4 корзины
+    static const int latency_sub_bucket_bits_ = 2;
+    static const int latency_bucket_count_ = 64 << latency_sub_bucket_bits_;
+    static int GetLatencyBucket(std::chrono::nanoseconds latency);
+    static std::chrono::nanoseconds GetLatencyBucketUpperBound(int bucket);
+
+    // Время записи с номером sequence, если она дописана и еще не вытеснена
+    bool ReadTimestamp(uint64_t sequence, Clock::time_point& timestamp) const;
+
+    // Записей в окне: дописанных, но не больше размера окна
+    size_t GetWindowSize() const;
+
     const static int min_in_day_ = 1440;
-    int no_result_requests_ = 0;
-    int result_requests_ = 0;
     const SearchServer& search_server_;
+
+    std::array<Slot, min_in_day_> requests_;
+    std::atomic<uint64_t> next_sequence_{0};  // номер следующей записи
+    std::atomic<uint64_t> recorded_count_{0};  // дописанных записей
+    std::atomic<int> no_result_requests_{0};
+    std::array<std::atomic<uint32_t>, latency_bucket_count_> latency_histogram_{};
 };
 
 template <typename DocumentPredicate>
-void RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
-        auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
-        QueryResult temp;
-        
-        if (result.empty()) {
-            temp.raw_query = raw_query;
-            temp.result = result;
-            ++no_result_requests_;
-            requests_.push_back(temp);
-        }
-        else {
-            temp.raw_query = raw_query;
-            temp.result = result;
-            ++result_requests_;
-            requests_.push_back(temp);
-        }
-        if (no_result_requests_ + result_requests_ >= min_in_day_) {
-            requests_.pop_front();
-            --no_result_requests_;
-            --result_requests_;
-        }
-}
\ No newline at end of file
+std::vector<Document> RequestQueue::AddFindRequest(std::string_view raw_query, DocumentPredicate document_predicate) {
+    const auto start_time = Clock::now();
+    auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
+    const auto end_time = Clock::now();
+    AddRequestRecord(raw_query, result.size(), end_time - start_time, end_time);
+    return result;
+}
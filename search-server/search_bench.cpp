@@ -0,0 +1,471 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+#include "request_queue.h"
+#include "search_server.h"
+#if defined(__unix__) || defined(__APPLE__)
+#define SEARCH_BENCH_SHARDS
+#include "sharded_search_server.h"
+#endif
+
+using namespace std;
+
+// Нагрузочный стенд. Корпус и журнал запросов генерируются со словами по закону Ципфа, затем замеряются
+// загрузка документов, задержки и пропускная способность FindTopDocuments, MatchDocument и RequestQueue.
+// С --shards те же запросы гоняются через ShardedSearchServer для каждого числа шардов.
+// Краткий отчет пишется в stderr, полный - в JSON (в stdout или в файл --json=путь), чтобы сравнивать сборки.
+
+struct BenchConfig {
+    size_t vocabulary_size = 50'000;
+    size_t document_count = 100'000;
+    size_t document_length = 50;  // слов в документе
+    size_t query_count = 10'000;
+    size_t query_length = 3;  // слов в запросе
+    double minus_word_ratio = 0.1;  // доля минус-слов среди слов запроса (кроме первого)
+    double zipf_exponent = 1.0;  // вероятность слова ранга r пропорциональна 1 / r^s
+    vector<int> thread_counts = {1, 2, 4, 8};
+    vector<int> shard_counts;  // пусто - без замеров ShardedSearchServer
+    uint32_t seed = 42;
+    string json_path;
+};
+
+using Clock = chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start_time) {
+    return chrono::duration<double>(Clock::now() - start_time).count();
+}
+
+void PrintUsage(ostream& out) {
+    out << "Usage: search_bench [--name=value ...]\n"s
+        << "  --vocabulary=N        words in vocabulary (50000)\n"s
+        << "  --documents=N         documents in corpus (100000)\n"s
+        << "  --document-length=N   words per document (50)\n"s
+        << "  --queries=N           queries in log (10000)\n"s
+        << "  --query-length=N      words per query (3)\n"s
+        << "  --minus-ratio=X       share of minus words in queries (0.1)\n"s
+        << "  --zipf=X              Zipf exponent of word frequencies (1.0)\n"s
+        << "  --threads=N,N,...     thread counts for QPS runs (1,2,4,8)\n"s
+        << "  --shards=N,N,...      shard counts for ShardedSearchServer runs (none)\n"s
+        << "  --seed=N              random seed (42)\n"s
+        << "  --json=PATH           write JSON report to file instead of stdout\n"s;
+}
+
+// Список положительных чисел через запятую; what - что перечисляется, для текста ошибки
+vector<int> ParseCounts(const string& value, const string& what) {
+    vector<int> counts;
+    istringstream input(value);
+    for (string item; getline(input, item, ',');) {
+        const int count = stoi(item);
+        if (count <= 0) {
+            throw invalid_argument(what + " count must be positive"s);
+        }
+        counts.push_back(count);
+    }
+    if (counts.empty()) {
+        throw invalid_argument("no "s + what + " counts"s);
+    }
+    return counts;
+}
+
+// Ошибка в аргументах - std::invalid_argument
+BenchConfig ParseConfig(int argc, char* argv[]) {
+    BenchConfig config;
+    for (int i = 1; i < argc; ++i) {
+        const string argument = argv[i];
+        const size_t equal_pos = argument.find('=');
+        if (argument.rfind("--"s, 0) != 0 || equal_pos == string::npos) {
+            throw invalid_argument("unexpected argument "s + argument);
+        }
+        const string name = argument.substr(2, equal_pos - 2);
+        const string value = argument.substr(equal_pos + 1);
+        if (name == "vocabulary"s) {
+            config.vocabulary_size = stoul(value);
+        }
+        else if (name == "documents"s) {
+            config.document_count = stoul(value);
+        }
+        else if (name == "document-length"s) {
+            config.document_length = stoul(value);
+        }
+        else if (name == "queries"s) {
+            config.query_count = stoul(value);
+        }
+        else if (name == "query-length"s) {
+            config.query_length = stoul(value);
+        }
+        else if (name == "minus-ratio"s) {
+            config.minus_word_ratio = stod(value);
+        }
+        else if (name == "zipf"s) {
+            config.zipf_exponent = stod(value);
+        }
+        else if (name == "threads"s) {
+            config.thread_counts = ParseCounts(value, "thread"s);
+        }
+        else if (name == "shards"s) {
+#ifdef SEARCH_BENCH_SHARDS
+            config.shard_counts = ParseCounts(value, "shard"s);
+#else
+            throw invalid_argument("--shards is not supported on this platform");
+#endif
+        }
+        else if (name == "seed"s) {
+            config.seed = static_cast<uint32_t>(stoul(value));
+        }
+        else if (name == "json"s) {
+            config.json_path = value;
+        }
+        else {
+            throw invalid_argument("unknown option --"s + name);
+        }
+    }
+    if (config.vocabulary_size == 0 || config.document_count == 0 || config.document_length == 0
+        || config.query_count == 0 || config.query_length == 0) {
+        throw invalid_argument("sizes must be positive");
+    }
+    if (config.minus_word_ratio < 0.0 || config.minus_word_ratio > 1.0) {
+        throw invalid_argument("minus ratio must be in [0, 1]");
+    }
+    return config;
+}
+
+// Слово ранга r - номер r + 1 в биективной 26-ричной записи (a, b, ..., z, aa, ab, ...):
+// слова различны, и частые слова короче редких, как в живом языке
+string MakeWord(size_t rank) {
+    string word;
+    for (size_t number = rank + 1; number > 0; number = (number - 1) / 26) {
+        word.push_back(static_cast<char>('a' + (number - 1) % 26));
+    }
+    return word;
+}
+
+class ZipfWordGenerator {
+public:
+    ZipfWordGenerator(size_t vocabulary_size, double exponent) {
+        words_.reserve(vocabulary_size);
+        vector<double> weights(vocabulary_size);
+        for (size_t rank = 0; rank < vocabulary_size; ++rank) {
+            words_.push_back(MakeWord(rank));
+            weights[rank] = 1.0 / pow(rank + 1.0, exponent);
+        }
+        distribution_ = discrete_distribution<size_t>(weights.begin(), weights.end());
+    }
+
+    const string& operator()(mt19937& generator) {
+        return words_[distribution_(generator)];
+    }
+
+private:
+    vector<string> words_;
+    discrete_distribution<size_t> distribution_;
+};
+
+vector<string> GenerateDocuments(const BenchConfig& config, ZipfWordGenerator& words, mt19937& generator) {
+    vector<string> documents(config.document_count);
+    for (string& document : documents) {
+        for (size_t i = 0; i < config.document_length; ++i) {
+            if (i > 0) {
+                document.push_back(' ');
+            }
+            document += words(generator);
+        }
+    }
+    return documents;
+}
+
+vector<string> GenerateQueries(const BenchConfig& config, ZipfWordGenerator& words, mt19937& generator) {
+    bernoulli_distribution is_minus(config.minus_word_ratio);
+    vector<string> queries(config.query_count);
+    for (string& query : queries) {
+        // Первое слово всегда плюс-слово, иначе запрос заведомо пустой
+        for (size_t i = 0; i < config.query_length; ++i) {
+            if (i > 0) {
+                query.push_back(' ');
+                if (is_minus(generator)) {
+                    query.push_back('-');
+                }
+            }
+            query += words(generator);
+        }
+    }
+    return queries;
+}
+
+struct LatencyStats {
+    double mean_ns = 0.0;
+    int64_t p50_ns = 0;
+    int64_t p95_ns = 0;
+    int64_t p99_ns = 0;
+};
+
+// Перцентили по ближайшему рангу
+LatencyStats ComputeLatencyStats(vector<int64_t> latencies) {
+    LatencyStats stats;
+    if (latencies.empty()) {
+        return stats;
+    }
+    sort(latencies.begin(), latencies.end());
+    const auto percentile = [&latencies](double share) {
+        const size_t rank = static_cast<size_t>(ceil(share * latencies.size()));
+        return latencies[max<size_t>(rank, 1) - 1];
+    };
+    double sum = 0.0;
+    for (const int64_t latency : latencies) {
+        sum += latency;
+    }
+    stats.mean_ns = sum / latencies.size();
+    stats.p50_ns = percentile(0.50);
+    stats.p95_ns = percentile(0.95);
+    stats.p99_ns = percentile(0.99);
+    return stats;
+}
+
+// Все запросы журнала один раз, потоки разбирают их по общему счетчику
+template <typename Server>
+double MeasureQueriesPerSecond(const Server& search_server, const vector<string>& queries, int thread_count) {
+    atomic<size_t> next_query(0);
+    const auto start_time = Clock::now();
+    vector<thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&search_server, &queries, &next_query] {
+            for (size_t i = next_query++; i < queries.size(); i = next_query++) {
+                search_server.FindTopDocuments(queries[i]);
+            }
+        });
+    }
+    for (thread& worker : threads) {
+        worker.join();
+    }
+    return queries.size() / SecondsSince(start_time);
+}
+
+// Пиковый объем резидентной памяти процесса; 0, если платформа его не сообщает
+size_t GetPeakRssBytes() {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+// Задержка одного запроса в одном потоке по всему журналу
+template <typename Server>
+LatencyStats MeasureLatency(const Server& search_server, const vector<string>& queries) {
+    vector<int64_t> latencies;
+    latencies.reserve(queries.size());
+    for (const string& query : queries) {
+        const auto start_time = Clock::now();
+        search_server.FindTopDocuments(query);
+        latencies.push_back(chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start_time).count());
+    }
+    return ComputeLatencyStats(move(latencies));
+}
+
+struct ShardedReport {
+    int shard_count = 0;
+    double ingest_seconds = 0.0;
+    LatencyStats find_latency;
+    vector<pair<int, double>> qps_by_threads;
+};
+
+struct BenchReport {
+    double ingest_seconds = 0.0;
+    size_t posting_count = 0;
+    LatencyStats find_latency;
+    vector<pair<int, double>> qps_by_threads;
+    double match_operations_per_second = 0.0;
+    double request_queue_requests_per_second = 0.0;
+    vector<ShardedReport> sharded;
+    size_t peak_rss_bytes = 0;
+};
+
+void WriteLatencyJson(ostream& out, const LatencyStats& latency) {
+    out << "{ \"mean\": "s << latency.mean_ns
+        << ", \"p50\": "s << latency.p50_ns
+        << ", \"p95\": "s << latency.p95_ns
+        << ", \"p99\": "s << latency.p99_ns << " }"s;
+}
+
+void WriteQpsJson(ostream& out, const vector<pair<int, double>>& qps_by_threads) {
+    out << "["s;
+    for (size_t i = 0; i < qps_by_threads.size(); ++i) {
+        out << (i > 0 ? ", "s : ""s) << "{ \"threads\": "s << qps_by_threads[i].first
+            << ", \"qps\": "s << qps_by_threads[i].second << " }"s;
+    }
+    out << "]"s;
+}
+
+void WriteJson(ostream& out, const BenchConfig& config, const BenchReport& report) {
+    out << "{\n"s
+        << "  \"config\": {\n"s
+        << "    \"vocabulary_size\": "s << config.vocabulary_size << ",\n"s
+        << "    \"document_count\": "s << config.document_count << ",\n"s
+        << "    \"document_length\": "s << config.document_length << ",\n"s
+        << "    \"query_count\": "s << config.query_count << ",\n"s
+        << "    \"query_length\": "s << config.query_length << ",\n"s
+        << "    \"minus_word_ratio\": "s << config.minus_word_ratio << ",\n"s
+        << "    \"zipf_exponent\": "s << config.zipf_exponent << ",\n"s
+        << "    \"seed\": "s << config.seed << "\n"s
+        << "  },\n"s
+        << "  \"ingest\": {\n"s
+        << "    \"documents\": "s << config.document_count << ",\n"s
+        << "    \"postings\": "s << report.posting_count << ",\n"s
+        << "    \"seconds\": "s << report.ingest_seconds << ",\n"s
+        << "    \"documents_per_second\": "s << config.document_count / report.ingest_seconds << "\n"s
+        << "  },\n"s
+        << "  \"find_top_documents\": {\n"s
+        << "    \"latency_ns\": "s;
+    WriteLatencyJson(out, report.find_latency);
+    out << ",\n"s
+        << "    \"qps_by_threads\": "s;
+    WriteQpsJson(out, report.qps_by_threads);
+    out << "\n"s
+        << "  },\n"s
+        << "  \"match_document\": { \"operations_per_second\": "s << report.match_operations_per_second << " },\n"s
+        << "  \"request_queue\": { \"requests_per_second\": "s << report.request_queue_requests_per_second << " },\n"s
+        << "  \"sharded\": ["s;
+    for (size_t i = 0; i < report.sharded.size(); ++i) {
+        const ShardedReport& sharded = report.sharded[i];
+        out << (i > 0 ? ","s : ""s) << "\n"s
+            << "    { \"shards\": "s << sharded.shard_count
+            << ", \"ingest_documents_per_second\": "s << config.document_count / sharded.ingest_seconds
+            << ",\n      \"latency_ns\": "s;
+        WriteLatencyJson(out, sharded.find_latency);
+        out << ",\n      \"qps_by_threads\": "s;
+        WriteQpsJson(out, sharded.qps_by_threads);
+        out << " }"s;
+    }
+    out << (report.sharded.empty() ? "],\n"s : "\n  ],\n"s)
+        << "  \"peak_rss_bytes\": "s << report.peak_rss_bytes << "\n"s
+        << "}\n"s;
+}
+
+BenchReport RunBench(const BenchConfig& config) {
+    BenchReport report;
+    mt19937 generator(config.seed);
+    ZipfWordGenerator words(config.vocabulary_size, config.zipf_exponent);
+    const vector<string> documents = GenerateDocuments(config, words, generator);
+    const vector<string> queries = GenerateQueries(config, words, generator);
+
+    // Рейтинги заранее, чтобы шардированные замеры загружали те же документы
+    uniform_int_distribution<int> rating(-10, 10);
+    vector<vector<int>> ratings(documents.size());
+    for (vector<int>& document_ratings : ratings) {
+        document_ratings = {rating(generator), rating(generator), rating(generator)};
+    }
+
+    SearchServer search_server;
+    const auto ingest_start = Clock::now();
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, ratings[i]);
+    }
+    report.ingest_seconds = SecondsSince(ingest_start);
+    report.posting_count = search_server.GetPostingCount();
+    cerr << "Ingest: "s << config.document_count / report.ingest_seconds << " docs/s"s << endl;
+
+    report.find_latency = MeasureLatency(search_server, queries);
+    cerr << "FindTopDocuments latency: p50 "s << report.find_latency.p50_ns << " ns, p95 "s
+         << report.find_latency.p95_ns << " ns, p99 "s << report.find_latency.p99_ns << " ns"s << endl;
+
+    for (const int thread_count : config.thread_counts) {
+        const double qps = MeasureQueriesPerSecond(search_server, queries, thread_count);
+        report.qps_by_threads.emplace_back(thread_count, qps);
+        cerr << "FindTopDocuments, "s << thread_count << " threads: "s << qps << " QPS"s << endl;
+    }
+
+    uniform_int_distribution<int> document_id(0, static_cast<int>(config.document_count) - 1);
+    const auto match_start = Clock::now();
+    for (const string& query : queries) {
+        search_server.MatchDocument(query, document_id(generator));
+    }
+    report.match_operations_per_second = queries.size() / SecondsSince(match_start);
+    cerr << "MatchDocument: "s << report.match_operations_per_second << " ops/s"s << endl;
+
+    RequestQueue request_queue(search_server);
+    const auto queue_start = Clock::now();
+    for (const string& query : queries) {
+        request_queue.AddFindRequest(query);
+    }
+    report.request_queue_requests_per_second = queries.size() / SecondsSince(queue_start);
+    cerr << "RequestQueue: "s << report.request_queue_requests_per_second << " requests/s"s << endl;
+
+#ifdef SEARCH_BENCH_SHARDS
+    // Шарды - копии процесса стенда через fork, поэтому запускаются, когда потоки замеров уже завершены
+    const size_t ingest_batch_size = 1000;
+    for (const int shard_count : config.shard_counts) {
+        ShardedReport& sharded = report.sharded.emplace_back();
+        sharded.shard_count = shard_count;
+        ShardedSearchServer sharded_server(static_cast<size_t>(shard_count));
+        const auto sharded_ingest_start = Clock::now();
+        for (size_t begin = 0; begin < documents.size(); begin += ingest_batch_size) {
+            vector<RawDocument> batch;
+            for (size_t i = begin; i < min(documents.size(), begin + ingest_batch_size); ++i) {
+                batch.push_back({ static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, ratings[i] });
+            }
+            sharded_server.AddDocuments(batch);
+        }
+        sharded.ingest_seconds = SecondsSince(sharded_ingest_start);
+
+        sharded.find_latency = MeasureLatency(sharded_server, queries);
+        cerr << shard_count << " shards: ingest "s << config.document_count / sharded.ingest_seconds
+             << " docs/s, latency p50 "s << sharded.find_latency.p50_ns << " ns, p95 "s
+             << sharded.find_latency.p95_ns << " ns, p99 "s << sharded.find_latency.p99_ns << " ns"s << endl;
+        for (const int thread_count : config.thread_counts) {
+            const double qps = MeasureQueriesPerSecond(sharded_server, queries, thread_count);
+            sharded.qps_by_threads.emplace_back(thread_count, qps);
+            cerr << shard_count << " shards, "s << thread_count << " threads: "s << qps << " QPS"s << endl;
+        }
+    }
+#endif
+
+    report.peak_rss_bytes = GetPeakRssBytes();
+    cerr << "Peak RSS: "s << report.peak_rss_bytes / (1024 * 1024) << " MiB"s << endl;
+    return report;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 2 && argv[1] == "--help"s) {
+        PrintUsage(cout);
+        return 0;
+    }
+    BenchConfig config;
+    try {
+        config = ParseConfig(argc, argv);
+    }
+    catch (const exception& e) {
+        cerr << "search_bench: "s << e.what() << endl;
+        PrintUsage(cerr);
+        return 1;
+    }
+
+    const BenchReport report = RunBench(config);
+    if (config.json_path.empty()) {
+        WriteJson(cout, config, report);
+        return 0;
+    }
+    ofstream json_output(config.json_path);
+    if (!json_output) {
+        cerr << "search_bench: cannot open "s << config.json_path << endl;
+        return 1;
+    }
+    WriteJson(json_output, config, report);
+    return 0;
+}
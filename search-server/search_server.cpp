@@ -1,99 +1,920 @@
 #include "search_server.h"
+#include "index_file.h"
+#include <thread>
 
-SearchServer::SearchServer(const std::string& stop_words) : SearchServer(SplitIntoWords(stop_words)) {}
+SearchServer::SearchServer(const std::string& stop_words) : SearchServer(std::string_view(stop_words)) {}
+
+SearchServer::SearchServer(std::string_view stop_words) : SearchServer(SplitIntoWords(stop_words)) {}
 
 SearchServer::SearchServer() = default;
 
-void SearchServer::AddDocument(int document_id, const std::string& document, DocumentStatus status,
+SearchServer::SearchServer(const SearchServer& other)
+    : max_result_document_count_(other.max_result_document_count_)
+    , query_mode_(other.query_mode_)
+    , posting_format_(other.posting_format_)
+    , dynamic_pruning_(other.dynamic_pruning_)
+    , stop_words_(other.stop_words_)
+    , frozen_words_(other.frozen_words_)
+    , frozen_postings_(other.frozen_postings_)
+    , added_word_postings_(other.added_word_postings_)
+    , document_ordinals_(other.document_ordinals_)
+    , ordinal_to_id_(other.ordinal_to_id_)
+    , ratings_(other.ratings_)
+    , statuses_(other.statuses_)
+    , status_bitmaps_(other.status_bitmaps_)
+    , log_document_count_(other.log_document_count_)
+    , index_version_(other.index_version_)
+    , mapped_file_(other.mapped_file_) {
+}
+
+SearchServer& SearchServer::operator=(const SearchServer& other) {
+    if (this != &other) {
+        *this = SearchServer(other);
+    }
+    return *this;
+}
+
+void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
                      const std::vector<int>& ratings) {
+    CheckNewDocumentId(document_id);
+    if (!IsValidWord(document)) {
+        throw std::invalid_argument("words contain special characters");
+    }
+    InsertDocument(document_id, ComputeWordFreqs(document), status, ComputeAverageRating(ratings));
+}
+
+void SearchServer::AddDocuments(const std::vector<RawDocument>& documents) {
+    AddDocuments(std::execution::seq, documents);
+}
+
+void SearchServer::AddDocuments(const std::execution::sequenced_policy&, const std::vector<RawDocument>& documents) {
+    AddDocumentsImpl(std::execution::seq, documents);
+}
+
+void SearchServer::AddDocuments(const std::execution::parallel_policy&, const std::vector<RawDocument>& documents) {
+    AddDocumentsImpl(std::execution::par, documents);
+}
+
+void SearchServer::CheckNewDocumentId(int document_id) const {
     if (document_id < 0) {
         throw std::invalid_argument("invalid id");
     }
-    if (documents_.count(document_id) != 0) {
+    if (document_ordinals_.count(document_id) != 0) {
         throw std::invalid_argument("id is busy");
     }
-    if (!IsValidWord(document)) {
-        throw std::invalid_argument("words contain special characters");
-    }
+}
 
-    const std::vector<std::string> words = SplitIntoWordsNoStop(document);
+std::map<std::string_view, double> SearchServer::ComputeWordFreqs(std::string_view document) const {
+    const std::vector<std::string_view> words = SplitIntoWordsNoStop(document);
 
     const double inv_word_count = 1.0 / words.size();  // Для расчета TF
 
-    for (const std::string& word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;  // Добавление TF в word_to_document_freqs_
+    std::map<std::string_view, double> word_freqs;
+    for (const std::string_view word : words) {
+        word_freqs[word] += inv_word_count;
+    }
+    return word_freqs;
+}
+
+void SearchServer::InsertDocument(int document_id, const std::map<std::string_view, double>& word_freqs,
+                                  DocumentStatus status, int rating) {
+    const int ordinal = AppendDocumentData(document_id, status, rating);
+    // TF документа посчитан целиком, поэтому в каждый список вхождений пишем один раз.
+    // Еще не построенный прямой индекс не дополняется: он будет построен по спискам вхождений.
+    auto* document_freqs = forward_index_.is_built ? &forward_index_.word_freqs[document_id] : nullptr;
+    for (const auto [word, term_freq] : word_freqs) {
+        const auto [index_word, postings] = GetOrAddPostings(word);
+        const double stored_term_freq = GetStoredTermFreq(term_freq);
+        postings->Add(ordinal, stored_term_freq);  // Добавление TF в список вхождений слова
+        if (document_freqs != nullptr) {
+            (*document_freqs)[index_word] = stored_term_freq;
+        }
+    }
+    UpdateLogDocumentCount();
+    ++index_version_;
+}
+
+void SearchServer::InsertDocuments(const std::execution::sequenced_policy&, const std::vector<RawDocument>& documents,
+                                   const std::vector<std::map<std::string_view, double>>& word_freqs) {
+    for (size_t i = 0; i < documents.size(); ++i) {
+        InsertDocument(documents[i].id, word_freqs[i], documents[i].status,
+                       ComputeAverageRating(documents[i].ratings));
     }
-    documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status });
-    id_number_.push_back(document_id);
+}
+
+void SearchServer::InsertDocuments(const std::execution::parallel_policy&, const std::vector<RawDocument>& documents,
+                                   const std::vector<std::map<std::string_view, double>>& word_freqs) {
+    struct WordEntry {
+        size_t group;
+        std::string_view word;
+        double term_freq;
+        std::string_view index_word;  // слово в памяти индекса
+        PostingList* postings;
+    };
+
+    std::vector<int> ordinals(documents.size());
+    std::vector<std::map<std::string_view, double>*> document_freqs(documents.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        ordinals[i] = AppendDocumentData(documents[i].id, documents[i].status,
+                                         ComputeAverageRating(documents[i].ratings));
+        document_freqs[i] = forward_index_.is_built ? &forward_index_.word_freqs[documents[i].id] : nullptr;
+    }
+
+    // Слова каждого документа упорядочиваются по группам, чтобы группа находила свои слова двоичным поиском
+    std::vector<std::vector<WordEntry>> entries(documents.size());
+    std::vector<size_t> indexes(documents.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(),
+        [this, &word_freqs, &entries](size_t index) {
+            std::vector<WordEntry>& document_entries = entries[index];
+            document_entries.reserve(word_freqs[index].size());
+            for (const auto [word, term_freq] : word_freqs[index]) {
+                const size_t group = std::hash<std::string_view>{}(word) % INGEST_WORD_GROUP_COUNT;
+                document_entries.push_back({ group, word, GetStoredTermFreq(term_freq), {}, nullptr });
+            }
+            std::sort(document_entries.begin(), document_entries.end(),
+                      [](const WordEntry& lhs, const WordEntry& rhs) { return lhs.group < rhs.group; });
+        });
+    // Группа обходит документы по порядку, поэтому номера дописываются в списки по возрастанию
+    const auto for_each_group_entry = [&entries](size_t group, const auto& function) {
+        for (size_t index = 0; index < entries.size(); ++index) {
+            auto first = std::partition_point(entries[index].begin(), entries[index].end(),
+                                              [group](const WordEntry& entry) { return entry.group < group; });
+            for (; first != entries[index].end() && first->group == group; ++first) {
+                function(index, *first);
+            }
+        }
+    };
+
+    std::vector<std::vector<std::string_view>> new_words(INGEST_WORD_GROUP_COUNT);
+    std::vector<size_t> groups(INGEST_WORD_GROUP_COUNT);
+    std::iota(groups.begin(), groups.end(), 0);
+    std::for_each(std::execution::par, groups.begin(), groups.end(),
+        [this, &for_each_group_entry, &new_words](size_t group) {
+            for_each_group_entry(group, [this, &new_words, group](size_t, WordEntry& entry) {
+                std::tie(entry.index_word, entry.postings) = FindIndexPostings(entry.word);
+                if (entry.postings == nullptr) {
+                    new_words[group].push_back(entry.word);
+                }
+            });
+        });
+    // Словарь меняется, только пока его никто не читает
+    for (const std::vector<std::string_view>& words : new_words) {
+        for (const std::string_view word : words) {
+            GetOrAddPostings(word);
+        }
+    }
+    std::for_each(std::execution::par, groups.begin(), groups.end(),
+        [this, &for_each_group_entry, &ordinals](size_t group) {
+            for_each_group_entry(group, [this, &ordinals](size_t index, WordEntry& entry) {
+                if (entry.postings == nullptr) {
+                    std::tie(entry.index_word, entry.postings) = FindIndexPostings(entry.word);
+                }
+                entry.postings->Add(ordinals[index], entry.term_freq);
+            });
+        });
+    // Прямой индекс у каждого документа свой, поэтому заполняется параллельно по документам
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(),
+        [&entries, &document_freqs](size_t index) {
+            if (document_freqs[index] == nullptr) {
+                return;
+            }
+            for (const WordEntry& entry : entries[index]) {
+                (*document_freqs[index])[entry.index_word] = entry.term_freq;
+            }
+        });
+    UpdateLogDocumentCount();
+    ++index_version_;
+}
+
+double SearchServer::GetStoredTermFreq(double term_freq) const {
+    return posting_format_ == PostingFormat::COMPRESSED ? static_cast<float>(term_freq) : term_freq;
+}
+
+int SearchServer::AppendDocumentData(int document_id, DocumentStatus status, int rating) {
+    const int ordinal = static_cast<int>(ordinal_to_id_.size());
+    document_ordinals_.emplace(document_id, ordinal);
+    ordinal_to_id_.push_back(document_id);
+    ratings_.push_back(rating);
+    statuses_.push_back(status);
+    for (size_t i = 0; i < DOCUMENT_STATUS_COUNT; ++i) {
+        status_bitmaps_[i].push_back(static_cast<size_t>(status) == i);
+    }
+    return ordinal;
 }
 
 // Поиск для определенного статуса
-std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query, DocumentStatus raw_status) const {
-        return FindTopDocuments(raw_query, [raw_status]([[maybe_unused]] int document_id, DocumentStatus status, int rating [[maybe_unused]] )
-            { return status == raw_status; } );
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus raw_status) const {
+    return FindTopDocuments(std::execution::seq, raw_query, raw_status);
 }
 
 // Поиск актуальных документов (запрос с одним параметром)
-std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query) const {
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const {
     return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
+std::vector<Document> SearchServer::FindDocumentsPage(std::string_view raw_query, size_t page, size_t page_size) const {
+    return FindDocumentsPage(raw_query, page, page_size, DocumentStatus::ACTUAL);
+}
+
+void SearchServer::SetMaxResultDocumentCount(size_t count) {
+    max_result_document_count_ = count;
+    ++index_version_;
+}
+
+size_t SearchServer::GetMaxResultDocumentCount() const {
+    return max_result_document_count_;
+}
+
+void SearchServer::SetQueryMode(QueryMode mode) {
+    query_mode_ = mode;
+    ++index_version_;
+}
+
+QueryMode SearchServer::GetQueryMode() const {
+    return query_mode_;
+}
+
+void SearchServer::SetPostingFormat(PostingFormat format) {
+    posting_format_ = format;
+    ForEachPostings(*this, [format](std::string_view, PostingList& postings) {
+        if (format == PostingFormat::COMPRESSED) {
+            postings.Compress();
+        }
+        else {
+            postings.Decompress();
+        }
+    });
+    // TF сжатых списков округлены до float, и прямой индекс должен хранить те же значения
+    if (format == PostingFormat::COMPRESSED) {
+        ResetForwardIndex();
+    }
+    ++index_version_;
+}
+
+void SearchServer::SetDynamicPruning(bool enabled) {
+    dynamic_pruning_ = enabled;
+}
+
+bool SearchServer::IsDynamicPruningEnabled() const {
+    return dynamic_pruning_;
+}
+
+SearchServer::PruningStats SearchServer::GetPruningStats() {
+    return GetThreadPruningStats();
+}
+
+void SearchServer::ResetPruningStats() {
+    GetThreadPruningStats() = {};
+}
+
+SearchStats SearchServer::GetStats() const {
+    return stats_.recorder->GetStats();
+}
+
+void SearchServer::SetStatsRecorder(std::shared_ptr<QueryStatsRecorder> recorder) {
+    if (recorder == nullptr) {
+        throw std::invalid_argument("stats recorder is null");
+    }
+    stats_.recorder = std::move(recorder);
+}
+
+void SearchServer::RecordQuery(const QueryTrace& trace, QueryTrace* user_trace) const {
+    stats_.recorder->Record(trace);
+    if (user_trace != nullptr) {
+        *user_trace = trace;
+    }
+}
+
+PostingFormat SearchServer::GetPostingFormat() const {
+    return posting_format_;
+}
+
+size_t SearchServer::GetPostingCount() const {
+    size_t posting_count = 0;
+    ForEachPostings(*this, [&posting_count](std::string_view, const PostingList& postings) {
+        posting_count += postings.size();
+    });
+    return posting_count;
+}
+
+size_t SearchServer::GetPostingMemoryUsage() const {
+    size_t memory_usage = 0;
+    ForEachPostings(*this, [&memory_usage](std::string_view, const PostingList& postings) {
+        memory_usage += postings.GetMemoryUsage();
+    });
+    return memory_usage;
+}
+
+size_t SearchServer::GetWordCount() const {
+    size_t word_count = 0;
+    ForEachPostings(*this, [&word_count](std::string_view, const PostingList&) {
+        ++word_count;
+    });
+    return word_count;
+}
+
+size_t SearchServer::GetDictionaryMemoryUsage() const {
+    // Узел дерева без значения: цвет, три указателя и ключ; длинный текст слова - отдельно в куче
+    const size_t node_size = 4 * sizeof(void*) + sizeof(std::string);
+    size_t memory_usage = frozen_words_.GetMemoryUsage();
+    for (const auto& [word, postings] : added_word_postings_) {
+        memory_usage += node_size + (word.capacity() > std::string().capacity() ? word.capacity() + 1 : 0);
+    }
+    return memory_usage;
+}
+
+uint64_t SearchServer::GetIndexVersion() const {
+    return index_version_;
+}
+
+std::string SearchServer::GetCanonicalQuery(std::string_view raw_query) const {
+    QueryArenaScope arena_scope;
+    const Query query = ParseQuery(raw_query, arena_scope.GetResource());
+    std::string canonical_query;
+    for (const std::string_view word : query.plus_words) {
+        canonical_query.append(word).push_back(' ');
+    }
+    for (const std::string_view word : query.minus_words) {
+        canonical_query.append("-").append(word).push_back(' ');
+    }
+    return canonical_query;
+}
+
 // метод получения количества документов
 int SearchServer::GetDocumentCount() const {
-    return static_cast<int>(documents_.size());
+    return static_cast<int>(document_ordinals_.size());
 }
 
-// метод получения id документа по индексу в словаре
+// метод получения id документа по порядковому номеру
 int SearchServer::GetDocumentId(int index) const {
-    if (index < 0 || index > id_number_.size()) {
+    if (index < 0 || index >= GetDocumentCount()) {
         throw std::out_of_range("out of range documents");
     }
-    return id_number_[index];
+    return ordinal_to_id_[index];
+}
+
+std::vector<int>::const_iterator SearchServer::begin() const {
+    return ordinal_to_id_.begin();
+}
+
+std::vector<int>::const_iterator SearchServer::end() const {
+    return ordinal_to_id_.end();
+}
+
+const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
+    static const std::map<std::string_view, double> empty_word_freqs;
+    if (document_ordinals_.count(document_id) == 0) {
+        return empty_word_freqs;
+    }
+    const auto& forward_index = GetForwardIndex();
+    const auto document_it = forward_index.find(document_id);
+    if (document_it == forward_index.end()) {
+        return empty_word_freqs;
+    }
+    return document_it->second;
+}
+
+void SearchServer::RemoveDocument(int document_id) {
+    RemoveDocument(std::execution::seq, document_id);
+}
+
+void SearchServer::RemoveDocument(const std::execution::sequenced_policy&, int document_id) {
+    if (document_ordinals_.count(document_id) == 0) {
+        return;
+    }
+    GetForwardIndex();
+    const auto document_it = forward_index_.word_freqs.find(document_id);
+    const int ordinal = document_ordinals_.at(document_id);
+    for (const auto [word, _] : document_it->second) {
+        GetOrAddPostings(word).second->Remove(ordinal);
+    }
+    EraseDocumentData(document_it);
+}
+
+void SearchServer::RemoveDocument(const std::execution::parallel_policy&, int document_id) {
+    if (document_ordinals_.count(document_id) == 0) {
+        return;
+    }
+    GetForwardIndex();
+    const auto document_it = forward_index_.word_freqs.find(document_id);
+    // Каждое слово документа - отдельный список вхождений, поэтому списки можно чистить параллельно
+    std::vector<PostingList*> postings;
+    postings.reserve(document_it->second.size());
+    for (const auto [word, _] : document_it->second) {
+        postings.push_back(GetOrAddPostings(word).second);
+    }
+    const int ordinal = document_ordinals_.at(document_id);
+    std::for_each(std::execution::par, postings.begin(), postings.end(),
+        [ordinal](PostingList* posting_list) {
+            posting_list->Remove(ordinal);
+        });
+    EraseDocumentData(document_it);
+}
+
+void SearchServer::EraseDocumentData(std::map<int, std::map<std::string_view, double>>::iterator document_it) {
+    const int document_id = document_it->first;
+    EraseEmptyWords(document_it->second);
+    forward_index_.word_freqs.erase(document_it);
+
+    const int ordinal = document_ordinals_.at(document_id);
+    const int last_ordinal = static_cast<int>(ordinal_to_id_.size()) - 1;
+    if (ordinal != last_ordinal) {
+        MoveDocumentOrdinal(last_ordinal, ordinal);
+    }
+    ordinal_to_id_.pop_back();
+    ratings_.pop_back();
+    statuses_.pop_back();
+    for (auto& status_bitmap : status_bitmaps_) {
+        status_bitmap.pop_back();
+    }
+    document_ordinals_.erase(document_id);
+    UpdateLogDocumentCount();
+    ++index_version_;
+}
+
+void SearchServer::MoveDocumentOrdinal(int from, int to) {
+    // У последнего документа наибольший номер, поэтому в каждом его списке он последний и убирается без сдвига;
+    // вставка на новый номер стоит столько же, сколько удаление документа из середины списка
+    const int document_id = ordinal_to_id_[from];
+    for (const auto [word, term_freq] : forward_index_.word_freqs.at(document_id)) {
+        PostingList& postings = *GetOrAddPostings(word).second;
+        postings.Remove(from);
+        postings.Add(to, term_freq);
+    }
+    ordinal_to_id_[to] = document_id;
+    ratings_[to] = ratings_[from];
+    statuses_[to] = statuses_[from];
+    for (auto& status_bitmap : status_bitmaps_) {
+        status_bitmap[to] = status_bitmap[from];
+    }
+    document_ordinals_[document_id] = to;
+}
+
+void SearchServer::Freeze() {
+    bool is_recompressed = false;
+    ForEachPostings(*this, [this, &is_recompressed](std::string_view, PostingList& postings) {
+        if (posting_format_ == PostingFormat::COMPRESSED && !postings.IsCompressed()) {
+            postings.Compress();
+            is_recompressed = true;
+        }
+        postings.ShrinkToFit();
+    });
+    if (is_recompressed) {
+        ++index_version_;
+    }
+
+    // Словарь собирается заново, только если после прошлой сборки появились новые слова или опустели старые
+    const bool has_empty_words = std::any_of(frozen_postings_.begin(), frozen_postings_.end(),
+                                             [](const PostingList& postings) { return postings.empty(); });
+    if (added_word_postings_.empty() && !has_empty_words) {
+        return;
+    }
+    std::vector<std::string_view> words;
+    std::vector<PostingList> postings_by_word;
+    words.reserve(frozen_words_.size() + added_word_postings_.size());
+    postings_by_word.reserve(words.capacity());
+    ForEachPostings(*this, [&words, &postings_by_word](std::string_view word, PostingList& postings) {
+        words.push_back(word);
+        postings_by_word.push_back(std::move(postings));
+    });
+    // Слова копируются в новый словарь раньше, чем освобождается память, на которую ссылается words
+    frozen_words_ = TermDictionary(words);
+    frozen_postings_ = std::move(postings_by_word);
+    added_word_postings_.clear();
+    ResetForwardIndex();
+}
+
+void SearchServer::SaveIndex(const std::string& path) const {
+    IndexFileWriter writer(path);
+    writer.Write(static_cast<uint64_t>(max_result_document_count_));
+    writer.Write(static_cast<int32_t>(query_mode_));
+    writer.Write(static_cast<int32_t>(posting_format_));
+    writer.Write(static_cast<int32_t>(dynamic_pruning_));
+    writer.Write(static_cast<uint64_t>(stop_words_.size()));
+    for (uint32_t term_id = 0; term_id < stop_words_.size(); ++term_id) {
+        writer.WriteString(stop_words_.GetTerm(term_id));
+    }
+    // Документы пишутся по возрастанию id, и номер документа в файле - его место в этом порядке.
+    // При загрузке номера назначаются в том же порядке, поэтому списки вхождений читаются без перевода id в номера.
+    writer.Write(static_cast<uint64_t>(document_ordinals_.size()));
+    std::vector<int> file_ordinals(ordinal_to_id_.size());
+    int file_ordinal = 0;
+    for (const auto [document_id, ordinal] : document_ordinals_) {
+        writer.Write(static_cast<int32_t>(document_id));
+        writer.Write(static_cast<int32_t>(ratings_[ordinal]));
+        writer.Write(static_cast<int32_t>(statuses_[ordinal]));
+        file_ordinals[ordinal] = file_ordinal++;
+    }
+    // Сначала таблица слов, затем выровненные массивы списков вхождений: OpenIndex без проверки читает только
+    // таблицу, а массивы отображенного файла становятся списками без копии
+    writer.Write(static_cast<uint64_t>(GetWordCount()));
+    ForEachPostings(*this, [&writer](std::string_view word, const PostingList& postings) {
+        writer.WriteString(word);
+        writer.Write(static_cast<uint64_t>(postings.size()));
+        writer.Write(postings.GetMaxTermFreq());
+    });
+    writer.Align();
+    std::vector<std::pair<int, double>> ordinal_freqs;
+    std::vector<int> ordinals;
+    std::vector<double> term_freqs;
+    ForEachPostings(*this, [&](std::string_view, const PostingList& postings) {
+        ordinal_freqs.clear();
+        for (PostingList::Cursor cursor(postings); !cursor.AtEnd(); cursor.Next()) {
+            ordinal_freqs.emplace_back(file_ordinals[cursor.GetDocumentId()], cursor.GetTermFreq());
+        }
+        std::sort(ordinal_freqs.begin(), ordinal_freqs.end());
+        ordinals.clear();
+        term_freqs.clear();
+        for (const auto& [ordinal, term_freq] : ordinal_freqs) {
+            ordinals.push_back(ordinal);
+            term_freqs.push_back(term_freq);
+        }
+        writer.WriteArray(ordinals);
+        writer.Align();
+        writer.WriteArray(term_freqs);
+    });
+    writer.Commit();
+}
+
+SearchServer SearchServer::OpenIndex(const std::string& path, IndexVerification verification) {
+    // Файл отображается в память и не копируется: несжатые списки вхождений читают массивы из отображения,
+    // которое сервер держит открытым. Без проверки страницы массивов не читаются до первого поиска по ним.
+    const auto file = std::make_shared<const MappedFile>(path);
+    const bool is_verified = verification == IndexVerification::FULL;
+    BinaryReader reader(CheckIndexFile(file->GetData(), is_verified));
+    SearchServer search_server;
+    search_server.mapped_file_ = file;
+
+    search_server.max_result_document_count_ = reader.Read<uint64_t>();
+    const auto query_mode = reader.Read<int32_t>();
+    const auto posting_format = reader.Read<int32_t>();
+    const auto dynamic_pruning = reader.Read<int32_t>();
+    if (query_mode != static_cast<int32_t>(QueryMode::ANY_WORD)
+        && query_mode != static_cast<int32_t>(QueryMode::ALL_WORDS)) {
+        throw std::runtime_error("invalid query mode in index file");
+    }
+    if (posting_format != static_cast<int32_t>(PostingFormat::PLAIN)
+        && posting_format != static_cast<int32_t>(PostingFormat::COMPRESSED)) {
+        throw std::runtime_error("invalid posting format in index file");
+    }
+    if (dynamic_pruning != 0 && dynamic_pruning != 1) {
+        throw std::runtime_error("invalid dynamic pruning flag in index file");
+    }
+    search_server.query_mode_ = static_cast<QueryMode>(query_mode);
+    search_server.posting_format_ = static_cast<PostingFormat>(posting_format);
+    search_server.dynamic_pruning_ = dynamic_pruning == 1;
+
+    // Слова в файле записаны по возрастанию, и словари собираются из них сразу
+    const auto stop_word_count = reader.Read<uint64_t>();
+    std::vector<std::string_view> stop_words;
+    for (uint64_t i = 0; i < stop_word_count; ++i) {
+        stop_words.push_back(reader.ReadString());
+        if (i > 0 && stop_words[i - 1] >= stop_words[i]) {
+            throw std::runtime_error("unsorted stop words in index file");
+        }
+    }
+    search_server.stop_words_ = TermDictionary(stop_words);
+    // id документов строго возрастают: так проверяется и уникальность, и порядок, от которого зависят номера
+    const auto document_count = reader.Read<uint64_t>();
+    for (uint64_t i = 0; i < document_count; ++i) {
+        const int document_id = reader.Read<int32_t>();
+        const int rating = reader.Read<int32_t>();
+        const auto status = reader.Read<int32_t>();
+        if (document_id < 0) {
+            throw std::runtime_error("negative document id in index file");
+        }
+        if (!search_server.ordinal_to_id_.empty() && search_server.ordinal_to_id_.back() >= document_id) {
+            throw std::runtime_error("unsorted or duplicate document ids in index file");
+        }
+        if (status < 0 || status >= static_cast<int>(DOCUMENT_STATUS_COUNT)) {
+            throw std::runtime_error("invalid document status in index file");
+        }
+        search_server.AppendDocumentData(document_id, static_cast<DocumentStatus>(status), rating);
+    }
+    const auto word_count = reader.Read<uint64_t>();
+    std::vector<std::string_view> words;
+    std::vector<std::pair<uint64_t, double>> posting_headers;  // длина списка и наибольший TF
+    for (uint64_t i = 0; i < word_count; ++i) {
+        const std::string_view word = reader.ReadString();
+        if (!words.empty() && words.back() >= word) {
+            throw std::runtime_error("unsorted words in index file");
+        }
+        words.push_back(word);
+        const auto posting_size = reader.Read<uint64_t>();
+        if (posting_size > document_count) {
+            throw std::runtime_error("posting list is longer than document count in index file");
+        }
+        const auto max_term_freq = reader.Read<double>();
+        if (!std::isfinite(max_term_freq) || max_term_freq < 0.0) {
+            throw std::runtime_error("invalid term frequency in index file");
+        }
+        posting_headers.emplace_back(posting_size, max_term_freq);
+    }
+    reader.Align();
+    search_server.frozen_postings_.reserve(posting_headers.size());
+    for (const auto& [posting_size, max_term_freq] : posting_headers) {
+        const ArrayView<int> ordinals(reader.ReadArrayInPlace<int>(posting_size), posting_size);
+        reader.Align();
+        const ArrayView<double> term_freqs(reader.ReadArrayInPlace<double>(posting_size), posting_size);
+        // Номера строго возрастают и меньше числа документов; один линейный проход вместо поиска id в дереве
+        for (size_t k = 0; is_verified && k < ordinals.size(); ++k) {
+            if (ordinals[k] < (k == 0 ? 0 : ordinals[k - 1] + 1) || ordinals[k] >= static_cast<int>(document_count)) {
+                throw std::runtime_error("invalid document ordinal in index file");
+            }
+            if (!std::isfinite(term_freqs[k]) || term_freqs[k] < 0.0 || term_freqs[k] > max_term_freq) {
+                throw std::runtime_error("invalid term frequency in index file");
+            }
+        }
+        search_server.frozen_postings_.emplace_back(ordinals, term_freqs, max_term_freq);
+        if (search_server.posting_format_ == PostingFormat::COMPRESSED) {
+            search_server.frozen_postings_.back().Compress();
+        }
+    }
+    search_server.frozen_words_ = TermDictionary(words);
+    if (!reader.AtEnd()) {
+        throw std::runtime_error("unexpected data at the end of index file");
+    }
+    search_server.UpdateLogDocumentCount();
+    return search_server;
+}
+
+bool SearchServer::HasDocument(int document_id) const {
+    return document_ordinals_.count(document_id) != 0;
+}
+
+std::vector<std::pair<std::string_view, int>> SearchServer::GetQueryWordDocumentCounts(std::string_view raw_query) const {
+    QueryArenaScope arena_scope;
+    const Query query = ParseQuery(raw_query, arena_scope.GetResource());
+    std::vector<std::pair<std::string_view, int>> word_document_counts;
+    for (const std::string_view word : query.plus_words) {
+        if (const PostingList* postings = FindPostings(word)) {
+            word_document_counts.emplace_back(word, static_cast<int>(postings->size()));
+        }
+    }
+    return word_document_counts;
+}
+
+SearchServer SearchServer::MergeSegments(const std::vector<const SearchServer*>& segments,
+                                         const std::vector<const std::set<int>*>& excluded_ids) {
+    SearchServer merged;
+    if (segments.empty()) {
+        return merged;
+    }
+    const SearchServer& first = *segments.front();
+    merged.stop_words_ = first.stop_words_;
+    merged.max_result_document_count_ = first.max_result_document_count_;
+    merged.query_mode_ = first.query_mode_;
+    merged.posting_format_ = first.posting_format_;
+    merged.dynamic_pruning_ = first.dynamic_pruning_;
+    // Частоты слов берутся из прямых индексов сегментов, тексты документов заново не разбираются
+    for (size_t i = 0; i < segments.size(); ++i) {
+        const SearchServer* segment = segments[i];
+        const std::set<int>* segment_excluded_ids = excluded_ids[i];
+        for (const auto& [document_id, word_freqs] : segment->GetForwardIndex()) {
+            if (segment_excluded_ids != nullptr && segment_excluded_ids->count(document_id) != 0) {
+                continue;
+            }
+            const int ordinal = segment->document_ordinals_.at(document_id);
+            merged.InsertDocument(document_id, word_freqs, segment->statuses_[ordinal], segment->ratings_[ordinal]);
+        }
+    }
+    merged.Freeze();
+    return merged;
 }
 
 // Отдельный метод поиска слов в определенном документе. Возвращает кортеж (совпадающие слова, статус документа).
-std::tuple<std::vector<std::string>, DocumentStatus> SearchServer::MatchDocument(const std::string& raw_query, int document_id) const {
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    return MatchDocument(std::execution::seq, raw_query, document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::sequenced_policy&,
+                                                                                      std::string_view raw_query, int document_id) const {
+    const auto& [word_freqs, status] = GetMatchedDocumentData(document_id);
+    QueryArenaScope arena_scope;
+    const Query query = ParseQuery(raw_query, arena_scope.GetResource());
+
+    // Сначала минус-слова: если хоть одно есть в документе, плюс-слова можно не проверять
+    for (const std::string_view minus_word : query.minus_words) {
+        if (word_freqs.count(minus_word) != 0) {
+            return { std::vector<std::string_view>(), status };
+        }
+    }
+
+    std::vector<std::string_view> words_to_result;
+    for (const std::string_view plus_word : query.plus_words) {
+        const auto word_it = word_freqs.find(plus_word);
+        if (word_it != word_freqs.end()) {
+            words_to_result.push_back(word_it->first);  // ссылка на слово в словаре индекса, а не в запросе
+        }
+    }
+    return { words_to_result, status };
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::parallel_policy&,
+                                                                                      std::string_view raw_query, int document_id) const {
+    const auto& [word_freqs, status] = GetMatchedDocumentData(document_id);
+    // Повторы убираются уже после отбора совпавших слов, их обычно меньше, чем слов запроса
+    QueryArenaScope arena_scope;
+    const Query query = ParseQuery(raw_query, arena_scope.GetResource(), false);
+
+    const auto is_in_document = [&word_freqs](std::string_view word) {
+        return word_freqs.count(word) != 0;
+    };
+    if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(), is_in_document)) {
+        return { std::vector<std::string_view>(), status };
+    }
+
+    std::vector<std::string_view> words_to_result(query.plus_words.size());
+    const auto words_end = std::copy_if(std::execution::par, query.plus_words.begin(), query.plus_words.end(),
+                                        words_to_result.begin(), is_in_document);
+    std::sort(std::execution::par, words_to_result.begin(), words_end);
+    words_to_result.erase(std::unique(words_to_result.begin(), words_end), words_to_result.end());
+    std::transform(std::execution::par, words_to_result.begin(), words_to_result.end(), words_to_result.begin(),
+        [&word_freqs](std::string_view word) {
+            return word_freqs.find(word)->first;
+        });
+    return { words_to_result, status };
+}
+
+std::tuple<const std::map<std::string_view, double>&, DocumentStatus> SearchServer::GetMatchedDocumentData(int document_id) const {
     if (document_id < 0) {
         throw std::invalid_argument("invalid document_id");
     }
+    const auto ordinal_it = document_ordinals_.find(document_id);
+    if (ordinal_it == document_ordinals_.end()) {
+        throw std::out_of_range("document not found");
+    }
+    return { GetForwardIndex().at(document_id), statuses_[ordinal_it->second] };
+}
+
+const std::map<int, std::map<std::string_view, double>>& SearchServer::GetForwardIndex() const {
+    if (forward_index_.is_built.load(std::memory_order_acquire)) {
+        return forward_index_.word_freqs;
+    }
+    std::lock_guard guard(forward_index_.mutex);
+    if (forward_index_.is_built.load(std::memory_order_relaxed)) {
+        return forward_index_.word_freqs;
+    }
+    auto& document_to_word_freqs = forward_index_.word_freqs;
+    document_to_word_freqs.clear();
+    // Документы без слов тоже должны быть в прямом индексе, иначе RemoveDocument их не найдет.
+    // Словари документов запоминаем по номеру документа, чтобы не искать их в дереве на каждое вхождение.
+    std::vector<std::map<std::string_view, double>*> document_word_freqs(ordinal_to_id_.size());
+    for (const auto [document_id, ordinal] : document_ordinals_) {
+        const auto it = document_to_word_freqs.emplace_hint(document_to_word_freqs.end(), document_id,
+                                                             std::map<std::string_view, double>());
+        document_word_freqs[ordinal] = &it->second;
+    }
+    // Слова перебираются по возрастанию, поэтому в словарь документа они всегда добавляются в конец
+    ForEachPostings(*this, [&document_word_freqs](std::string_view word, const PostingList& postings) {
+        for (PostingList::Cursor cursor(postings); !cursor.AtEnd(); cursor.Next()) {
+            auto& word_freqs = *document_word_freqs[cursor.GetDocumentId()];
+            word_freqs.emplace_hint(word_freqs.end(), word, cursor.GetTermFreq());
+        }
+    });
+    forward_index_.is_built.store(true, std::memory_order_release);
+    return forward_index_.word_freqs;
+}
 
-    std::vector<std::string> words_to_result;
-    const Query query = ParseQuery(raw_query);
+void SearchServer::ResetForwardIndex() {
+    forward_index_.word_freqs.clear();
+    forward_index_.is_built = false;
+}
 
-    for (const std::string& plus_word : query.plus_words) {
-        if (word_to_document_freqs_.at(plus_word).count(document_id)) {
-            words_to_result.push_back(plus_word);
+void SearchServer::EraseEmptyWords(const std::map<std::string_view, double>& word_freqs) {
+    for (const auto [word, _] : word_freqs) {
+        const auto word_it = added_word_postings_.find(word);
+        if (word_it != added_word_postings_.end()) {
+            if (word_it->second.empty()) {
+                added_word_postings_.erase(word_it);
+            }
+            continue;
+        }
+        // Из неизменяемого словаря слово уйдет при следующем Freeze, а память списка освобождается сразу
+        PostingList& postings = frozen_postings_[frozen_words_.Find(word)];
+        if (postings.empty()) {
+            postings = PostingList();
+            if (posting_format_ == PostingFormat::COMPRESSED) {
+                postings.Compress();
+            }
         }
     }
+}
 
-    for (const std::string& minus_word : query.minus_words) {
-        if (word_to_document_freqs_.at(minus_word).count(document_id)) {
-            words_to_result.clear();
-            break;
+const PostingList* SearchServer::FindPostings(std::string_view word) const {
+    const uint32_t term_id = frozen_words_.Find(word);
+    if (term_id != TERM_NOT_FOUND) {
+        const PostingList& postings = frozen_postings_[term_id];
+        return postings.empty() ? nullptr : &postings;
+    }
+    const auto word_it = added_word_postings_.find(word);
+    return word_it == added_word_postings_.end() ? nullptr : &word_it->second;
+}
+
+std::pair<std::string_view, PostingList*> SearchServer::GetOrAddPostings(std::string_view word) {
+    const auto found = FindIndexPostings(word);
+    if (found.second != nullptr) {
+        return found;
+    }
+    // Копия слова создается только для нового слова словаря; в формате COMPRESSED список сразу сжатый
+    const auto word_it = added_word_postings_.emplace(std::string(word), PostingList()).first;
+    if (posting_format_ == PostingFormat::COMPRESSED) {
+        word_it->second.Compress();
+    }
+    return { word_it->first, &word_it->second };
+}
+
+std::pair<std::string_view, PostingList*> SearchServer::FindIndexPostings(std::string_view word) {
+    const uint32_t term_id = frozen_words_.Find(word);
+    if (term_id != TERM_NOT_FOUND) {
+        return { frozen_words_.GetTerm(term_id), &frozen_postings_[term_id] };
+    }
+    const auto word_it = added_word_postings_.find(word);
+    if (word_it == added_word_postings_.end()) {
+        return { std::string_view(), nullptr };
+    }
+    return { word_it->first, &word_it->second };
+}
+
+void SearchServer::AppendWordsWithPrefix(std::string_view prefix, std::pmr::vector<std::string_view>& words) const {
+    const auto [first, last] = frozen_words_.FindPrefix(prefix);
+    for (uint32_t term_id = first; term_id < last; ++term_id) {
+        if (!frozen_postings_[term_id].empty()) {
+            words.push_back(frozen_words_.GetTerm(term_id));
         }
     }
-    auto match_document = std::tuple{ words_to_result, documents_.at(document_id).status };
-    return match_document;
+    for (auto word_it = added_word_postings_.lower_bound(prefix);
+         word_it != added_word_postings_.end() && word_it->first.compare(0, prefix.size(), prefix) == 0; ++word_it) {
+        words.push_back(word_it->first);
+    }
 }
 
-bool SearchServer::IsStopWord(const std::string& word) const {
-    return stop_words_.count(word) > 0;
+bool SearchServer::IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    return (std::abs(lhs.relevance - rhs.relevance) < EPSILON)
+        ? lhs.rating > rhs.rating : lhs.relevance > rhs.relevance;
+}
+
+void SearchServer::SelectTopDocuments(const std::execution::sequenced_policy&, std::pmr::vector<Document>& documents,
+                                      size_t count) {
+    if (documents.size() > count) {
+        std::partial_sort(documents.begin(), documents.begin() + count, documents.end(), IsMoreRelevant);
+        documents.resize(count);
+    }
+    else {
+        std::sort(documents.begin(), documents.end(), IsMoreRelevant);
+    }
+}
+
+void SearchServer::SelectTopDocuments(const std::execution::parallel_policy&, std::pmr::vector<Document>& documents,
+                                      size_t count) {
+    // Небольшие выдачи быстрее обработать в одном потоке
+    const size_t min_chunk_size = 4096;
+    const size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    const size_t chunk_count = std::min(thread_count, documents.size() / min_chunk_size);
+    if (chunk_count < 2 || count >= documents.size() / chunk_count) {
+        SelectTopDocuments(std::execution::seq, documents, count);
+        return;
+    }
+
+    // Каждый кусок отбирает свои count лучших в начало куска
+    const size_t chunk_size = (documents.size() + chunk_count - 1) / chunk_count;
+    std::pmr::vector<size_t> chunk_begins(chunk_count, documents.get_allocator());
+    std::iota(chunk_begins.begin(), chunk_begins.end(), 0);
+    std::for_each(std::execution::par, chunk_begins.begin(), chunk_begins.end(),
+        [&documents, chunk_size, count](size_t& chunk_begin) {
+            chunk_begin *= chunk_size;
+            const auto begin = documents.begin() + chunk_begin;
+            const auto end = documents.begin() + std::min(chunk_begin + chunk_size, documents.size());
+            std::partial_sort(begin, begin + std::min<size_t>(count, end - begin), end, IsMoreRelevant);
+        });
+
+    std::pmr::vector<Document> candidates(documents.get_allocator());
+    candidates.reserve(chunk_count * count);
+    for (const size_t chunk_begin : chunk_begins) {
+        const size_t chunk_end = std::min(chunk_begin + chunk_size, documents.size());
+        const auto begin = documents.begin() + chunk_begin;
+        candidates.insert(candidates.end(), begin, begin + std::min(count, chunk_end - chunk_begin));
+    }
+    SelectTopDocuments(std::execution::seq, candidates, count);
+    documents = std::move(candidates);
+}
+
+bool SearchServer::IsStopWord(std::string_view word) const {
+    return stop_words_.Contains(word);
 }
 
 // статический метод проверки, что в слове нет спец символов с кодами от 0 до пробела
-bool SearchServer::IsValidWord(const std::string& word) {
+bool SearchServer::IsValidWord(std::string_view word) {
 // проверяем на валидность по спецсимволам
-    for (int i = 0; i < word.size(); ++i) {
-        if (word[i] >= '\0' && word[i] < ' ') {
-            return false;
-        }
-    }
-    return true;
+    return std::none_of(word.begin(), word.end(), [](char c) {
+        return c >= '\0' && c < ' ';
+    });
 }
 
-std::vector<std::string> SearchServer::SplitIntoWordsNoStop(const std::string& text) const {
-    std::vector<std::string> words;
-    for (const std::string& word : SplitIntoWords(text)) {
+std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
+    std::vector<std::string_view> words;
+    for (const std::string_view word : SplitIntoWords(text)) {
         if (!IsStopWord(word)) {
             words.push_back(word);
         }
@@ -111,63 +932,236 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
 }
 
 /* Отдельный метод определения: является ли слово "минус" или "плюс", "стоп-словом". Запись в структуру QueryWord. */
-SearchServer::QueryWord SearchServer::ParseQueryWord(std::string text) const {
+SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) const {
+    if (text.empty()) {
+        throw std::invalid_argument("query word not found");
+    }
     bool is_minus = false;
     // Проверки на корректность запроса
     if (text[0] == '-') {
-        if (text[0] == '-' && text[1] == '-') {
-            throw std::invalid_argument("invalid query (double minus)");
-        }
         if (text.size() == 1) {
             throw std::invalid_argument("invalid query (minus without word)");
         }
+        if (text[1] == '-') {
+            throw std::invalid_argument("invalid query (double minus)");
+        }
         is_minus = true;
-        text = text.substr(1);
+        text.remove_prefix(1);
     }
 
-    if (text[text.size() - 1] == '-') {
+    if (text.back() == '-') {
         throw std::invalid_argument("invalid query (minus end word)");
     }
 
-    if (text.empty()) {
-        throw std::invalid_argument("query word not found");
-    }
-
     if (!IsValidWord(text)) {
         throw std::invalid_argument("query word with special characters");
     }
-        
-    return { text, is_minus, IsStopWord(text) };
+
+    if (text.back() == '*') {
+        if (text.size() == 1) {
+            throw std::invalid_argument("invalid query (asterisk without prefix)");
+        }
+        text.remove_suffix(1);
+        return { text, is_minus, false, true };
+    }
+    return { text, is_minus, IsStopWord(text), false };
 }
 
-SearchServer::Query SearchServer::ParseQuery(const std::string& text) const {
-    SearchServer::Query query;
-    for (const std::string& word : SplitIntoWords(text)) {
+SearchServer::Query SearchServer::ParseQuery(std::string_view text, std::pmr::memory_resource* resource,
+                                             bool deduplicate) const {
+    SearchServer::Query query(resource);
+    for (const std::string_view word : SplitIntoWords(text, resource)) {
         const QueryWord query_word = ParseQueryWord(word);
+        auto& words = query_word.is_minus ? query.minus_words : query.plus_words;
 
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                query.minus_words.insert(query_word.data);
-            }
-            else {
-                query.plus_words.insert(query_word.data);
-            }
+        if (query_word.is_prefix) {
+            AppendWordsWithPrefix(query_word.data, words);
+        }
+        else if (!query_word.is_stop) {
+            words.push_back(query_word.data);
         }
     }
+    if (!deduplicate) {
+        return query;
+    }
+    // Вместо set: сортируем и убираем повторы, не выделяя память под каждое слово
+    for (auto* words : {&query.plus_words, &query.minus_words}) {
+        std::sort(words->begin(), words->end());
+        words->erase(std::unique(words->begin(), words->end()), words->end());
+    }
     return query;
 }
 
-// Existence required, IDF
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string& word) const {
-    return log(documents_.size() * 1.0 / word_to_document_freqs_.at(word).size());
+std::pmr::vector<int> SearchServer::CollectExcludedOrdinals(const Query& query) const {
+    std::pmr::memory_resource* resource = query.minus_words.get_allocator().resource();
+    std::pmr::vector<int> excluded_ordinals(resource);
+    if (query.minus_words.empty()) {
+        return excluded_ordinals;
+    }
+    // Сбор идет посреди обхода списков: время до него остается обходу, а сам сбор - отдельная фаза
+    if (query.trace != nullptr) {
+        query.trace->FinishPhase(QueryPhase::POSTING_SCAN);
+    }
+    std::pmr::vector<int> merged_ordinals(resource);
+    std::pmr::vector<int> decoded_ordinals(resource);
+    for (const std::string_view word : query.minus_words) {
+        const PostingList* postings_ptr = FindPostings(word);
+        if (postings_ptr == nullptr) {
+            continue;
+        }
+        const PostingList& postings = *postings_ptr;
+        merged_ordinals.clear();
+        if (postings.IsCompressed()) {
+            decoded_ordinals.clear();
+            postings.AppendDocumentIds(decoded_ordinals);
+            UnionSorted(excluded_ordinals, decoded_ordinals, merged_ordinals);
+        }
+        else {
+            UnionSorted(excluded_ordinals, postings.GetDocumentIds(), merged_ordinals);
+        }
+        excluded_ordinals.swap(merged_ordinals);
+    }
+    if (query.trace != nullptr) {
+        query.trace->FinishPhase(QueryPhase::MINUS_FILTER);
+    }
+    return excluded_ordinals;
+}
+
+std::pmr::vector<int> SearchServer::CollectOrdinalsWithAllWords(const Query& query,
+                                                                std::pmr::vector<const PostingList*>& postings) const {
+    std::pmr::memory_resource* resource = query.plus_words.get_allocator().resource();
+    postings.clear();
+    for (const std::string_view word : query.plus_words) {
+        const PostingList* word_postings = FindPostings(word);
+        if (word_postings == nullptr) {
+            postings.clear();
+            return std::pmr::vector<int>(resource);
+        }
+        postings.push_back(word_postings);
+    }
+    if (postings.empty()) {
+        return std::pmr::vector<int>(resource);
+    }
+
+    // Чем короче промежуточный результат, тем чаще следующее пересечение идет галопом
+    std::pmr::vector<const PostingList*> postings_by_size(postings, resource);
+    std::sort(postings_by_size.begin(), postings_by_size.end(),
+        [](const PostingList* lhs, const PostingList* rhs) {
+            return lhs->size() < rhs->size();
+        });
+    std::pmr::vector<int> ordinals(resource);
+    postings_by_size.front()->AppendDocumentIds(ordinals);
+    for (size_t i = 1; i < postings_by_size.size() && !ordinals.empty(); ++i) {
+        postings_by_size[i]->KeepContained(ordinals);
+    }
+
+    const std::pmr::vector<int> excluded_ordinals = CollectExcludedOrdinals(query);
+    if (!excluded_ordinals.empty() && !ordinals.empty()) {
+        std::pmr::vector<uint32_t> positions(resource);
+        DifferenceSorted(ordinals, excluded_ordinals, positions);
+        query.Trace(QueryCounter::ERASED_BY_MINUS_WORDS, ordinals.size() - positions.size());
+        KeepPositions(ordinals, positions);
+    }
+    return ordinals;
+}
+
+void SearchServer::KeepPositions(std::pmr::vector<int>& values, const std::pmr::vector<uint32_t>& positions) {
+    for (size_t i = 0; i < positions.size(); ++i) {
+        values[i] = values[positions[i]];
+    }
+    values.resize(positions.size());
+}
+
+void SearchServer::RelevanceAccumulator::Add(int ordinal, double relevance) {
+    if (!is_touched[ordinal]) {
+        is_touched[ordinal] = true;
+        touched_ordinals.push_back(ordinal);
+    }
+    relevances[ordinal] += relevance;
+}
+
+void SearchServer::RelevanceAccumulator::Reset() {
+    for (const int ordinal : touched_ordinals) {
+        relevances[ordinal] = 0.0;
+        is_touched[ordinal] = false;
+    }
+    touched_ordinals.clear();
+}
+
+SearchServer::RelevanceAccumulatorLease::RelevanceAccumulatorLease(const SearchServer& server) {
+    // Несколько накопителей на поток: сервер с большим индексом не раздувает накопитель малого,
+    // а вложенный поиск из предиката не портит накопитель внешнего
+    static const size_t THREAD_ACCUMULATOR_COUNT = 4;
+    thread_local std::array<RelevanceAccumulator, THREAD_ACCUMULATOR_COUNT> accumulators;
+    thread_local uint64_t use_count = 0;
+
+    RelevanceAccumulator* least_recent = nullptr;
+    accumulator_ = nullptr;
+    for (RelevanceAccumulator& accumulator : accumulators) {
+        if (accumulator.is_busy) {
+            continue;
+        }
+        if (accumulator.owner_id == server.instance_id_) {
+            accumulator_ = &accumulator;
+            break;
+        }
+        if (least_recent == nullptr || accumulator.last_use < least_recent->last_use) {
+            least_recent = &accumulator;
+        }
+    }
+    if (accumulator_ == nullptr && least_recent != nullptr) {
+        // Память прежнего сервера освобождается, массивы заводятся заново под размер этого
+        accumulator_ = least_recent;
+        accumulator_->relevances = {};
+        accumulator_->is_touched = {};
+        accumulator_->owner_id = server.instance_id_;
+    }
+    if (accumulator_ == nullptr) {
+        temporary_ = std::make_unique<RelevanceAccumulator>();
+        accumulator_ = temporary_.get();
+    }
+    const size_t ordinal_count = server.ordinal_to_id_.size();
+    if (accumulator_->relevances.size() < ordinal_count) {
+        accumulator_->relevances.resize(ordinal_count);
+        accumulator_->is_touched.resize(ordinal_count);
+    }
+    accumulator_->is_busy = true;
+    accumulator_->last_use = ++use_count;
+}
+
+SearchServer::RelevanceAccumulatorLease::~RelevanceAccumulatorLease() {
+    accumulator_->Reset();
+    accumulator_->is_busy = false;
+}
+
+uint64_t SearchServer::NextInstanceId() {
+    static std::atomic<uint64_t> next_id(1);
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+SearchServer::PruningStats& SearchServer::GetThreadPruningStats() {
+    thread_local PruningStats stats;
+    return stats;
+}
+
+double SearchServer::ComputeWordInverseDocumentFreq(const Query& query, std::string_view word,
+                                                    const PostingList& postings) const {
+    if (query.inverse_document_freqs != nullptr) {
+        const auto it = query.inverse_document_freqs->find(word);
+        return it == query.inverse_document_freqs->end() ? 0.0 : it->second;
+    }
+    return log_document_count_ - postings.GetLogDocumentFreq();
+}
+
+void SearchServer::UpdateLogDocumentCount() {
+    log_document_count_ = document_ordinals_.empty() ? 0.0 : std::log(static_cast<double>(document_ordinals_.size()));
 }
 
-void PrintMatchedDocument(const std::tuple<std::vector<std::string>, DocumentStatus>& matchResult) {
-    std::vector<std::string> matchedWords = std::get<0>(matchResult);
-    DocumentStatus documentStatus = std::get<1>(matchResult);
+void PrintMatchedDocument(const std::tuple<std::vector<std::string_view>, DocumentStatus>& matchResult) {
+    const auto& [matchedWords, documentStatus] = matchResult;
 
     std::cout << "Matched words: ";
-    for (const std::string& word : matchedWords) {
+    for (const std::string_view word : matchedWords) {
         std::cout << word << " ";
     }
     std::cout << "\nDocument Status: " << static_cast<int>(documentStatus) << std::endl;
@@ -1,154 +1,1126 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <iostream>
 #include <set>
 #include <map>
+#include <memory_resource>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <algorithm>
 #include <cmath>
 #include <stdexcept>
 #include <numeric>
+#include <execution>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <type_traits>
 #include "document.h"
+#include "posting_list.h"
+#include "posting_set_operations.h"
+#include "query_arena.h"
+#include "query_stats.h"
 #include "string_processing.h"
+#include "term_dictionary.h"
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 const double EPSILON = 1e-6;
+const size_t INGEST_WORD_GROUP_COUNT = 64;  // групп слов при параллельном добавлении пакета документов
+const int PARALLEL_SEARCH_CHUNK_SIZE = 4096;  // номеров документов в одной части при параллельном поиске
+
+// Какие документы находит запрос: содержащие хотя бы одно плюс-слово или все плюс-слова сразу
+enum class QueryMode {
+    ANY_WORD,
+    ALL_WORDS,
+};
+
+// Формат списков вхождений: несжатые массивы или сжатые блоки (см. PostingList::Compress)
+enum class PostingFormat {
+    PLAIN,
+    COMPRESSED,
+};
+
+// Что проверяет OpenIndex в файле индекса
+enum class IndexVerification {
+    // Контрольная сумма и все списки вхождений; файл при загрузке читается целиком
+    FULL,
+    // Только заголовок, документы и слова. Страницы списков вхождений подгружаются при первом поиске по ним,
+    // поэтому загрузка не зависит от их объема. Для своих файлов: испорченный список - неопределенное поведение.
+    TRUSTED,
+};
+
+class MappedFile;
+
+// Документ для пакетной загрузки. Текст не копируется и должен жить до конца AddDocuments.
+struct RawDocument {
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
 
 class SearchServer {
 public:
+    // Счетчики динамического отсечения в текущем потоке (см. SetDynamicPruning)
+    struct PruningStats {
+        uint64_t query_postings = 0;  // вхождений в списках плюс-слов запросов
+        uint64_t scored_postings = 0;  // из них прочитаны TF; остальные пропущены
+    };
+
     template <typename StringContainer>  // шаблонный конструктор для контейнеров set и vector
     explicit SearchServer(const StringContainer& stop_words);
 
     explicit SearchServer(const std::string& stop_words);
 
+    explicit SearchServer(std::string_view stop_words);
+
     SearchServer();  // Конструктор по умолчанию
 
-    void AddDocument(int document_id, const std::string& document, DocumentStatus status,
+    // Прямой индекс ссылается на слова в памяти индекса, поэтому при копировании он перестраивается.
+    // Перемещение тексты слов не трогает, и его можно оставить по умолчанию.
+    SearchServer(const SearchServer& other);
+    SearchServer& operator=(const SearchServer& other);
+    SearchServer(SearchServer&& other) = default;
+    SearchServer& operator=(SearchServer&& other) = default;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status,
                      const std::vector<int>& ratings);
 
+    // Пакетное добавление: тексты разбираются на слова и TF (параллельно для par), затем вносятся в индекс
+    // (для par - параллельно по группам слов). Если хоть один документ некорректен, индекс не меняется.
+    void AddDocuments(const std::vector<RawDocument>& documents);
+    void AddDocuments(const std::execution::sequenced_policy&, const std::vector<RawDocument>& documents);
+    void AddDocuments(const std::execution::parallel_policy&, const std::vector<RawDocument>& documents);
+
+    // Слово запроса вида "prefix*" (и минус-слово "-prefix*") заменяется всеми словами индекса с этим префиксом,
+    // как если бы они были перечислены в запросе. Одна "*" без префикса - std::invalid_argument.
+
     // Поиск с фильтром (предикатом)
     template <typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentPredicate predicate) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate predicate) const;
 
     // Поиск для определенного статуса
-    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentStatus raw_status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus raw_status) const;
 
     // Поиск актуальных документов (запрос с одним параметром)
-    std::vector<Document> FindTopDocuments(const std::string& raw_query) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    // Те же варианты поиска с политикой выполнения (std::execution::seq или std::execution::par)
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+                                           DocumentPredicate predicate) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+                                           DocumentStatus raw_status) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const;
+
+    // Поиск с трассировкой: в trace записываются время фаз и счетчики этого запроса.
+    // DocumentFilter - предикат или DocumentStatus.
+    template <typename DocumentFilter>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, const DocumentFilter& filter,
+                                           QueryTrace& trace) const;
+
+    template <typename ExecutionPolicy, typename DocumentFilter>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+                                           const DocumentFilter& filter, QueryTrace& trace) const;
+
+    // Страница номер page (с нуля) по page_size документов в порядке выдачи FindTopDocuments, без ограничения
+    // GetMaxResultDocumentCount. Упорядочиваются только документы этой страницы: документы предыдущих страниц
+    // лишь отделяются от остальных за линейное время. DocumentFilter - предикат или DocumentStatus.
+    std::vector<Document> FindDocumentsPage(std::string_view raw_query, size_t page, size_t page_size) const;
+
+    template <typename DocumentFilter>
+    std::vector<Document> FindDocumentsPage(std::string_view raw_query, size_t page, size_t page_size,
+                                            const DocumentFilter& filter) const;
+
+    template <typename ExecutionPolicy, typename DocumentFilter>
+    std::vector<Document> FindDocumentsPage(ExecutionPolicy&& policy, std::string_view raw_query, size_t page,
+                                            size_t page_size, const DocumentFilter& filter) const;
+
+    // Сколько документов возвращает FindTopDocuments (по умолчанию MAX_RESULT_DOCUMENT_COUNT)
+    void SetMaxResultDocumentCount(size_t count);
+    size_t GetMaxResultDocumentCount() const;
+
+    // Режим отбора документов по плюс-словам (по умолчанию QueryMode::ANY_WORD)
+    void SetQueryMode(QueryMode mode);
+    QueryMode GetQueryMode() const;
+
+    // Отсечение при последовательном FindTopDocuments в режиме QueryMode::ANY_WORD (по умолчанию выключено):
+    // документы, которые заведомо не войдут в выдачу, не оцениваются. Результаты те же, что при полном переборе.
+    // Выгодно на длинных запросах к текстам с неравномерными частотами слов и при небольшом числе результатов;
+    // на коротких запросах обход всех вхождений быстрее.
+    void SetDynamicPruning(bool enabled);
+    bool IsDynamicPruningEnabled() const;
+
+    static PruningStats GetPruningStats();
+    static void ResetPruningStats();
+
+    // Время фаз, счетчики и гистограммы длительностей по всем FindTopDocuments этого сервера
+    // (нули, если сбор вырезан: SEARCH_SERVER_STATS == 0). Копия сервера начинает с нулей.
+    SearchStats GetStats() const;
+
+    // Запросы пишутся в recorder, который может быть общим у нескольких серверов (например, у версий одного
+    // индекса в SnapshotSearchServer); GetStats возвращает его сводку. nullptr - std::invalid_argument.
+    void SetStatsRecorder(std::shared_ptr<QueryStatsRecorder> recorder);
+
+    // Формат списков вхождений (по умолчанию PostingFormat::PLAIN). Списки перекодируются сразу, сжатые списки
+    // и при изменении остаются сжатыми. В формате COMPRESSED TF округляется до float один раз - при внесении
+    // документа или переходе в этот формат; прямой индекс хранит те же значения, поэтому повторные сжатия
+    // и распаковки релевантность не меняют.
+    void SetPostingFormat(PostingFormat format);
+    PostingFormat GetPostingFormat() const;
+
+    // Число вхождений во всех списках и занятая ими память в байтах
+    size_t GetPostingCount() const;
+    size_t GetPostingMemoryUsage() const;
+
+    // Число слов индекса и память, занятая самими словами (без списков вхождений), в байтах
+    size_t GetWordCount() const;
+    size_t GetDictionaryMemoryUsage() const;
+
+    // Номер версии индекса: растет при каждом изменении, влияющем на результаты поиска
+    uint64_t GetIndexVersion() const;
+
+    // Запрос в каноническом виде: отсортированные плюс-слова, затем минус-слова, без стоп-слов и повторов.
+    // У запросов с одинаковым каноническим видом одинаковые результаты.
+    std::string GetCanonicalQuery(std::string_view raw_query) const;
 
     // метод получения количества документов
     int GetDocumentCount() const;
 
-    // метод получения id документа по индексу в словаре
+    // метод получения id документа по порядковому номеру за O(1); порядок тот же, что у begin()/end()
     int GetDocumentId(int index) const;
 
+    // Обход id документов в порядке их номеров: в порядке добавления, но на место удаленного документа
+    // встает последний
+    std::vector<int>::const_iterator begin() const;
+    std::vector<int>::const_iterator end() const;
+
+    // Частоты слов документа (прямой индекс). Для неизвестного id возвращается пустой словарь.
+    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+
+    // Удаление документа затрагивает только списки вхождений его собственных слов
+    void RemoveDocument(int document_id);
+    void RemoveDocument(const std::execution::sequenced_policy&, int document_id);
+    void RemoveDocument(const std::execution::parallel_policy&, int document_id);
+
+    // Сжимает списки вхождений после массовой загрузки документов (в формате PostingFormat::COMPRESSED - кодирует их)
+    // и собирает все слова индекса в компактный словарь (TermDictionary). Слова, впервые встреченные после Freeze,
+    // до следующего Freeze хранятся в обычном дереве.
+    void Freeze();
+
+    // Сохраняет индекс (настройки поиска, стоп-слова, документы, словарь и списки вхождений) в двоичный файл
+    // с версией и контрольной суммой. Файл заменяется атомарно: пишется рядом и переименовывается поверх path.
+    // Ошибки ввода-вывода и формата - std::runtime_error.
+    void SaveIndex(const std::string& path) const;
+
+    // Загружает индекс из файла SaveIndex без повторного разбора текстов. Файл отображается в память, и несжатые
+    // списки вхождений читают массивы прямо из него (сжатые кодируются при загрузке); список копирует свои массивы
+    // при первом изменении. Отображение открыто, пока жив сервер или его копии. Прямой индекс строится при первом
+    // обращении. Проверяется, что id документов неотрицательны и строго возрастают, а при IndexVerification::FULL
+    // также контрольная сумма и что номера в списках вхождений строго возрастают и не выходят за число документов.
+    static SearchServer OpenIndex(const std::string& path, IndexVerification verification = IndexVerification::FULL);
+
+    // Для индекса из нескольких сегментов (SegmentedSearchServer). IDF там считается по всем сегментам сразу:
+    // сначала у каждого сегмента запрашиваются числа документов с плюс-словами, затем каждый сегмент ищет
+    // с общими IDF, а лучшие документы отбираются среди найденных всеми сегментами.
+
+    // Есть ли в индексе документ с таким id
+    bool HasDocument(int document_id) const;
+
+    // Плюс-слова запроса (с раскрытыми префиксами), которые есть в индексе, и число документов с каждым из них
+    std::vector<std::pair<std::string_view, int>> GetQueryWordDocumentCounts(std::string_view raw_query) const;
+
+    // Все найденные документы без отбора лучших, по возрастанию номеров. IDF плюс-слов берется
+    // из inverse_document_freqs; слова, которых там нет, не учитываются.
+    template <typename DocumentFilter>
+    std::vector<Document> FindSegmentDocuments(std::string_view raw_query, const DocumentFilter& filter,
+                                               const std::map<std::string_view, double>& inverse_document_freqs) const;
+
+    // Новый индекс с документами всех сегментов, собранный через Freeze. Из segments[i] не переносятся
+    // id из excluded_ids[i] (nullptr - переносятся все). Стоп-слова и настройки берутся у первого сегмента.
+    // id перенесенных документов не должны повторяться.
+    static SearchServer MergeSegments(const std::vector<const SearchServer*>& segments,
+                                      const std::vector<const std::set<int>*>& excluded_ids);
+
+    // Порядок выдачи: по убыванию релевантности, при равной (с точностью EPSILON) - по убыванию рейтинга
+    static bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
     // Отдельный метод поиска слов в определенном документе. Возвращает кортеж (совпадающие слова, статус документа).
-    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const std::string& raw_query, int document_id) const;
+    // Слова результата ссылаются на словарь индекса и действительны, пока слово не удалено из индекса и до Freeze.
+    // Слова, которых нет в индексе, просто не совпадают. Неизвестный id - std::out_of_range.
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::sequenced_policy&,
+                                                                            std::string_view raw_query, int document_id) const;
+
+    // Минус-слова и плюс-слова проверяются параллельно по словам самого документа
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy&,
+                                                                            std::string_view raw_query, int document_id) const;
 
 private:
-    struct DocumentData {
-        int rating;
-        DocumentStatus status;
+    static const size_t DOCUMENT_STATUS_COUNT = 4;
+
+    // Релевантность документов запроса по номеру документа. Массивы живут в кэше потока и растут вместе
+    // с индексом; после запроса обнуляются только затронутые номера, поэтому очистка не зависит от числа документов.
+    struct RelevanceAccumulator {
+        std::vector<double> relevances;
+        std::vector<char> is_touched;
+        std::vector<int> touched_ordinals;
+        uint64_t owner_id = 0;  // instance_id_ сервера, под чьи номера заведены массивы
+        uint64_t last_use = 0;
+        bool is_busy = false;
+
+        void Add(int ordinal, double relevance);
+        void Reset();
     };
+    // Накопитель на время одного запроса. Берется из кэша потока (предпочтительно заведенный под этот же сервер)
+    // и очищается в деструкторе при любом выходе, в том числе по исключению из предиката. Если все накопители
+    // потока заняты (предикат сам вызвал поиск), запрос получает временный.
+    class RelevanceAccumulatorLease {
+    public:
+        explicit RelevanceAccumulatorLease(const SearchServer& server);
+        ~RelevanceAccumulatorLease();
+        RelevanceAccumulatorLease(const RelevanceAccumulatorLease&) = delete;
+        RelevanceAccumulatorLease& operator=(const RelevanceAccumulatorLease&) = delete;
+
+        RelevanceAccumulator* operator->() const {
+            return accumulator_;
+        }
+
+    private:
+        std::unique_ptr<RelevanceAccumulator> temporary_;
+        RelevanceAccumulator* accumulator_;
+    };
+    // Слова запроса ссылаются на строку запроса и не копируются
     struct QueryWord {
-        std::string data;
+        std::string_view data;  // у слова с префиксом - без "*"
         bool is_minus;
         bool is_stop;
+        bool is_prefix;
     };
+    // Векторы слов берут память из арены запроса (QueryArenaScope), как и остальные временные контейнеры поиска
     struct Query {
-        std::set<std::string> plus_words;
-        std::set<std::string> minus_words;
+        std::pmr::vector<std::string_view> plus_words;  // отсортированы, без повторов
+        std::pmr::vector<std::string_view> minus_words;
+        const std::map<std::string_view, double>* inverse_document_freqs = nullptr;  // IDF по всем сегментам
+        QueryTrace* trace = nullptr;  // куда записывать время фаз и счетчики
+
+        void Trace(QueryCounter counter, uint64_t value) const {
+            if (trace != nullptr) {
+                trace->Add(counter, value);
+            }
+        }
+
+        explicit Query(std::pmr::memory_resource* resource)
+            : plus_words(resource)
+            , minus_words(resource) {
+        }
+    };
+    size_t max_result_document_count_ = MAX_RESULT_DOCUMENT_COUNT;
+    QueryMode query_mode_ = QueryMode::ANY_WORD;
+    PostingFormat posting_format_ = PostingFormat::PLAIN;
+    bool dynamic_pruning_ = false;
+    TermDictionary stop_words_;
+    // Слова индекса хранятся в компактном словаре, собранном при последнем Freeze (или OpenIndex), списки вхождений -
+    // по номеру слова в нем. Новые слова до следующего Freeze попадают в дерево. Слово есть ровно в одном из них;
+    // опустевшее слово словаря остается в нем с пустым списком и считается отсутствующим.
+    TermDictionary frozen_words_;
+    std::vector<PostingList> frozen_postings_;  // отсортированные номера (ordinal) документов и tf по номеру слова
+    std::map<std::string, PostingList, std::less<>> added_word_postings_;  // слова, впервые встреченные после Freeze
+    // Внутри индекса документ задается плотным номером (ordinal) 0..N-1, списки вхождений хранят номера.
+    // По номеру без поиска в дереве берутся id, рейтинг и статус. На номер удаленного документа переезжает
+    // последний, поэтому номера всегда плотные и массивы по номерам не длиннее числа документов,
+    // а новые документы дописываются в конец списков вхождений.
+    std::map<int, int> document_ordinals_;  // id -> номер
+    std::vector<int> ordinal_to_id_;
+    std::vector<int> ratings_;  // рейтинг по номеру
+    std::vector<DocumentStatus> statuses_;  // статус по номеру
+    std::array<std::vector<bool>, DOCUMENT_STATUS_COUNT> status_bitmaps_;  // бит номера выставлен, если у документа этот статус
+    double log_document_count_ = 0.0;  // log(document_ordinals_.size())
+    uint64_t index_version_ = 0;
+    uint64_t instance_id_ = NextInstanceId();  // ключ накопителей релевантности в кэше потока, у копии свой
+    std::shared_ptr<const MappedFile> mapped_file_;  // файл OpenIndex, из которого читают списки вхождений
+    // Прямой индекс: id, слово (в памяти индекса), tf. Нужен только MatchDocument, RemoveDocument и
+    // GetWordFrequencies, поэтому строится по спискам вхождений при первом обращении к нему (GetForwardIndex),
+    // в том числе из нескольких потоков сразу. Копия сервера и загруженный из файла сервер начинают без него.
+    struct ForwardIndex {
+        std::map<int, std::map<std::string_view, double>> word_freqs;
+        std::atomic<bool> is_built = false;
+        std::mutex mutex;
+
+        ForwardIndex() = default;
+        ForwardIndex(const ForwardIndex&) {
+        }
+        ForwardIndex(ForwardIndex&& other) noexcept
+            : word_freqs(std::move(other.word_freqs))
+            , is_built(other.is_built.load()) {
+        }
+        ForwardIndex& operator=(const ForwardIndex&) {
+            word_freqs.clear();
+            is_built = false;
+            return *this;
+        }
+        ForwardIndex& operator=(ForwardIndex&& other) noexcept {
+            word_freqs = std::move(other.word_freqs);
+            is_built = other.is_built.load();
+            return *this;
+        }
+    };
+    mutable ForwardIndex forward_index_;
+    // Копия заводит свой пустой recorder, перемещенный сервер продолжает писать в прежний
+    struct StatsRecorderHolder {
+        std::shared_ptr<QueryStatsRecorder> recorder = std::make_shared<QueryStatsRecorder>();
+
+        StatsRecorderHolder() = default;
+        StatsRecorderHolder(const StatsRecorderHolder&) {
+        }
+        StatsRecorderHolder(StatsRecorderHolder&& other) noexcept : recorder(other.recorder) {
+        }
+        StatsRecorderHolder& operator=(const StatsRecorderHolder&) {
+            recorder = std::make_shared<QueryStatsRecorder>();
+            return *this;
+        }
+        StatsRecorderHolder& operator=(StatsRecorderHolder&& other) noexcept {
+            recorder = other.recorder;
+            return *this;
+        }
     };
-    std::vector<int> id_number_;
-    std::set<std::string> stop_words_;
-    std::map<std::string, std::map<int, double>> word_to_document_freqs_;  // хранит: слово (string), номера документов (int), tf (double)
-    std::map<int, DocumentData> documents_; // id, rating, status
+    StatsRecorderHolder stats_;
+
+    // Прямой индекс; при первом обращении строится по спискам вхождений
+    const std::map<int, std::map<std::string_view, double>>& GetForwardIndex() const;
+
+    // Сбрасывает прямой индекс, когда слова или TF в нем устаревают; он будет построен заново при обращении
+    void ResetForwardIndex();
+
+    // Убирает из словаря слова, у которых не осталось документов
+    void EraseEmptyWords(const std::map<std::string_view, double>& word_freqs);
+
+    // Список вхождений слова или nullptr, если в индексе нет документов с этим словом
+    const PostingList* FindPostings(std::string_view word) const;
+
+    // Список вхождений слова для изменения (новое слово заводится в added_word_postings_) и слово в памяти индекса
+    std::pair<std::string_view, PostingList*> GetOrAddPostings(std::string_view word);
+
+    // То же без добавления: для слова, которого нет в словаре, - {"", nullptr}. Словарь не меняется,
+    // поэтому можно вызывать из нескольких потоков сразу.
+    std::pair<std::string_view, PostingList*> FindIndexPostings(std::string_view word);
 
-    bool IsStopWord(const std::string& word) const;
+    // Обход непустых списков вхождений по возрастанию слов: function(слово, список).
+    // Server - SearchServer или const SearchServer.
+    template <typename Server, typename Function>
+    static void ForEachPostings(Server& server, Function function);
+
+    // Дописывает в words слова индекса, начинающиеся с prefix, по возрастанию
+    void AppendWordsWithPrefix(std::string_view prefix, std::pmr::vector<std::string_view>& words) const;
+
+    bool IsStopWord(std::string_view word) const;
 
     // статический метод проверки, что в слове нет спец символов с кодами от 0 до пробела
-    static bool IsValidWord(const std::string& word);
+    static bool IsValidWord(std::string_view word);
+
+    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
+
+    // Частоты слов документа; слова ссылаются на текст документа. Индекс не читается, можно вызывать из разных потоков.
+    std::map<std::string_view, double> ComputeWordFreqs(std::string_view document) const;
+
+    // TF в том виде, в каком он хранится в индексе текущего формата
+    double GetStoredTermFreq(double term_freq) const;
+
+    // Проверки id, общие для AddDocument и AddDocuments
+    void CheckNewDocumentId(int document_id) const;
+
+    // Заводит номер документа и его данные; возвращает номер
+    int AppendDocumentData(int document_id, DocumentStatus status, int rating);
 
-    std::vector<std::string> SplitIntoWordsNoStop(const std::string& text) const;
+    // Убирает документ из прямого индекса и таблиц номеров (после чистки списков вхождений).
+    // На освободившийся номер переезжает последний документ.
+    void EraseDocumentData(std::map<int, std::map<std::string_view, double>>::iterator document_it);
+
+    // Переносит документ с номера from на свободный номер to: в его списках вхождений и таблицах номеров
+    void MoveDocumentOrdinal(int from, int to);
+
+    // Вносит в индекс документ с уже посчитанными частотами слов
+    void InsertDocument(int document_id, const std::map<std::string_view, double>& word_freqs,
+                        DocumentStatus status, int rating);
+
+    template <typename ExecutionPolicy>
+    void AddDocumentsImpl(ExecutionPolicy&& policy, const std::vector<RawDocument>& documents);
+
+    // Вносит в индекс проверенный пакет документов с посчитанными частотами слов
+    void InsertDocuments(const std::execution::sequenced_policy&, const std::vector<RawDocument>& documents,
+                         const std::vector<std::map<std::string_view, double>>& word_freqs);
+
+    // Таблицы номеров заполняются последовательно, списки вхождений - параллельно по группам слов (по хешу слова).
+    // Слово всегда попадает в одну группу, поэтому каждый список меняет один поток и блокировки не нужны;
+    // новые слова заводятся в словаре последовательно между проходами.
+    void InsertDocuments(const std::execution::parallel_policy&, const std::vector<RawDocument>& documents,
+                         const std::vector<std::map<std::string_view, double>>& word_freqs);
 
     // Статический метод расчета среднего рейтинга
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
     /* Отдельный метод определения: является ли слово "минус" или "плюс", "стоп-словом". Запись в структуру QueryWord. */
-    QueryWord ParseQueryWord(std::string text) const;
+    QueryWord ParseQueryWord(std::string_view text) const;
 
-    Query ParseQuery(const std::string& text) const;
+    // deduplicate = false оставляет слова в порядке запроса и с повторами (для параллельного MatchDocument)
+    Query ParseQuery(std::string_view text, std::pmr::memory_resource* resource, bool deduplicate = true) const;
 
-    // Existence required, IDF
-    double ComputeWordInverseDocumentFreq(const std::string& word) const;
+    // Прямой индекс и статус документа для MatchDocument с проверкой id
+    std::tuple<const std::map<std::string_view, double>&, DocumentStatus> GetMatchedDocumentData(int document_id) const;
 
-    template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate predicate) const;
+    // IDF = log(N / df) = log(N) - log(df): оба логарифма хранятся готовыми и обновляются
+    // при добавлении и удалении документов, поэтому при поиске log не вызывается.
+    // Если у запроса заданы общие IDF сегментов, берется оттуда (0 для слова, которого там нет).
+    double ComputeWordInverseDocumentFreq(const Query& query, std::string_view word, const PostingList& postings) const;
+
+    // Отсортированные номера документов со всеми минус-словами запроса (объединение их списков вхождений).
+    // Результат и промежуточные массивы - в памяти запроса.
+    std::pmr::vector<int> CollectExcludedOrdinals(const Query& query) const;
+
+    // Номера документов, в которых есть все плюс-слова и нет минус-слов. Списки вхождений пересекаются
+    // от коротких к длинным. В postings - списки плюс-слов в порядке запроса (пусто, если какого-то слова нет).
+    std::pmr::vector<int> CollectOrdinalsWithAllWords(const Query& query,
+                                                      std::pmr::vector<const PostingList*>& postings) const;
+
+    // Оставляет в values элементы с позициями из positions (позиции по возрастанию)
+    static void KeepPositions(std::pmr::vector<int>& values, const std::pmr::vector<uint32_t>& positions);
+
+    // Вызывает function(номер, tf) для вхождений, номера которых не входят в excluded_ordinals, и возвращает
+    // число пропущенных. Несжатый список вычитается через DifferenceSorted, сжатый распаковывается прямо в цикле обхода.
+    template <typename Function>
+    static size_t ForEachNotExcluded(const PostingList& postings, const std::pmr::vector<int>& excluded_ordinals,
+                                     std::pmr::vector<uint32_t>& positions, Function function);
+
+    static uint64_t NextInstanceId();
+
+    // Счетчики отсечения текущего потока
+    static PruningStats& GetThreadPruningStats();
+
+    // Вызовы фильтра считаются, только если фильтр - предикат
+    template <typename DocumentFilter>
+    static void TracePredicateCalls(const Query& query, uint64_t count);
+
+    // Запрос попадает в GetStats и, если передан user_trace, копируется туда
+    void RecordQuery(const QueryTrace& trace, QueryTrace* user_trace) const;
 
+    // Пересчет log(N) после изменения числа документов
+    void UpdateLogDocumentCount();
+
+    // Оставляет в documents только count лучших, упорядоченных по IsMoreRelevant.
+    // Полная сортировка не нужна: последовательно - partial_sort (куча на count элементов),
+    // параллельно - отбор count лучших в каждом куске и общий отбор среди кандидатов.
+    static void SelectTopDocuments(const std::execution::sequenced_policy&, std::pmr::vector<Document>& documents,
+                                   size_t count);
+    static void SelectTopDocuments(const std::execution::parallel_policy&, std::pmr::vector<Document>& documents,
+                                   size_t count);
+
+    // Оставляет в documents[first, first + count) документы с этими местами в порядке IsMoreRelevant
+    template <typename ExecutionPolicy>
+    static void SelectPageDocuments(ExecutionPolicy&& policy, std::pmr::vector<Document>& documents,
+                                    size_t first, size_t count);
+
+    // Все найденные документы в режиме query_mode_, без отбора лучших
+    template <typename ExecutionPolicy, typename DocumentFilter>
+    std::pmr::vector<Document> FindMatchedDocuments(ExecutionPolicy&& policy, const Query& query,
+                                                    const DocumentFilter& filter) const;
+
+    // Кандидаты в count лучших для режима ANY_WORD (MaxScore). Списки обходятся по документам одновременно.
+    // Верхняя оценка вклада слова - наибольший TF списка, умноженный на IDF. Списки с наименьшими оценками,
+    // сумма которых ниже порога, становятся неосновными: документ, которого нет в основных списках, пропускается,
+    // а неосновные списки лишь догоняют документы-кандидаты через Cursor::Advance, пропуская целые блоки.
+    // Порог - count-я релевантность среди найденных, уменьшенная на EPSILON с запасом на округление оценок:
+    // документ ниже порога хуже count найденных при любом рейтинге. Вклады складываются в порядке запроса, поэтому релевантность кандидатов
+    // та же, что при полном переборе. Результат - по возрастанию номеров, count лучших отбирает SelectTopDocuments.
+    template <typename DocumentFilter>
+    std::pmr::vector<Document> FindTopCandidates(const Query& query, const DocumentFilter& filter, size_t count) const;
+
+    // Общая часть FindTopDocuments. DocumentFilter - предикат или DocumentStatus.
+    // Временные контейнеры запроса живут в арене потока, в общую кучу уходит только возвращаемый результат.
+    template <typename ExecutionPolicy, typename DocumentFilter>
+    std::vector<Document> FindTopDocumentsImpl(ExecutionPolicy&& policy, std::string_view raw_query,
+                                               const DocumentFilter& filter, QueryTrace* user_trace = nullptr) const;
+
+    // Проверка документа фильтром. Для фильтра по статусу это проверка бита без вызова предиката,
+    // для предиката - обращение к ratings_ и statuses_.
+    template <typename DocumentFilter>
+    bool IsAccepted(const DocumentFilter& filter, int ordinal) const;
+
+    template <typename DocumentFilter>
+    std::pmr::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&, const Query& query,
+                                                const DocumentFilter& filter) const;
+
+    // Номера документов делятся на части по PARALLEL_SEARCH_CHUNK_SIZE, часть обрабатывается одним потоком
+    // в своем плотном массиве релевантности без блокировок. Вклады слов складываются в порядке запроса,
+    // поэтому релевантность совпадает с последовательной версией.
+    template <typename DocumentFilter>
+    std::pmr::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const Query& query,
+                                                const DocumentFilter& filter) const;
+
+    // Поиск в режиме QueryMode::ALL_WORDS: кандидаты - пересечение списков вхождений, затем вклад каждого
+    // плюс-слова (для par - параллельно по словам) находится пересечением его списка с кандидатами
+    template <typename ExecutionPolicy, typename DocumentFilter>
+    std::pmr::vector<Document> FindAllDocumentsWithAllWords(ExecutionPolicy&& policy, const Query& query,
+                                                            const DocumentFilter& filter) const;
 
 };
 
 template <typename StringContainer>
 SearchServer::SearchServer(const StringContainer& stop_words) {
-    for (const std::string& word : stop_words) {
+    std::vector<std::string_view> words;
+    for (const auto& word : stop_words) {
         if (!IsValidWord(word)) {
             throw std::invalid_argument("invalid stop words");
         }
-        stop_words_.insert(word);
+        if (!std::string_view(word).empty()) {
+            words.emplace_back(word);
+        }
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    stop_words_ = TermDictionary(words);
+}
+
+template <typename Server, typename Function>
+void SearchServer::ForEachPostings(Server& server, Function function) {
+    // Слияние двух отсортированных последовательностей: словаря и дерева новых слов
+    auto added_it = server.added_word_postings_.begin();
+    const auto added_end = server.added_word_postings_.end();
+    for (uint32_t term_id = 0; term_id < server.frozen_words_.size(); ++term_id) {
+        const std::string_view word = server.frozen_words_.GetTerm(term_id);
+        for (; added_it != added_end && added_it->first < word; ++added_it) {
+            function(std::string_view(added_it->first), added_it->second);
+        }
+        if (!server.frozen_postings_[term_id].empty()) {
+            function(word, server.frozen_postings_[term_id]);
+        }
+    }
+    for (; added_it != added_end; ++added_it) {
+        function(std::string_view(added_it->first), added_it->second);
     }
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query, DocumentPredicate predicate) const {
-        const Query query = ParseQuery(raw_query);
-        auto matched_documents = FindAllDocuments(query, predicate);
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate predicate) const {
+    return FindTopDocuments(std::execution::seq, raw_query, predicate);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+                                                     DocumentPredicate predicate) const {
+    return FindTopDocumentsImpl(policy, raw_query, predicate);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+                                                     DocumentStatus raw_status) const {
+    return FindTopDocumentsImpl(policy, raw_query, raw_status);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const {
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename DocumentFilter>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, const DocumentFilter& filter,
+                                                     QueryTrace& trace) const {
+    return FindTopDocuments(std::execution::seq, raw_query, filter, trace);
+}
+
+template <typename ExecutionPolicy, typename DocumentFilter>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+                                                     const DocumentFilter& filter, QueryTrace& trace) const {
+    return FindTopDocumentsImpl(policy, raw_query, filter, &trace);
+}
+
+template <typename ExecutionPolicy, typename DocumentFilter>
+std::vector<Document> SearchServer::FindTopDocumentsImpl(ExecutionPolicy&& policy, std::string_view raw_query,
+                                                         const DocumentFilter& filter, QueryTrace* user_trace) const {
+        QueryTrace trace(user_trace != nullptr || QueryStatsRecorder::ShouldTimeQuery());
+        trace.Start();
+        const QueryArena& arena = QueryArena::ForCurrentThread();
+        const QueryArena::Stats arena_stats = QUERY_STATS_ENABLED ? arena.GetStats() : QueryArena::Stats{};
+        QueryArenaScope arena_scope;
+        Query query = ParseQuery(raw_query, arena_scope.GetResource());
+        query.trace = &trace;
+        trace.FinishPhase(QueryPhase::PARSE);
 
-        sort(matched_documents.begin(), matched_documents.end(),
-            [](const Document& lhs, const Document& rhs) {
-                return (std::abs(lhs.relevance - rhs.relevance) < EPSILON)
-                    ? lhs.rating > rhs.rating : lhs.relevance > rhs.relevance;
-            });
-        if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-            matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+        std::pmr::vector<Document> matched_documents(arena_scope.GetResource());
+        if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+            if (dynamic_pruning_ && query_mode_ == QueryMode::ANY_WORD) {
+                matched_documents = FindTopCandidates(query, filter, max_result_document_count_);
+            }
+            else {
+                matched_documents = FindMatchedDocuments(policy, query, filter);
+            }
         }
-        return matched_documents;
+        else {
+            matched_documents = FindMatchedDocuments(policy, query, filter);
+        }
+        trace.FinishPhase(QueryPhase::POSTING_SCAN);
+        trace.Add(QueryCounter::MATCHED_DOCUMENTS, matched_documents.size());
+
+        SelectTopDocuments(policy, matched_documents, max_result_document_count_);
+        trace.FinishPhase(QueryPhase::TOP_K);
+        std::vector<Document> result(matched_documents.begin(), matched_documents.end());
+        trace.FinishPhase(QueryPhase::RESULT_BUILD);
+
+        if constexpr (QUERY_STATS_ENABLED) {
+            const QueryArena::Stats finish_arena_stats = arena.GetStats();
+            trace.Add(QueryCounter::ARENA_ALLOCATIONS, finish_arena_stats.allocation_count - arena_stats.allocation_count);
+            trace.Add(QueryCounter::HEAP_ALLOCATIONS,
+                      finish_arena_stats.upstream_allocation_count - arena_stats.upstream_allocation_count);
+            RecordQuery(trace, user_trace);
+        }
+        return result;
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate predicate) const {
-    std::map<int, double> document_to_relevance;  // ключ id, значение - релевантность
+template <typename DocumentFilter>
+std::vector<Document> SearchServer::FindDocumentsPage(std::string_view raw_query, size_t page, size_t page_size,
+                                                      const DocumentFilter& filter) const {
+    return FindDocumentsPage(std::execution::seq, raw_query, page, page_size, filter);
+}
+
+template <typename DocumentFilter>
+std::vector<Document> SearchServer::FindSegmentDocuments(std::string_view raw_query, const DocumentFilter& filter,
+        const std::map<std::string_view, double>& inverse_document_freqs) const {
+    QueryArenaScope arena_scope;
+    Query query = ParseQuery(raw_query, arena_scope.GetResource());
+    query.inverse_document_freqs = &inverse_document_freqs;
+    const auto matched_documents = FindMatchedDocuments(std::execution::seq, query, filter);
+    return { matched_documents.begin(), matched_documents.end() };
+}
+
+template <typename ExecutionPolicy, typename DocumentFilter>
+std::vector<Document> SearchServer::FindDocumentsPage(ExecutionPolicy&& policy, std::string_view raw_query, size_t page,
+                                                      size_t page_size, const DocumentFilter& filter) const {
+    if (page_size == 0) {
+        throw std::invalid_argument("Incorrect page size");
+    }
+    QueryArenaScope arena_scope;
+    const Query query = ParseQuery(raw_query, arena_scope.GetResource());
+    auto matched_documents = FindMatchedDocuments(policy, query, filter);
+
+    // page * page_size может переполниться, поэтому номер страницы сравнивается с числом полных страниц
+    if (page >= matched_documents.size() / page_size + (matched_documents.size() % page_size != 0)) {
+        return {};
+    }
+    const size_t first = page * page_size;
+    const size_t count = std::min(page_size, matched_documents.size() - first);
+    SelectPageDocuments(policy, matched_documents, first, count);
+    return { matched_documents.begin() + first, matched_documents.begin() + first + count };
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::SelectPageDocuments(ExecutionPolicy&& policy, std::pmr::vector<Document>& documents,
+                                       size_t first, size_t count) {
+    const auto page_begin = documents.begin() + first;
+    if (first > 0) {
+        std::nth_element(policy, documents.begin(), page_begin, documents.end(), IsMoreRelevant);
+    }
+    std::partial_sort(policy, page_begin, page_begin + count, documents.end(), IsMoreRelevant);
+}
+
+template <typename ExecutionPolicy, typename DocumentFilter>
+std::pmr::vector<Document> SearchServer::FindMatchedDocuments(ExecutionPolicy&& policy, const Query& query,
+                                                              const DocumentFilter& filter) const {
+    return query_mode_ == QueryMode::ALL_WORDS
+        ? FindAllDocumentsWithAllWords(policy, query, filter)
+        : FindAllDocuments(policy, query, filter);
+}
+
+template <typename DocumentFilter>
+bool SearchServer::IsAccepted(const DocumentFilter& filter, int ordinal) const {
+    if constexpr (std::is_same_v<DocumentFilter, DocumentStatus>) {
+        return status_bitmaps_[static_cast<size_t>(filter)][ordinal];
+    }
+    else {
+        return filter(ordinal_to_id_[ordinal], statuses_[ordinal], ratings_[ordinal]);
+    }
+}
+
+template <typename DocumentFilter>
+void SearchServer::TracePredicateCalls(const Query& query, uint64_t count) {
+    if constexpr (!std::is_same_v<DocumentFilter, DocumentStatus>) {
+        query.Trace(QueryCounter::PREDICATE_CALLS, count);
+    }
+}
+
+template <typename Function>
+size_t SearchServer::ForEachNotExcluded(const PostingList& postings, const std::pmr::vector<int>& excluded_ordinals,
+                                        std::pmr::vector<uint32_t>& positions, Function function) {
+    if (postings.IsCompressed()) {
+        size_t excluded_count = 0;
+        auto excluded_it = excluded_ordinals.begin();
+        for (PostingList::Cursor cursor(postings); !cursor.AtEnd(); cursor.Next()) {
+            const int ordinal = cursor.GetDocumentId();
+            while (excluded_it != excluded_ordinals.end() && *excluded_it < ordinal) {
+                ++excluded_it;
+            }
+            if (excluded_it == excluded_ordinals.end() || *excluded_it != ordinal) {
+                function(ordinal, cursor.GetTermFreq());
+            }
+            else {
+                ++excluded_count;
+            }
+        }
+        return excluded_count;
+    }
+    const ArrayView<int> ordinals = postings.GetDocumentIds();
+    const ArrayView<double> term_freqs = postings.GetTermFreqs();
+    if (excluded_ordinals.empty()) {
+        for (size_t i = 0; i < ordinals.size(); ++i) {
+            function(ordinals[i], term_freqs[i]);
+        }
+        return 0;
+    }
+    positions.clear();
+    DifferenceSorted(ordinals, excluded_ordinals, positions);
+    for (const uint32_t position : positions) {
+        function(ordinals[position], term_freqs[position]);
+    }
+    return ordinals.size() - positions.size();
+}
+
+template <typename DocumentFilter>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy&, const Query& query,
+                                                          const DocumentFilter& filter) const {
+    const RelevanceAccumulatorLease accumulator(*this);
+
+    // Документы с минус-словами вычитаются из списков вхождений до подсчета релевантности
+    const std::pmr::vector<int> excluded_ordinals = CollectExcludedOrdinals(query);
+    std::pmr::vector<uint32_t> positions(excluded_ordinals.get_allocator());
 
     /* Перебераем плюс слова если содержаться в док-те, то для каждого id добавляем релевантность */
-    for (const std::string& word : query.plus_words) {
-        if (!word_to_document_freqs_.count(word)) {
+    size_t posting_count = 0;
+    size_t excluded_count = 0;
+    for (const std::string_view word : query.plus_words) {
+        const PostingList* postings = FindPostings(word);
+        if (postings == nullptr) {
             continue;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            // документы добавляются в document_to_relevance только с условием предиката (фильтра)
-            if (predicate(document_id, documents_.at(document_id).status, documents_.at(document_id).rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(query, word, *postings);
+        posting_count += postings->size();
+        excluded_count += ForEachNotExcluded(*postings, excluded_ordinals, positions, [&](int ordinal, double term_freq) {
+            // документы добавляются в accumulator только с условием предиката (фильтра)
+            if (IsAccepted(filter, ordinal)) {
+                accumulator->Add(ordinal, term_freq * inverse_document_freq);
             }
-        }
+        });
+    }
+    query.Trace(QueryCounter::POSTINGS_TOUCHED, posting_count);
+    query.Trace(QueryCounter::ERASED_BY_MINUS_WORDS, excluded_count);
+    TracePredicateCalls<DocumentFilter>(query, posting_count - excluded_count);
+    /* Перемещаем результат в структуру (по возрастанию номеров, как в параллельной версии) */
+    std::sort(accumulator->touched_ordinals.begin(), accumulator->touched_ordinals.end());
+    std::pmr::vector<Document> matched_documents(excluded_ordinals.get_allocator());
+    matched_documents.reserve(accumulator->touched_ordinals.size());
+    for (const int ordinal : accumulator->touched_ordinals) {
+        matched_documents.push_back(
+            { ordinal_to_id_[ordinal], accumulator->relevances[ordinal], ratings_[ordinal] });
     }
-    /* Удалем из document_to_relevance док-ты где есть минус слово */
-    for (const std::string& word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    return matched_documents;
+}
+
+template <typename DocumentFilter>
+std::pmr::vector<Document> SearchServer::FindTopCandidates(const Query& query, const DocumentFilter& filter,
+                                                           size_t count) const {
+    std::pmr::memory_resource* resource = query.plus_words.get_allocator().resource();
+    std::pmr::vector<Document> candidates(resource);
+    if (count == 0) {
+        return candidates;
+    }
+    PruningStats& stats = GetThreadPruningStats();
+
+    struct TermCursor {
+        PostingList::Cursor cursor;
+        double inverse_document_freq;
+        double max_relevance;  // верхняя оценка вклада слова
+    };
+    std::pmr::vector<TermCursor> terms(resource);  // в порядке запроса
+    for (const std::string_view word : query.plus_words) {
+        const PostingList* postings_ptr = FindPostings(word);
+        if (postings_ptr == nullptr) {
             continue;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
+        const PostingList& postings = *postings_ptr;
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(query, word, postings);
+        terms.push_back({ PostingList::Cursor(postings), inverse_document_freq,
+                          postings.GetMaxTermFreq() * inverse_document_freq });
+        stats.query_postings += postings.size();
+    }
+
+    // Слова по возрастанию верхней оценки; bound_prefix[i] - сумма оценок первых i из них
+    std::pmr::vector<TermCursor*> by_bound(resource);
+    by_bound.reserve(terms.size());
+    for (TermCursor& term : terms) {
+        by_bound.push_back(&term);
+    }
+    std::sort(by_bound.begin(), by_bound.end(), [](const TermCursor* lhs, const TermCursor* rhs) {
+        return lhs->max_relevance < rhs->max_relevance;
+    });
+    std::pmr::vector<double> bound_prefix(terms.size() + 1, 0.0, resource);
+    for (size_t i = 0; i < by_bound.size(); ++i) {
+        bound_prefix[i + 1] = bound_prefix[i] + by_bound[i]->max_relevance;
+    }
+
+    const std::pmr::vector<int> excluded_ordinals = CollectExcludedOrdinals(query);
+    auto excluded_it = excluded_ordinals.begin();
+    std::pmr::vector<double> top_relevances(resource);  // куча count лучших релевантностей, сверху наименьшая
+    const uint64_t scored_postings = stats.scored_postings;
+    uint64_t excluded_count = 0;
+    uint64_t filter_call_count = 0;
+    double threshold = -std::numeric_limits<double>::infinity();
+    size_t first_essential = 0;  // by_bound[first_essential..] - основные списки
+
+    const auto is_at = [](const TermCursor& term, int ordinal) {
+        return !term.cursor.AtEnd() && term.cursor.GetDocumentId() == ordinal;
+    };
+    // Следующий документ - наименьший среди текущих документов основных списков
+    int ordinal = std::numeric_limits<int>::max();
+    for (const TermCursor* term : by_bound) {
+        if (!term->cursor.AtEnd()) {
+            ordinal = std::min(ordinal, term->cursor.GetDocumentId());
         }
     }
-    /* Перемещаем результат в структуру */
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
+    while (ordinal != std::numeric_limits<int>::max()) {
+        // Точные вклады основных списков и оценки неосновных
+        double max_relevance = bound_prefix[first_essential];
+        size_t essential_count = 0;  // основных списков с этим документом
+        for (size_t i = first_essential; i < by_bound.size(); ++i) {
+            const TermCursor& term = *by_bound[i];
+            if (is_at(term, ordinal)) {
+                max_relevance += term.cursor.GetTermFreq() * term.inverse_document_freq;
+                ++essential_count;
+            }
+        }
+        stats.scored_postings += essential_count;
+        while (excluded_it != excluded_ordinals.end() && *excluded_it < ordinal) {
+            ++excluded_it;
+        }
+        const bool is_excluded = excluded_it != excluded_ordinals.end() && *excluded_it == ordinal;
+        excluded_count += is_excluded ? essential_count : 0;
+
+        bool is_candidate = max_relevance >= threshold && !is_excluded;
+        if (is_candidate) {
+            ++filter_call_count;
+            is_candidate = IsAccepted(filter, ordinal);
+        }
+        if (is_candidate) {
+            // Неосновные списки - от больших оценок к меньшим, пока документ еще может пройти порог
+            for (size_t i = first_essential; i > 0 && max_relevance >= threshold; --i) {
+                TermCursor& term = *by_bound[i - 1];
+                max_relevance -= term.max_relevance;
+                term.cursor.Advance(ordinal);
+                if (is_at(term, ordinal)) {
+                    max_relevance += term.cursor.GetTermFreq() * term.inverse_document_freq;
+                    ++stats.scored_postings;
+                }
+            }
+            is_candidate = max_relevance >= threshold;
+        }
+        if (is_candidate) {
+            double relevance = 0.0;
+            for (const TermCursor& term : terms) {
+                if (is_at(term, ordinal)) {
+                    relevance += term.cursor.GetTermFreq() * term.inverse_document_freq;
+                }
+            }
+            candidates.push_back({ ordinal_to_id_[ordinal], relevance, ratings_[ordinal] });
+
+            if (top_relevances.size() < count || relevance > top_relevances.front()) {
+                if (top_relevances.size() == count) {
+                    std::pop_heap(top_relevances.begin(), top_relevances.end(), std::greater<>());
+                    top_relevances.pop_back();
+                }
+                top_relevances.push_back(relevance);
+                std::push_heap(top_relevances.begin(), top_relevances.end(), std::greater<>());
+                if (top_relevances.size() == count) {
+                    threshold = top_relevances.front() - 2 * EPSILON;
+                    while (first_essential < by_bound.size() && bound_prefix[first_essential + 1] < threshold) {
+                        ++first_essential;
+                    }
+                }
+            }
+        }
+
+        const int current_ordinal = ordinal;
+        ordinal = std::numeric_limits<int>::max();
+        for (size_t i = first_essential; i < by_bound.size(); ++i) {
+            PostingList::Cursor& cursor = by_bound[i]->cursor;
+            if (cursor.AtEnd()) {
+                continue;
+            }
+            if (cursor.GetDocumentId() == current_ordinal) {
+                cursor.Next();
+                if (cursor.AtEnd()) {
+                    continue;
+                }
+            }
+            ordinal = std::min(ordinal, cursor.GetDocumentId());
+        }
+    }
+    query.Trace(QueryCounter::POSTINGS_TOUCHED, stats.scored_postings - scored_postings);
+    query.Trace(QueryCounter::ERASED_BY_MINUS_WORDS, excluded_count);
+    TracePredicateCalls<DocumentFilter>(query, filter_call_count);
+    return candidates;
+}
+
+template <typename DocumentFilter>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy&, const Query& query,
+                                                          const DocumentFilter& filter) const {
+    // Рабочие потоки только читают контейнеры на арене вызывающего потока, а свои выделяют в общей куче
+    const std::pmr::vector<int> excluded_ordinals = CollectExcludedOrdinals(query);
+    std::pmr::vector<const PostingList*> word_postings(excluded_ordinals.get_allocator());
+    std::pmr::vector<double> inverse_document_freqs(excluded_ordinals.get_allocator());
+    size_t posting_count = 0;
+    for (const std::string_view word : query.plus_words) {
+        const PostingList* postings = FindPostings(word);
+        if (postings != nullptr) {
+            word_postings.push_back(postings);
+            inverse_document_freqs.push_back(ComputeWordInverseDocumentFreq(query, word, *postings));
+            posting_count += postings->size();
+        }
+    }
+
+    const int ordinal_count = static_cast<int>(ordinal_to_id_.size());
+    std::vector<std::vector<Document>> chunk_documents(
+        (ordinal_count + PARALLEL_SEARCH_CHUNK_SIZE - 1) / PARALLEL_SEARCH_CHUNK_SIZE);
+    std::vector<size_t> chunk_excluded_counts(chunk_documents.size());
+    std::vector<size_t> chunks(chunk_documents.size());
+    std::iota(chunks.begin(), chunks.end(), 0);
+    std::for_each(std::execution::par, chunks.begin(), chunks.end(),
+        [&](size_t chunk) {
+            const int first_ordinal = static_cast<int>(chunk) * PARALLEL_SEARCH_CHUNK_SIZE;
+            const int last_ordinal = std::min(ordinal_count, first_ordinal + PARALLEL_SEARCH_CHUNK_SIZE);
+            std::vector<double> relevances(last_ordinal - first_ordinal);
+            std::vector<char> is_touched(last_ordinal - first_ordinal);
+            const auto excluded_begin =
+                std::lower_bound(excluded_ordinals.begin(), excluded_ordinals.end(), first_ordinal);
+            size_t excluded_count = 0;
+            for (size_t word_index = 0; word_index < word_postings.size(); ++word_index) {
+                auto excluded_it = excluded_begin;
+                PostingList::Cursor cursor(*word_postings[word_index]);
+                for (cursor.Advance(first_ordinal); !cursor.AtEnd() && cursor.GetDocumentId() < last_ordinal;
+                     cursor.Next()) {
+                    const int ordinal = cursor.GetDocumentId();
+                    while (excluded_it != excluded_ordinals.end() && *excluded_it < ordinal) {
+                        ++excluded_it;
+                    }
+                    if (excluded_it != excluded_ordinals.end() && *excluded_it == ordinal) {
+                        ++excluded_count;
+                    }
+                    else if (IsAccepted(filter, ordinal)) {
+                        relevances[ordinal - first_ordinal] +=
+                            cursor.GetTermFreq() * inverse_document_freqs[word_index];
+                        is_touched[ordinal - first_ordinal] = true;
+                    }
+                }
+            }
+            for (int ordinal = first_ordinal; ordinal < last_ordinal; ++ordinal) {
+                if (is_touched[ordinal - first_ordinal]) {
+                    chunk_documents[chunk].push_back(
+                        { ordinal_to_id_[ordinal], relevances[ordinal - first_ordinal], ratings_[ordinal] });
+                }
+            }
+            chunk_excluded_counts[chunk] = excluded_count;
+        });
+    const size_t excluded_count =
+        std::accumulate(chunk_excluded_counts.begin(), chunk_excluded_counts.end(), size_t{0});
+    query.Trace(QueryCounter::POSTINGS_TOUCHED, posting_count);
+    query.Trace(QueryCounter::ERASED_BY_MINUS_WORDS, excluded_count);
+    TracePredicateCalls<DocumentFilter>(query, posting_count - excluded_count);
+
+    std::pmr::vector<Document> matched_documents(excluded_ordinals.get_allocator());
+    for (const std::vector<Document>& documents : chunk_documents) {
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+    }
+    return matched_documents;
+}
+
+template <typename ExecutionPolicy, typename DocumentFilter>
+std::pmr::vector<Document> SearchServer::FindAllDocumentsWithAllWords(ExecutionPolicy&& policy, const Query& query,
+                                                                      const DocumentFilter& filter) const {
+    std::pmr::vector<const PostingList*> postings(query.plus_words.get_allocator());
+    std::pmr::vector<int> ordinals = CollectOrdinalsWithAllWords(query, postings);
+    TracePredicateCalls<DocumentFilter>(query, ordinals.size());
+    ordinals.erase(std::remove_if(ordinals.begin(), ordinals.end(),
+                                  [this, &filter](int ordinal) { return !IsAccepted(filter, ordinal); }),
+                   ordinals.end());
+    if (ordinals.empty()) {
+        return {};
+    }
+
+    // Каждый документ-кандидат есть в каждом списке, поэтому k-й найденный TF относится к ordinals[k].
+    // Вклады слов складываются в порядке запроса, как и в режиме ANY_WORD. Массивы вкладов заполняются
+    // в рабочих потоках, поэтому они в общей куче, а не в арене.
+    std::vector<std::vector<double>> word_relevances(postings.size());
+    std::pmr::vector<size_t> word_indexes(postings.size(), ordinals.get_allocator());
+    std::iota(word_indexes.begin(), word_indexes.end(), 0);
+    std::for_each(policy, word_indexes.begin(), word_indexes.end(),
+        [this, &query, &postings, &ordinals, &word_relevances](size_t word_index) {
+            const PostingList& posting_list = *postings[word_index];
+            const double inverse_document_freq =
+                ComputeWordInverseDocumentFreq(query, query.plus_words[word_index], posting_list);
+            std::vector<double>& relevances = word_relevances[word_index];
+            posting_list.AppendTermFreqs(ordinals, relevances);
+            for (double& relevance : relevances) {
+                relevance *= inverse_document_freq;
+            }
+        });
+
+    query.Trace(QueryCounter::POSTINGS_TOUCHED, ordinals.size() * postings.size());
+
+    std::pmr::vector<Document> matched_documents(ordinals.get_allocator());
+    matched_documents.reserve(ordinals.size());
+    for (size_t k = 0; k < ordinals.size(); ++k) {
+        double relevance = 0.0;
+        for (const std::vector<double>& relevances : word_relevances) {
+            relevance += relevances[k];
+        }
         matched_documents.push_back(
-            { document_id, relevance, documents_.at(document_id).rating });
+            { ordinal_to_id_[ordinals[k]], relevance, ratings_[ordinals[k]] });
     }
     return matched_documents;
 }
 
-void PrintMatchedDocument(const std::tuple<std::vector<std::string>, DocumentStatus>& matchResult);
\ No newline at end of file
+template <typename ExecutionPolicy>
+void SearchServer::AddDocumentsImpl(ExecutionPolicy&& policy, const std::vector<RawDocument>& documents) {
+    std::set<int> batch_ids;
+    for (const RawDocument& document : documents) {
+        CheckNewDocumentId(document.id);
+        if (!batch_ids.insert(document.id).second) {
+            throw std::invalid_argument("id is busy");
+        }
+    }
+
+    // Исключение внутри параллельного алгоритма завершило бы программу, поэтому ошибки только отмечаем
+    std::vector<std::map<std::string_view, double>> word_freqs(documents.size());
+    std::vector<char> is_valid(documents.size());
+    std::vector<size_t> indexes(documents.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(policy, indexes.begin(), indexes.end(),
+        [this, &documents, &word_freqs, &is_valid](size_t index) {
+            is_valid[index] = IsValidWord(documents[index].text);
+            if (is_valid[index]) {
+                word_freqs[index] = ComputeWordFreqs(documents[index].text);
+            }
+        });
+    if (std::find(is_valid.begin(), is_valid.end(), 0) != is_valid.end()) {
+        throw std::invalid_argument("words contain special characters");
+    }
+
+    InsertDocuments(policy, documents, word_freqs);
+}
+
+void PrintMatchedDocument(const std::tuple<std::vector<std::string_view>, DocumentStatus>& matchResult);
\ No newline at end of file
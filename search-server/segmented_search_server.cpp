@@ -0,0 +1,223 @@
+#include "segmented_search_server.h"
+
+SegmentedSearchServer::SegmentedSearchServer(std::string_view stop_words, size_t seal_document_count)
+    : stop_words_(stop_words)
+    , seal_document_count_(std::max<size_t>(seal_document_count, 1))
+    , active_(stop_words_)
+    , segment_set_(std::make_shared<const SegmentSet>())
+    , merge_thread_([this] { RunMerges(); }) {
+    active_.SetStatsRecorder(stats_recorder_);
+}
+
+SegmentedSearchServer::~SegmentedSearchServer() {
+    {
+        std::lock_guard guard(segments_mutex_);
+        is_stopping_ = true;
+    }
+    merge_cv_.notify_all();
+    merge_thread_.join();
+}
+
+void SegmentedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                        const std::vector<int>& ratings) {
+    std::unique_lock active_lock(active_mutex_);
+    if (document_ids_.count(document_id) != 0) {
+        throw std::invalid_argument("id is busy");
+    }
+    active_.AddDocument(document_id, document, status, ratings);
+    document_ids_.insert(document_id);
+    if (static_cast<size_t>(active_.GetDocumentCount()) < seal_document_count_) {
+        return;
+    }
+    // Запечатывание - только перенос указателя; сжатие и сборка словаря достаются фоновому слиянию
+    auto sealed = std::make_shared<const SearchServer>(std::move(active_));
+    active_ = SearchServer(stop_words_);
+    active_.SetStatsRecorder(stats_recorder_);
+    UpdateSegmentSet([&sealed](SegmentSet& segment_set) {
+        segment_set.segments.push_back({ std::move(sealed), nullptr });
+    });
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id) {
+    std::unique_lock active_lock(active_mutex_);
+    if (document_ids_.erase(document_id) == 0) {
+        return;
+    }
+    if (active_.HasDocument(document_id)) {
+        active_.RemoveDocument(document_id);
+        return;
+    }
+    // Сегмент ищется в текущем наборе: фоновое слияние могло заменить сегменты. Живая копия документа
+    // ровно одна, в остальных сегментах с этим id он уже помечен.
+    UpdateSegmentSet([document_id](SegmentSet& segment_set) {
+        for (Segment& segment : segment_set.segments) {
+            if (segment.index->HasDocument(document_id) && !IsRemoved(segment, document_id)) {
+                segment.removed = AddTombstones(*segment.index, segment.removed, { document_id });
+                return;
+            }
+        }
+    });
+}
+
+std::shared_ptr<const SegmentedSearchServer::Tombstones> SegmentedSearchServer::AddTombstones(
+        const SearchServer& index, const std::shared_ptr<const Tombstones>& removed,
+        const std::vector<int>& document_ids) {
+    auto tombstones = removed != nullptr ? std::make_shared<Tombstones>(*removed) : std::make_shared<Tombstones>();
+    for (const int document_id : document_ids) {
+        if (!tombstones->ids.insert(document_id).second) {
+            continue;
+        }
+        for (const auto& [word, _] : index.GetWordFrequencies(document_id)) {
+            ++tombstones->word_counts[word];
+        }
+    }
+    return tombstones;
+}
+
+bool SegmentedSearchServer::IsRemoved(const Segment& segment, int document_id) {
+    return segment.removed != nullptr && segment.removed->ids.count(document_id) != 0;
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocumentsImpl(raw_query, status);
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+int SegmentedSearchServer::GetDocumentCount() const {
+    std::shared_lock active_lock(active_mutex_);
+    return static_cast<int>(document_ids_.size());
+}
+
+SegmentedSearchServer::Stats SegmentedSearchServer::GetStats() const {
+    std::shared_lock active_lock(active_mutex_);
+    std::lock_guard guard(segments_mutex_);
+    Stats stats = stats_;
+    stats.segment_count = segment_set_->segments.size();
+    stats.active_document_count = active_.GetDocumentCount();
+    for (const Segment& segment : segment_set_->segments) {
+        stats.removed_document_count += segment.removed != nullptr ? segment.removed->ids.size() : 0;
+    }
+    return stats;
+}
+
+SearchStats SegmentedSearchServer::GetQueryStats() const {
+    return stats_recorder_->GetStats();
+}
+
+void SegmentedSearchServer::WaitForMerges() const {
+    std::unique_lock lock(segments_mutex_);
+    merge_cv_.wait(lock, [this] {
+        return !is_merge_requested_ && !is_merging_;
+    });
+}
+
+template <typename Change>
+void SegmentedSearchServer::UpdateSegmentSet(Change change) {
+    {
+        std::lock_guard guard(segments_mutex_);
+        auto segment_set = std::make_shared<SegmentSet>(*segment_set_);
+        change(*segment_set);
+        std::atomic_store(&segment_set_, std::shared_ptr<const SegmentSet>(std::move(segment_set)));
+        is_merge_requested_ = true;
+    }
+    merge_cv_.notify_all();
+}
+
+std::vector<SegmentedSearchServer::Segment> SegmentedSearchServer::PlanMerge(const SegmentSet& segment_set) const {
+    // Уровень 0 - сегменты меньше seal * factor документов, уровень 1 - меньше seal * factor^2 и т.д.
+    std::map<size_t, std::vector<Segment>> segments_by_level;
+    for (const Segment& segment : segment_set.segments) {
+        size_t level = 0;
+        for (size_t bound = seal_document_count_ * SEGMENT_MERGE_FACTOR;
+             static_cast<size_t>(segment.index->GetDocumentCount()) >= bound; bound *= SEGMENT_MERGE_FACTOR) {
+            ++level;
+        }
+        auto& level_segments = segments_by_level[level];
+        level_segments.push_back(segment);
+        if (level_segments.size() == SEGMENT_MERGE_FACTOR) {
+            return level_segments;
+        }
+    }
+    for (const Segment& segment : segment_set.segments) {
+        const size_t removed_count = segment.removed != nullptr ? segment.removed->ids.size() : 0;
+        if (removed_count > 0 && removed_count * 4 >= static_cast<size_t>(segment.index->GetDocumentCount())) {
+            return { segment };
+        }
+    }
+    return {};
+}
+
+void SegmentedSearchServer::RunMerges() {
+    std::unique_lock lock(segments_mutex_);
+    while (true) {
+        merge_cv_.wait(lock, [this] {
+            return is_merge_requested_ || is_stopping_;
+        });
+        if (is_stopping_) {
+            return;
+        }
+        is_merge_requested_ = false;
+        const auto segment_set = segment_set_;
+        const auto merged_segments = PlanMerge(*segment_set);
+        if (merged_segments.empty()) {
+            merge_cv_.notify_all();
+            continue;
+        }
+
+        // Слияние идет без блокировок: сегменты неизменяемы, а новые пометки удаления ставятся поверх
+        is_merging_ = true;
+        lock.unlock();
+        const auto start_time = std::chrono::steady_clock::now();
+        std::vector<const SearchServer*> segments;
+        std::vector<const std::set<int>*> excluded_ids;
+        for (const Segment& segment : merged_segments) {
+            segments.push_back(segment.index.get());
+            excluded_ids.push_back(segment.removed != nullptr ? &segment.removed->ids : nullptr);
+        }
+        SearchServer merged_index = SearchServer::MergeSegments(segments, excluded_ids);
+        merged_index.SetStatsRecorder(stats_recorder_);
+        auto merged = std::make_shared<const SearchServer>(std::move(merged_index));
+        const auto merge_time = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_time);
+        lock.lock();
+
+        // Сливаемые сегменты меняет только этот поток, поэтому в текущем наборе они на прежних местах.
+        // Документы, помеченные во время слияния, попали в новый сегмент, и пометки переносятся на него.
+        auto updated_set = std::make_shared<SegmentSet>(*segment_set_);
+        auto& updated_segments = updated_set->segments;
+        std::vector<int> removed_during_merge;
+        for (const Segment& merged_segment : merged_segments) {
+            const auto it = std::find_if(updated_segments.begin(), updated_segments.end(),
+                [&merged_segment](const Segment& segment) { return segment.index == merged_segment.index; });
+            if (it->removed != nullptr) {
+                for (const int document_id : it->removed->ids) {
+                    if (!IsRemoved(merged_segment, document_id)) {
+                        removed_during_merge.push_back(document_id);
+                    }
+                }
+            }
+            if (merged_segment.index == merged_segments.front().index) {
+                it->index = merged;
+            }
+            else {
+                updated_segments.erase(it);
+            }
+        }
+        const auto merged_it = std::find_if(updated_segments.begin(), updated_segments.end(),
+            [&merged](const Segment& segment) { return segment.index == merged; });
+        merged_it->removed = removed_during_merge.empty()
+            ? nullptr : AddTombstones(*merged, nullptr, removed_during_merge);
+        std::atomic_store(&segment_set_, std::shared_ptr<const SegmentSet>(std::move(updated_set)));
+
+        ++stats_.merge_count;
+        stats_.merged_document_count += merged->GetDocumentCount();
+        stats_.total_merge_time += merge_time;
+        stats_.max_merge_time = std::max(stats_.max_merge_time, merge_time);
+        is_merging_ = false;
+        // Слияние могло создать новый полный уровень
+        is_merge_requested_ = true;
+    }
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "search_server.h"
+
+const size_t SEGMENT_SEAL_DOCUMENT_COUNT = 4096;  // документов в активном сегменте, после которых он запечатывается
+const size_t SEGMENT_MERGE_FACTOR = 4;  // столько сегментов одного уровня сливаются в один
+
+// Индекс для непрерывной загрузки документов: набор сегментов, каждый из которых - отдельный SearchServer.
+// Новые документы пишутся в небольшой активный сегмент, поэтому цена AddDocument не растет вместе с индексом.
+// Заполненный активный сегмент запечатывается и больше не меняется. Фоновый поток сливает запечатанные
+// сегменты по уровням: уровень сегмента - сколько раз его размер больше порога запечатывания в степенях
+// SEGMENT_MERGE_FACTOR, и SEGMENT_MERGE_FACTOR сегментов одного уровня сливаются в сегмент следующего.
+// Поэтому каждый документ переписывается O(log N) раз, а сегментов остается O(log N).
+//
+// Удаленный из запечатанного сегмента документ помечается в этом сегменте и отбрасывается при поиске только
+// в нем, поэтому id можно сразу добавить снова. Из сегмента документ уходит при слиянии; сегмент, где помечена
+// четверть документов, переписывается отдельно. Пометки сегмента хранят и число удаленных документов
+// с каждым словом, так что поправка IDF стоит O(слов запроса) на сегмент.
+// Запрос обходит все сегменты. IDF считается по всем сегментам без помеченных документов, поэтому
+// релевантность та же, что у одного SearchServer с теми же документами. Разделяемая блокировка активного
+// сегмента держится только на подсчете слов и поиске в активном сегменте; запечатанные сегменты
+// неизменяемы и обходятся без нее.
+class SegmentedSearchServer {
+public:
+    struct Stats {
+        size_t segment_count = 0;  // запечатанных сегментов
+        size_t active_document_count = 0;  // документов в активном сегменте
+        size_t removed_document_count = 0;  // помеченных, но еще не убранных из сегментов
+        size_t merge_count = 0;
+        size_t merged_document_count = 0;  // документов, переписанных слияниями
+        std::chrono::microseconds total_merge_time{};
+        std::chrono::microseconds max_merge_time{};
+    };
+
+    explicit SegmentedSearchServer(std::string_view stop_words = {},
+                                   size_t seal_document_count = SEGMENT_SEAL_DOCUMENT_COUNT);
+
+    // Останавливает фоновое слияние (текущее слияние доводится до конца)
+    ~SegmentedSearchServer();
+
+    SegmentedSearchServer(const SegmentedSearchServer&) = delete;
+    SegmentedSearchServer& operator=(const SegmentedSearchServer&) = delete;
+
+    // Документ сразу виден поиску. Занятый id - std::invalid_argument, как у SearchServer.
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                     const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    // Поиск по всем сегментам в режиме QueryMode::ANY_WORD, MAX_RESULT_DOCUMENT_COUNT лучших
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate predicate) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    int GetDocumentCount() const;
+
+    Stats GetStats() const;
+
+    // Время и счетчики запросов FindTopDocuments. Все сегменты пишут в один recorder этого объекта,
+    // поэтому запечатывание и слияния статистику не сбрасывают.
+    SearchStats GetQueryStats() const;
+
+    // Ждет, пока фоновый поток не сольет все, что требует политика слияния
+    void WaitForMerges() const;
+
+private:
+    // Удаленные документы, которые еще лежат в запечатанном сегменте
+    struct Tombstones {
+        std::set<int> ids;
+        std::map<std::string_view, int> word_counts;  // слово (в памяти сегмента) -> число удаленных с ним
+    };
+
+    struct Segment {
+        std::shared_ptr<const SearchServer> index;
+        std::shared_ptr<const Tombstones> removed;  // nullptr, если удаленных нет
+    };
+
+    // Запечатанные сегменты с пометками удаления; выкладывается целиком, как версия в SnapshotSearchServer
+    struct SegmentSet {
+        std::vector<Segment> segments;  // от старых к новым
+    };
+
+    // Пометки сегмента с добавленными документами document_ids, которые есть в index
+    static std::shared_ptr<const Tombstones> AddTombstones(const SearchServer& index,
+                                                           const std::shared_ptr<const Tombstones>& removed,
+                                                           const std::vector<int>& document_ids);
+
+    static bool IsRemoved(const Segment& segment, int document_id);
+
+    // Сегменты, которые нужно слить (пусто, если сливать нечего)
+    std::vector<Segment> PlanMerge(const SegmentSet& segment_set) const;
+
+    void RunMerges();
+
+    // Меняет набор сегментов: копия текущего набора правится change и выкладывается. Под segments_mutex_.
+    template <typename Change>
+    void UpdateSegmentSet(Change change);
+
+    template <typename DocumentFilter>
+    std::vector<Document> FindTopDocumentsImpl(std::string_view raw_query, const DocumentFilter& filter) const;
+
+    const std::string stop_words_;
+    const size_t seal_document_count_;
+    const std::shared_ptr<QueryStatsRecorder> stats_recorder_ = std::make_shared<QueryStatsRecorder>();
+
+    // Активный сегмент и id всех документов. Поиск держит разделяемую блокировку, запись - исключительную.
+    mutable std::shared_mutex active_mutex_;
+    SearchServer active_;
+    std::set<int> document_ids_;
+
+    // Запись набора сегментов, статистика и состояние фонового потока
+    mutable std::mutex segments_mutex_;
+    mutable std::condition_variable merge_cv_;
+    std::shared_ptr<const SegmentSet> segment_set_;  // читается и пишется только через std::atomic_load/store
+    bool is_merge_requested_ = false;
+    bool is_merging_ = false;
+    bool is_stopping_ = false;
+    Stats stats_;
+
+    std::thread merge_thread_;  // последним: поток запускается, когда остальные поля уже созданы
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query,
+                                                              DocumentPredicate predicate) const {
+    return FindTopDocumentsImpl(raw_query, predicate);
+}
+
+template <typename DocumentFilter>
+std::vector<Document> SegmentedSearchServer::FindTopDocumentsImpl(std::string_view raw_query,
+                                                                  const DocumentFilter& filter) const {
+    QueryTrace trace(QueryStatsRecorder::ShouldTimeQuery());
+    trace.Start();
+    std::shared_ptr<const SegmentSet> segment_set;
+    // Слова копируются: слово активного сегмента может исчезнуть сразу после снятия блокировки
+    std::map<std::string, int, std::less<>> word_document_counts;
+    std::map<std::string_view, double> inverse_document_freqs;
+    std::vector<Document> matched_documents;
+    {
+        // Под блокировкой берется согласованная пара из набора сегментов и активного сегмента: запечатывание
+        // меняет оба, и запрос не должен увидеть документ дважды или не увидеть вовсе
+        std::shared_lock active_lock(active_mutex_);
+        segment_set = std::atomic_load(&segment_set_);
+
+        // Общая статистика: число документов и число документов с каждым плюс-словом без помеченных
+        const auto add_counts = [&word_document_counts, raw_query](const SearchServer& segment) {
+            for (const auto& [word, count] : segment.GetQueryWordDocumentCounts(raw_query)) {
+                const auto it = word_document_counts.find(word);
+                if (it == word_document_counts.end()) {
+                    word_document_counts.emplace(std::string(word), count);
+                }
+                else {
+                    it->second += count;
+                }
+            }
+        };
+        for (const Segment& segment : segment_set->segments) {
+            add_counts(*segment.index);
+        }
+        add_counts(active_);
+        for (const Segment& segment : segment_set->segments) {
+            if (segment.removed == nullptr) {
+                continue;
+            }
+            for (auto& [word, count] : word_document_counts) {
+                const auto removed_it = segment.removed->word_counts.find(word);
+                if (removed_it != segment.removed->word_counts.end()) {
+                    count -= removed_it->second;
+                }
+            }
+        }
+        const double log_document_count = std::log(static_cast<double>(document_ids_.size()));
+        for (const auto& [word, count] : word_document_counts) {
+            if (count > 0) {
+                inverse_document_freqs.emplace(word, log_document_count - std::log(static_cast<double>(count)));
+            }
+        }
+        matched_documents = active_.FindSegmentDocuments(raw_query, filter, inverse_document_freqs);
+    }
+
+    for (const Segment& segment : segment_set->segments) {
+        for (const Document& document : segment.index->FindSegmentDocuments(raw_query, filter, inverse_document_freqs)) {
+            if (!IsRemoved(segment, document.id)) {
+                matched_documents.push_back(document);
+            }
+        }
+    }
+    trace.FinishPhase(QueryPhase::POSTING_SCAN);
+    trace.Add(QueryCounter::MATCHED_DOCUMENTS, matched_documents.size());
+    const size_t count = MAX_RESULT_DOCUMENT_COUNT;
+    if (matched_documents.size() > count) {
+        std::partial_sort(matched_documents.begin(), matched_documents.begin() + count, matched_documents.end(),
+                          SearchServer::IsMoreRelevant);
+        matched_documents.resize(count);
+    }
+    else {
+        std::sort(matched_documents.begin(), matched_documents.end(), SearchServer::IsMoreRelevant);
+    }
+    trace.FinishPhase(QueryPhase::TOP_K);
+    if constexpr (QUERY_STATS_ENABLED) {
+        stats_recorder_->Record(trace);
+    }
+    return matched_documents;
+}
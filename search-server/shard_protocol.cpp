@@ -0,0 +1,192 @@
+#include "shard_protocol.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// MSG_NOSIGNAL: закрытый собеседником сокет дает ошибку EPIPE, а не SIGPIPE (где флага нет, SIGPIPE не подавляется)
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace {
+
+const size_t SHARD_READ_BUFFER_SIZE = 64 * 1024;
+
+void WriteFixed32(char* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+uint32_t ReadFixed32(const char* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    }
+    return value;
+}
+
+}  // namespace
+
+ShardMessageWriter::ShardMessageWriter(ShardMessageType type, uint32_t request_id)
+    : frame_(SHARD_FRAME_HEADER_SIZE, '\0') {
+    SetRequestId(request_id);
+    frame_[8] = static_cast<char>(type);
+}
+
+void ShardMessageWriter::SetRequestId(uint32_t request_id) {
+    WriteFixed32(frame_.data() + 4, request_id);
+}
+
+void ShardMessageWriter::WriteUnsigned(uint64_t value) {
+    while (value >= 0x80) {
+        frame_.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    frame_.push_back(static_cast<char>(value));
+}
+
+void ShardMessageWriter::WriteInt(int64_t value) {
+    // zigzag: небольшие по модулю отрицательные числа тоже занимают мало байт
+    WriteUnsigned((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void ShardMessageWriter::WriteDouble(double value) {
+    char bytes[sizeof(double)];
+    std::memcpy(bytes, &value, sizeof(double));
+    frame_.append(bytes, sizeof(double));
+}
+
+void ShardMessageWriter::WriteString(std::string_view value) {
+    WriteUnsigned(value.size());
+    frame_.append(value);
+}
+
+std::string_view ShardMessageWriter::GetFrame() {
+    const size_t body_size = frame_.size() - SHARD_FRAME_HEADER_SIZE;
+    if (body_size > SHARD_MAX_FRAME_BODY_SIZE) {
+        throw std::length_error("shard message is too long");
+    }
+    WriteFixed32(frame_.data(), static_cast<uint32_t>(body_size));
+    return frame_;
+}
+
+ShardMessageReader::ShardMessageReader(std::string_view body)
+    : body_(body) {
+}
+
+uint64_t ShardMessageReader::ReadUnsigned() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (body_.empty()) {
+            break;
+        }
+        const auto byte = static_cast<unsigned char>(body_.front());
+        body_.remove_prefix(1);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::runtime_error("malformed shard message");
+}
+
+int64_t ShardMessageReader::ReadInt() {
+    const uint64_t value = ReadUnsigned();
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+double ShardMessageReader::ReadDouble() {
+    if (body_.size() < sizeof(double)) {
+        throw std::runtime_error("malformed shard message");
+    }
+    double value;
+    std::memcpy(&value, body_.data(), sizeof(double));
+    body_.remove_prefix(sizeof(double));
+    return value;
+}
+
+std::string_view ShardMessageReader::ReadString() {
+    const uint64_t size = ReadUnsigned();
+    if (size > body_.size()) {
+        throw std::runtime_error("malformed shard message");
+    }
+    const std::string_view value = body_.substr(0, size);
+    body_.remove_prefix(size);
+    return value;
+}
+
+ShardFrameReader::ShardFrameReader(int socket_fd)
+    : socket_fd_(socket_fd)
+    , buffer_(SHARD_READ_BUFFER_SIZE) {
+}
+
+bool ShardFrameReader::ReadFrame(ShardFrame& frame) {
+    if (!Fill(SHARD_FRAME_HEADER_SIZE)) {
+        if (begin_ == end_) {
+            return false;
+        }
+        throw std::runtime_error("shard connection closed in the middle of a frame");
+    }
+    const uint32_t body_size = ReadFixed32(buffer_.data() + begin_);
+    if (body_size > SHARD_MAX_FRAME_BODY_SIZE) {
+        throw std::runtime_error("malformed shard message");
+    }
+    if (!Fill(SHARD_FRAME_HEADER_SIZE + body_size)) {
+        throw std::runtime_error("shard connection closed in the middle of a frame");
+    }
+    frame.request_id = ReadFixed32(buffer_.data() + begin_ + 4);
+    frame.type = static_cast<ShardMessageType>(buffer_[begin_ + 8]);
+    frame.body.assign(buffer_.data() + begin_ + SHARD_FRAME_HEADER_SIZE, body_size);
+    begin_ += SHARD_FRAME_HEADER_SIZE + body_size;
+    return true;
+}
+
+bool ShardFrameReader::HasBufferedFrame() const {
+    const size_t size = end_ - begin_;
+    return size >= SHARD_FRAME_HEADER_SIZE
+        && size >= SHARD_FRAME_HEADER_SIZE + ReadFixed32(buffer_.data() + begin_);
+}
+
+bool ShardFrameReader::Fill(size_t size) {
+    if (end_ - begin_ >= size) {
+        return true;
+    }
+    // Непрочитанный хвост переносится в начало буфера; для длинного кадра буфер растет
+    std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+    end_ -= begin_;
+    begin_ = 0;
+    if (buffer_.size() < size) {
+        buffer_.resize(size);
+    }
+    while (end_ < size) {
+        const ssize_t count = read(socket_fd_, buffer_.data() + end_, buffer_.size() - end_);
+        if (count == 0) {
+            return false;
+        }
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("shard connection read failed: ") + std::strerror(errno));
+        }
+        end_ += static_cast<size_t>(count);
+    }
+    return true;
+}
+
+void WriteShardFrames(int socket_fd, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t count = send(socket_fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("shard connection write failed: ") + std::strerror(errno));
+        }
+        data.remove_prefix(static_cast<size_t>(count));
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Двоичный протокол между ShardedSearchServer и процессами шардов (сокеты Unix).
+// Кадр: длина тела (4 байта), номер запроса (4 байта), тип сообщения (1 байт), тело. Ответ несет номер запроса,
+// поэтому по одному соединению можно отправить несколько запросов, не дожидаясь ответов.
+// В теле целые - varint (LEB128, знаковые - zigzag), строки - длина и байты, double - 8 байт как в памяти:
+// координатор и шарды работают на одной машине.
+
+enum class ShardMessageType : uint8_t {
+    ADD_DOCUMENTS = 1,  // число документов, для каждого id, статус, рейтинги, текст -> пусто
+    REMOVE_DOCUMENTS,  // число id, id -> пусто
+    WORD_DOCUMENT_COUNTS,  // запрос -> число слов, для каждого слово и число документов с ним
+    FIND_DOCUMENTS,  // запрос, статус, число лучших, число слов, для каждого слово и IDF -> документы
+    MATCH_DOCUMENT,  // запрос, id -> число слов, слова, статус
+    RESPONSE_OK = 100,
+    RESPONSE_INVALID_ARGUMENT,  // тело - текст исключения, координатор бросает то же исключение
+    RESPONSE_OUT_OF_RANGE,
+    RESPONSE_ERROR,
+};
+
+const size_t SHARD_FRAME_HEADER_SIZE = 9;
+const size_t SHARD_MAX_FRAME_BODY_SIZE = 1u << 30;
+
+struct ShardFrame {
+    uint32_t request_id = 0;
+    ShardMessageType type = ShardMessageType::RESPONSE_OK;
+    std::string body;
+};
+
+// Собирает кадр: заголовок, затем поля тела по порядку
+class ShardMessageWriter {
+public:
+    explicit ShardMessageWriter(ShardMessageType type, uint32_t request_id = 0);
+
+    void SetRequestId(uint32_t request_id);
+
+    void WriteUnsigned(uint64_t value);
+    void WriteInt(int64_t value);
+    void WriteDouble(double value);
+    void WriteString(std::string_view value);
+
+    // Кадр целиком, с длиной тела в заголовке
+    std::string_view GetFrame();
+
+private:
+    std::string frame_;
+};
+
+// Читает поля тела кадра по порядку. Тело короче ожидаемого - std::runtime_error.
+class ShardMessageReader {
+public:
+    explicit ShardMessageReader(std::string_view body);
+
+    uint64_t ReadUnsigned();
+    int64_t ReadInt();
+    double ReadDouble();
+    std::string_view ReadString();
+
+private:
+    std::string_view body_;
+};
+
+// Буферизованное чтение кадров из сокета: за один вызов read забирается столько кадров, сколько пришло
+class ShardFrameReader {
+public:
+    explicit ShardFrameReader(int socket_fd);
+
+    // false - соединение закрыто между кадрами; обрыв посреди кадра или ошибка чтения - std::runtime_error
+    bool ReadFrame(ShardFrame& frame);
+
+    // В буфере уже лежит целый кадр, и ReadFrame вернет его без чтения из сокета
+    bool HasBufferedFrame() const;
+
+private:
+    // Дочитывает из сокета, пока в буфере не станет хотя бы size байт; false - соединение закрыто
+    bool Fill(size_t size);
+
+    const int socket_fd_;
+    std::vector<char> buffer_;
+    size_t begin_ = 0;  // непрочитанные байты - [begin_, end_)
+    size_t end_ = 0;
+};
+
+// Пишет все байты (повторяет запись после частичной записи и прерывания сигналом).
+// Закрытое соединение или ошибка записи - std::runtime_error.
+void WriteShardFrames(int socket_fd, std::string_view data);
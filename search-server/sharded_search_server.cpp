@@ -0,0 +1,552 @@
+#include "sharded_search_server.h"
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "shard_protocol.h"
+
+namespace {
+
+DocumentStatus ReadDocumentStatus(ShardMessageReader& reader) {
+    const uint64_t status = reader.ReadUnsigned();
+    if (status > static_cast<uint64_t>(DocumentStatus::REMOVED)) {
+        throw std::invalid_argument("invalid document status");
+    }
+    return static_cast<DocumentStatus>(status);
+}
+
+// Ответ шарда на один запрос. Исключения SearchServer передаются координатору с типом и текстом.
+ShardMessageWriter HandleShardRequest(SearchServer& search_server, const ShardFrame& request) {
+    const auto make_error = [&request](ShardMessageType type, const char* what) {
+        ShardMessageWriter response(type, request.request_id);
+        response.WriteString(what);
+        return response;
+    };
+    try {
+        ShardMessageWriter response(ShardMessageType::RESPONSE_OK, request.request_id);
+        ShardMessageReader reader(request.body);
+        switch (request.type) {
+        case ShardMessageType::ADD_DOCUMENTS: {
+            // Тексты ссылаются на тело запроса, которое живет до конца обработки
+            std::vector<RawDocument> documents(reader.ReadUnsigned());
+            for (RawDocument& document : documents) {
+                document.id = static_cast<int>(reader.ReadInt());
+                document.status = ReadDocumentStatus(reader);
+                document.ratings.resize(reader.ReadUnsigned());
+                for (int& rating : document.ratings) {
+                    rating = static_cast<int>(reader.ReadInt());
+                }
+                document.text = reader.ReadString();
+            }
+            search_server.AddDocuments(documents);
+            break;
+        }
+        case ShardMessageType::REMOVE_DOCUMENTS:
+            for (uint64_t count = reader.ReadUnsigned(); count > 0; --count) {
+                search_server.RemoveDocument(static_cast<int>(reader.ReadInt()));
+            }
+            break;
+        case ShardMessageType::WORD_DOCUMENT_COUNTS: {
+            const auto word_document_counts = search_server.GetQueryWordDocumentCounts(reader.ReadString());
+            response.WriteUnsigned(word_document_counts.size());
+            for (const auto& [word, count] : word_document_counts) {
+                response.WriteString(word);
+                response.WriteUnsigned(count);
+            }
+            break;
+        }
+        case ShardMessageType::FIND_DOCUMENTS: {
+            const std::string_view raw_query = reader.ReadString();
+            const DocumentStatus status = ReadDocumentStatus(reader);
+            const size_t count = reader.ReadUnsigned();
+            std::map<std::string_view, double> inverse_document_freqs;
+            for (uint64_t word_count = reader.ReadUnsigned(); word_count > 0; --word_count) {
+                const std::string_view word = reader.ReadString();
+                inverse_document_freqs.emplace(word, reader.ReadDouble());
+            }
+            auto documents = search_server.FindSegmentDocuments(raw_query, status, inverse_document_freqs);
+            // Лучшие документы всего индекса есть среди count лучших каждого шарда; упорядочит их координатор
+            if (documents.size() > count) {
+                std::nth_element(documents.begin(), documents.begin() + count, documents.end(),
+                                 SearchServer::IsMoreRelevant);
+                documents.resize(count);
+            }
+            response.WriteUnsigned(documents.size());
+            for (const Document& document : documents) {
+                response.WriteInt(document.id);
+                response.WriteDouble(document.relevance);
+                response.WriteInt(document.rating);
+            }
+            break;
+        }
+        case ShardMessageType::MATCH_DOCUMENT: {
+            const std::string_view raw_query = reader.ReadString();
+            const auto [words, status] = search_server.MatchDocument(raw_query, static_cast<int>(reader.ReadInt()));
+            response.WriteUnsigned(words.size());
+            for (const std::string_view word : words) {
+                response.WriteString(word);
+            }
+            response.WriteUnsigned(static_cast<uint64_t>(status));
+            break;
+        }
+        default:
+            throw std::runtime_error("unknown shard message type");
+        }
+        return response;
+    }
+    catch (const std::invalid_argument& e) {
+        return make_error(ShardMessageType::RESPONSE_INVALID_ARGUMENT, e.what());
+    }
+    catch (const std::out_of_range& e) {
+        return make_error(ShardMessageType::RESPONSE_OUT_OF_RANGE, e.what());
+    }
+    catch (const std::exception& e) {
+        return make_error(ShardMessageType::RESPONSE_ERROR, e.what());
+    }
+}
+
+// Цикл процесса-шарда: запросы обрабатываются по порядку, пока координатор не закроет соединение
+void RunShardWorker(int socket_fd, const std::string& stop_words) {
+    SearchServer search_server(stop_words);
+    ShardFrameReader reader(socket_fd);
+    std::string responses;
+    ShardFrame request;
+    while (reader.ReadFrame(request)) {
+        ShardMessageWriter response = HandleShardRequest(search_server, request);
+        responses += response.GetFrame();
+        // Ответы на запросы, пришедшие вместе, уходят одной записью
+        if (!reader.HasBufferedFrame()) {
+            WriteShardFrames(socket_fd, responses);
+            responses.clear();
+        }
+    }
+}
+
+// Процесс-шард и сокет координатора. Потомок закрывает сокеты уже запущенных шардов: иначе шард
+// не увидел бы конца соединения, когда координатор закроет свой конец.
+std::pair<pid_t, int> StartShardProcess(const std::string& stop_words,
+                                        const std::vector<std::pair<pid_t, int>>& started_shards) {
+    int socket_fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, socket_fds) != 0) {
+        throw std::runtime_error(std::string("socketpair failed: ") + std::strerror(errno));
+    }
+    const pid_t pid = fork();
+    if (pid < 0) {
+        const int fork_errno = errno;
+        close(socket_fds[0]);
+        close(socket_fds[1]);
+        throw std::runtime_error(std::string("fork failed: ") + std::strerror(fork_errno));
+    }
+    if (pid == 0) {
+        close(socket_fds[0]);
+        for (const auto& [shard_pid, socket_fd] : started_shards) {
+            close(socket_fd);
+        }
+        int exit_code = 0;
+        try {
+            RunShardWorker(socket_fds[1], stop_words);
+        }
+        catch (...) {
+            exit_code = 1;
+        }
+        // Без деструкторов статических объектов и обработчиков atexit, доставшихся от координатора
+        _exit(exit_code);
+    }
+    close(socket_fds[1]);
+    return { pid, socket_fds[0] };
+}
+
+// Тело ответа или исключение того же типа, что бросил SearchServer шарда
+ShardFrame WaitResponse(std::future<ShardFrame>& response) {
+    ShardFrame frame = response.get();
+    switch (frame.type) {
+    case ShardMessageType::RESPONSE_OK:
+        return frame;
+    case ShardMessageType::RESPONSE_INVALID_ARGUMENT:
+        throw std::invalid_argument(frame.body);
+    case ShardMessageType::RESPONSE_OUT_OF_RANGE:
+        throw std::out_of_range(frame.body);
+    default:
+        throw std::runtime_error(frame.body);
+    }
+}
+
+// Исключение того же вида и с тем же текстом, что error (как из WaitResponse), с обрабатываемым сейчас
+// исключением внутри (std::nested_exception). Вызывается из блока catch.
+[[noreturn]] void ThrowWithCurrentNested(const std::exception_ptr& error) {
+    enum class Kind { INVALID_ARGUMENT, OUT_OF_RANGE, RUNTIME_ERROR };
+    Kind kind = Kind::RUNTIME_ERROR;
+    std::string what = "unknown error";
+    // После выхода из этого try обрабатываемым снова становится исключение вызывающего
+    try {
+        std::rethrow_exception(error);
+    }
+    catch (const std::invalid_argument& e) {
+        kind = Kind::INVALID_ARGUMENT;
+        what = e.what();
+    }
+    catch (const std::out_of_range& e) {
+        kind = Kind::OUT_OF_RANGE;
+        what = e.what();
+    }
+    catch (const std::exception& e) {
+        what = e.what();
+    }
+    catch (...) {
+    }
+    switch (kind) {
+    case Kind::INVALID_ARGUMENT:
+        std::throw_with_nested(std::invalid_argument(what));
+    case Kind::OUT_OF_RANGE:
+        std::throw_with_nested(std::out_of_range(what));
+    default:
+        std::throw_with_nested(std::runtime_error(what));
+    }
+}
+
+}  // namespace
+
+// Соединение с процессом-шардом. Запросы пишутся под своей блокировкой и не ждут ответов;
+// поток чтения отдает каждый ответ обещанию с его номером запроса.
+class ShardedSearchServer::Shard {
+public:
+    Shard(pid_t pid, int socket_fd)
+        : pid_(pid)
+        , socket_fd_(socket_fd)
+        , reader_thread_([this] { ReadResponses(); }) {
+    }
+
+    // Шард читает конец соединения и завершается, после чего поток чтения видит закрытие
+    ~Shard() {
+        shutdown(socket_fd_, SHUT_WR);
+        reader_thread_.join();
+        close(socket_fd_);
+        waitpid(pid_, nullptr, 0);
+    }
+
+    Shard(const Shard&) = delete;
+    Shard& operator=(const Shard&) = delete;
+
+    // Отправляет запрос (номер запроса ставится здесь). Оборванное соединение - std::runtime_error.
+    std::future<ShardFrame> Send(ShardMessageWriter& message) {
+        std::promise<ShardFrame> promise;
+        std::future<ShardFrame> response = promise.get_future();
+        uint32_t request_id;
+        {
+            std::lock_guard guard(pending_mutex_);
+            if (!error_.empty()) {
+                throw std::runtime_error(error_);
+            }
+            request_id = next_request_id_++;
+            pending_.emplace(request_id, std::move(promise));
+        }
+        message.SetRequestId(request_id);
+        try {
+            std::lock_guard guard(write_mutex_);
+            WriteShardFrames(socket_fd_, message.GetFrame());
+        }
+        catch (...) {
+            std::lock_guard guard(pending_mutex_);
+            pending_.erase(request_id);
+            throw;
+        }
+        return response;
+    }
+
+private:
+    void ReadResponses() {
+        std::string error = "shard process exited";
+        try {
+            ShardFrameReader reader(socket_fd_);
+            ShardFrame frame;
+            while (reader.ReadFrame(frame)) {
+                std::promise<ShardFrame> promise;
+                {
+                    std::lock_guard guard(pending_mutex_);
+                    const auto it = pending_.find(frame.request_id);
+                    if (it == pending_.end()) {
+                        continue;
+                    }
+                    promise = std::move(it->second);
+                    pending_.erase(it);
+                }
+                promise.set_value(std::move(frame));
+            }
+        }
+        catch (const std::exception& e) {
+            error = e.what();
+        }
+        // Ответов больше не будет: ждущие запросы и все следующие получают ошибку
+        std::lock_guard guard(pending_mutex_);
+        error_ = error;
+        for (auto& [request_id, promise] : pending_) {
+            promise.set_exception(std::make_exception_ptr(std::runtime_error(error_)));
+        }
+        pending_.clear();
+    }
+
+    const pid_t pid_;
+    const int socket_fd_;
+    std::mutex write_mutex_;  // кадры разных запросов не перемешиваются
+    std::mutex pending_mutex_;  // отдельно от записи: поток чтения не ждет пишущих
+    std::unordered_map<uint32_t, std::promise<ShardFrame>> pending_;
+    uint32_t next_request_id_ = 0;
+    std::string error_;  // непусто, когда соединение оборвано
+    std::thread reader_thread_;  // последним: поток запускается, когда остальные поля уже созданы
+};
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, std::string_view stop_words) {
+    if (shard_count == 0) {
+        throw std::invalid_argument("shard count must be positive");
+    }
+    const std::string stop_words_text(stop_words);
+    // Некорректные стоп-слова - std::invalid_argument здесь, а не ошибка в каждом шарде
+    const SearchServer stop_words_check(stop_words_text);
+
+    // Все процессы запускаются до потоков чтения, чтобы fork копировал однопоточный процесс
+    std::vector<std::pair<pid_t, int>> started_shards;
+    try {
+        for (size_t i = 0; i < shard_count; ++i) {
+            started_shards.push_back(StartShardProcess(stop_words_text, started_shards));
+        }
+    }
+    catch (...) {
+        for (const auto& [pid, socket_fd] : started_shards) {
+            close(socket_fd);
+            waitpid(pid, nullptr, 0);
+        }
+        throw;
+    }
+    for (const auto& [pid, socket_fd] : started_shards) {
+        shards_.push_back(std::make_unique<Shard>(pid, socket_fd));
+    }
+}
+
+ShardedSearchServer::~ShardedSearchServer() = default;
+
+void ShardedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                      const std::vector<int>& ratings) {
+    AddDocuments({ RawDocument{ document_id, document, status, ratings } });
+}
+
+void ShardedSearchServer::AddDocuments(const std::vector<RawDocument>& documents) {
+    std::unique_lock lock(documents_mutex_);
+    std::set<int> batch_ids;
+    for (const RawDocument& document : documents) {
+        if (document.id < 0) {
+            throw std::invalid_argument("invalid id");
+        }
+        if (document_ids_.count(document.id) != 0 || !batch_ids.insert(document.id).second) {
+            throw std::invalid_argument("id is busy");
+        }
+    }
+
+    std::vector<std::vector<const RawDocument*>> shard_documents(shards_.size());
+    for (const RawDocument& document : documents) {
+        shard_documents[GetShardIndex(document.id, shards_.size())].push_back(&document);
+    }
+    std::vector<std::future<ShardFrame>> responses(shards_.size());
+    for (size_t shard = 0; shard < shards_.size(); ++shard) {
+        if (shard_documents[shard].empty()) {
+            continue;
+        }
+        ShardMessageWriter request(ShardMessageType::ADD_DOCUMENTS);
+        request.WriteUnsigned(shard_documents[shard].size());
+        for (const RawDocument* document : shard_documents[shard]) {
+            request.WriteInt(document->id);
+            request.WriteUnsigned(static_cast<uint64_t>(document->status));
+            request.WriteUnsigned(document->ratings.size());
+            for (const int rating : document->ratings) {
+                request.WriteInt(rating);
+            }
+            request.WriteString(document->text);
+        }
+        responses[shard] = shards_[shard]->Send(request);
+    }
+
+    // Каждый шард добавляет свои документы целиком или не добавляет ни одного.
+    // Если отказал хоть один, документы убираются из остальных.
+    std::exception_ptr error;
+    std::vector<size_t> added_shards;
+    for (size_t shard = 0; shard < shards_.size(); ++shard) {
+        if (!responses[shard].valid()) {
+            continue;
+        }
+        try {
+            WaitResponse(responses[shard]);
+            added_shards.push_back(shard);
+        }
+        catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (error) {
+        // Документы шарда, который не смог их удалить, остались в индексе и учитываются в document_ids_
+        std::exception_ptr rollback_error;
+        for (const size_t shard : added_shards) {
+            ShardMessageWriter request(ShardMessageType::REMOVE_DOCUMENTS);
+            request.WriteUnsigned(shard_documents[shard].size());
+            for (const RawDocument* document : shard_documents[shard]) {
+                request.WriteInt(document->id);
+            }
+            try {
+                auto response = shards_[shard]->Send(request);
+                WaitResponse(response);
+            }
+            catch (...) {
+                if (!rollback_error) {
+                    rollback_error = std::current_exception();
+                }
+                for (const RawDocument* document : shard_documents[shard]) {
+                    document_ids_.insert(document->id);
+                }
+            }
+        }
+        if (!rollback_error) {
+            std::rethrow_exception(error);
+        }
+        try {
+            std::rethrow_exception(rollback_error);
+        }
+        catch (...) {
+            ThrowWithCurrentNested(error);
+        }
+    }
+    document_ids_.insert(batch_ids.begin(), batch_ids.end());
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    std::unique_lock lock(documents_mutex_);
+    if (document_ids_.count(document_id) == 0) {
+        return;
+    }
+    ShardMessageWriter request(ShardMessageType::REMOVE_DOCUMENTS);
+    request.WriteUnsigned(1);
+    request.WriteInt(document_id);
+    auto response = shards_[GetShardIndex(document_id, shards_.size())]->Send(request);
+    WaitResponse(response);
+    document_ids_.erase(document_id);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+    std::shared_lock lock(documents_mutex_);
+
+    // Первый круг: число документов с каждым плюс-словом во всех шардах
+    ShardMessageWriter count_request(ShardMessageType::WORD_DOCUMENT_COUNTS);
+    count_request.WriteString(raw_query);
+    std::vector<std::future<ShardFrame>> count_responses;
+    for (const auto& shard : shards_) {
+        count_responses.push_back(shard->Send(count_request));
+    }
+    std::map<std::string, int, std::less<>> word_document_counts;
+    std::vector<char> has_words(shards_.size());  // шарду без плюс-слов запроса нечего искать
+    for (size_t shard = 0; shard < shards_.size(); ++shard) {
+        const ShardFrame frame = WaitResponse(count_responses[shard]);
+        ShardMessageReader reader(frame.body);
+        const uint64_t word_count = reader.ReadUnsigned();
+        has_words[shard] = word_count > 0;
+        for (uint64_t i = 0; i < word_count; ++i) {
+            const std::string_view word = reader.ReadString();
+            const int count = static_cast<int>(reader.ReadUnsigned());
+            const auto it = word_document_counts.find(word);
+            if (it == word_document_counts.end()) {
+                word_document_counts.emplace(word, count);
+            }
+            else {
+                it->second += count;
+            }
+        }
+    }
+    if (word_document_counts.empty()) {
+        return {};
+    }
+
+    // Второй круг: поиск с общими IDF
+    const double log_document_count = std::log(static_cast<double>(document_ids_.size()));
+    ShardMessageWriter find_request(ShardMessageType::FIND_DOCUMENTS);
+    find_request.WriteString(raw_query);
+    find_request.WriteUnsigned(static_cast<uint64_t>(status));
+    find_request.WriteUnsigned(MAX_RESULT_DOCUMENT_COUNT);
+    find_request.WriteUnsigned(word_document_counts.size());
+    for (const auto& [word, count] : word_document_counts) {
+        find_request.WriteString(word);
+        find_request.WriteDouble(log_document_count - std::log(static_cast<double>(count)));
+    }
+    std::vector<std::future<ShardFrame>> find_responses(shards_.size());
+    for (size_t shard = 0; shard < shards_.size(); ++shard) {
+        if (has_words[shard]) {
+            find_responses[shard] = shards_[shard]->Send(find_request);
+        }
+    }
+    std::vector<Document> matched_documents;
+    for (auto& response : find_responses) {
+        if (!response.valid()) {
+            continue;
+        }
+        const ShardFrame frame = WaitResponse(response);
+        ShardMessageReader reader(frame.body);
+        for (uint64_t count = reader.ReadUnsigned(); count > 0; --count) {
+            Document document;
+            document.id = static_cast<int>(reader.ReadInt());
+            document.relevance = reader.ReadDouble();
+            document.rating = static_cast<int>(reader.ReadInt());
+            matched_documents.push_back(document);
+        }
+    }
+    const size_t count = MAX_RESULT_DOCUMENT_COUNT;
+    if (matched_documents.size() > count) {
+        std::partial_sort(matched_documents.begin(), matched_documents.begin() + count, matched_documents.end(),
+                          SearchServer::IsMoreRelevant);
+        matched_documents.resize(count);
+    }
+    else {
+        std::sort(matched_documents.begin(), matched_documents.end(), SearchServer::IsMoreRelevant);
+    }
+    return matched_documents;
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::tuple<std::vector<std::string>, DocumentStatus> ShardedSearchServer::MatchDocument(std::string_view raw_query,
+                                                                                       int document_id) const {
+    std::shared_lock lock(documents_mutex_);
+    ShardMessageWriter request(ShardMessageType::MATCH_DOCUMENT);
+    request.WriteString(raw_query);
+    request.WriteInt(document_id);
+    auto response = shards_[GetShardIndex(document_id, shards_.size())]->Send(request);
+    const ShardFrame frame = WaitResponse(response);
+    ShardMessageReader reader(frame.body);
+    std::vector<std::string> words(reader.ReadUnsigned());
+    for (std::string& word : words) {
+        word = reader.ReadString();
+    }
+    return { std::move(words), ReadDocumentStatus(reader) };
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    std::shared_lock lock(documents_mutex_);
+    return static_cast<int>(document_ids_.size());
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id, size_t shard_count) {
+    const uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(document_id)) * 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>((hash >> 32) % shard_count);
+}
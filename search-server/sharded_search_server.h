@@ -0,0 +1,73 @@
+#pragma once
+
+#include <memory>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+#include "document.h"
+#include "search_server.h"
+
+// Индекс, разделенный между процессами-шардами на одной машине: каждый шард - отдельный процесс со своим
+// SearchServer, документ попадает в шард по хешу id. Координатор (этот объект) связан с каждым шардом
+// парой сокетов Unix и говорит с ним по протоколу из shard_protocol.h.
+//
+// Запрос идет в два круга, как в SegmentedSearchServer: сначала все шарды сообщают число документов с каждым
+// плюс-словом, затем ищут с общими IDF и возвращают свои лучшие документы, а координатор отбирает лучшие среди них.
+// Поэтому релевантность та же, что у одного SearchServer с теми же документами. Запросы из разных потоков
+// не ждут друг друга: по соединению уходят сразу, ответы разбирает поток чтения по номеру запроса.
+//
+// Шарды запускаются через fork в конструкторе, поэтому объект лучше создавать до запуска других потоков.
+// Фильтр по предикату через процесс не передать, поэтому поиск фильтрует только по статусу.
+class ShardedSearchServer {
+public:
+    // Запуск shard_count шардов. Ошибка создания сокетов или процессов - std::runtime_error.
+    explicit ShardedSearchServer(size_t shard_count, std::string_view stop_words = {});
+
+    // Закрывает соединения и дожидается завершения шардов
+    ~ShardedSearchServer();
+
+    ShardedSearchServer(const ShardedSearchServer&) = delete;
+    ShardedSearchServer& operator=(const ShardedSearchServer&) = delete;
+
+    // Ошибки - те же исключения, что у SearchServer. Отказ шарда - std::runtime_error.
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                     const std::vector<int>& ratings);
+
+    // Шарды получают свои документы одним сообщением. Если хоть один документ некорректен,
+    // документы, уже добавленные в другие шарды, удаляются, и индекс не меняется. Исключение - то, что
+    // бросил отказавший шард. Если и удаление в каком-то шарде не удалось, его документы остаются в индексе,
+    // а ошибка удаления вложена в исключение (std::rethrow_if_nested).
+    void AddDocuments(const std::vector<RawDocument>& documents);
+
+    void RemoveDocument(int document_id);
+
+    // Поиск в режиме QueryMode::ANY_WORD, MAX_RESULT_DOCUMENT_COUNT лучших
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    // Слова копируются из ответа шарда, поэтому возвращаются строками. Неизвестный id - std::out_of_range.
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view raw_query,
+                                                                      int document_id) const;
+
+    int GetDocumentCount() const;
+
+    size_t GetShardCount() const;
+
+    // Номер шарда документа: старшие биты произведения id на 2^64 / золотое сечение, чтобы идущие подряд id
+    // расходились по шардам равномерно
+    static size_t GetShardIndex(int document_id, size_t shard_count);
+
+private:
+    class Shard;
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    // id всех документов. Поиск держит разделяемую блокировку, изменение индекса - исключительную,
+    // поэтому число документов для IDF совпадает с содержимым шардов.
+    mutable std::shared_mutex documents_mutex_;
+    std::set<int> document_ids_;
+};
@@ -0,0 +1,80 @@
+#include "snapshot_search_server.h"
+
+SnapshotSearchServer::SnapshotSearchServer() : SnapshotSearchServer(SearchServer()) {
+}
+
+SnapshotSearchServer::SnapshotSearchServer(SearchServer initial)
+    : versions_{ std::make_shared<SearchServer>(initial), std::make_shared<SearchServer>(std::move(initial)) } {
+    for (const auto& version : versions_) {
+        version->SetStatsRecorder(stats_recorder_);
+    }
+}
+
+SearchServer& SnapshotSearchServer::GetStaging() {
+    return *versions_[1 - published_index_.load()];
+}
+
+void SnapshotSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                       const std::vector<int>& ratings) {
+    std::lock_guard guard(writer_mutex_);
+    // В журнал попадают только удавшиеся изменения, поэтому повтор на копии той же версии тоже удастся
+    GetStaging().AddDocument(document_id, document, status, ratings);
+    pending_operations_.push_back({ false, document_id, std::string(document), status, ratings });
+}
+
+void SnapshotSearchServer::RemoveDocument(int document_id) {
+    std::lock_guard guard(writer_mutex_);
+    GetStaging().RemoveDocument(document_id);
+    pending_operations_.push_back({ true, document_id, {}, DocumentStatus::ACTUAL, {} });
+}
+
+void SnapshotSearchServer::Publish() {
+    // Блокировка писателей держится и на время выкладки, чтобы версии выходили в порядке изменений
+    std::lock_guard guard(writer_mutex_);
+    if (pending_operations_.empty()) {
+        return;
+    }
+    const size_t old_index = published_index_.load();
+    published_index_.store(1 - old_index);
+    reader_epochs_.Synchronize();
+
+    // Новых ссылок на старую версию больше не появится; если чужих нет, она догоняет новую по журналу
+    std::shared_ptr<SearchServer>& old_version = versions_[old_index];
+    if (old_version.use_count() == 1) {
+        for (const Operation& operation : pending_operations_) {
+            if (operation.is_removal) {
+                old_version->RemoveDocument(operation.document_id);
+            }
+            else {
+                old_version->AddDocument(operation.document_id, operation.document, operation.status,
+                                         operation.ratings);
+            }
+        }
+    }
+    else {
+        old_version = std::make_shared<SearchServer>(*versions_[1 - old_index]);
+        old_version->SetStatsRecorder(stats_recorder_);
+    }
+    pending_operations_.clear();
+}
+
+std::shared_ptr<const SearchServer> SnapshotSearchServer::GetSnapshot() const {
+    const auto guard = reader_epochs_.Pin();
+    return versions_[published_index_.load()];
+}
+
+std::tuple<std::vector<std::string>, DocumentStatus> SnapshotSearchServer::MatchDocument(std::string_view raw_query,
+                                                                                         int document_id) const {
+    const auto guard = reader_epochs_.Pin();
+    const auto [words, status] = versions_[published_index_.load()]->MatchDocument(raw_query, document_id);
+    return { std::vector<std::string>(words.begin(), words.end()), status };
+}
+
+int SnapshotSearchServer::GetDocumentCount() const {
+    const auto guard = reader_epochs_.Pin();
+    return versions_[published_index_.load()]->GetDocumentCount();
+}
+
+SearchStats SnapshotSearchServer::GetStats() const {
+    return stats_recorder_->GetStats();
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "reader_epochs.h"
+#include "search_server.h"
+
+// Поисковый сервер для одновременной загрузки документов и поиска из многих потоков.
+//
+// Индекс хранится в двух экземплярах: опубликованный читают, промежуточный меняют писатели.
+// Блокировки:
+// - писатели (AddDocument, RemoveDocument, Publish) выполняются по одному под writer_mutex_;
+// - читатели не берут мьютексов и не трогают счетчик ссылок: поиск занимает ячейку в ReaderEpochs
+//   (одна атомарная операция на входе и на выходе) и читает опубликованный экземпляр по указателю;
+// - GetSnapshot дополнительно копирует shared_ptr, и эта версия не меняется, пока указатель жив.
+// Publish меняет экземпляры местами, ждет выхода читателей старого (ReaderEpochs::Synchronize) и повторяет
+// на нем изменения из журнала, так что индекс не копируется целиком. Полная копия делается, только если
+// старую версию еще держит указатель из GetSnapshot.
+class SnapshotSearchServer {
+public:
+    SnapshotSearchServer();
+
+    explicit SnapshotSearchServer(SearchServer initial);
+
+    // Изменения попадают в промежуточный индекс и видны читателям только после Publish
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                     const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    // Выкладывает промежуточный индекс как новую версию для читателей. Ждет окончания запросов
+    // к предыдущей версии, поэтому ее нельзя вызывать из предиката поиска.
+    void Publish();
+
+    // Текущая опубликованная версия. Пока указатель жив, версия не изменится и не удалится.
+    std::shared_ptr<const SearchServer> GetSnapshot() const;
+
+    // Поиск по текущей версии: принимает те же аргументы, что и SearchServer::FindTopDocuments
+    template <typename... Args>
+    std::vector<Document> FindTopDocuments(Args&&... args) const;
+
+    // Слова копируются в строки: после выхода из метода версия может быть изменена следующей публикацией
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view raw_query,
+                                                                       int document_id) const;
+
+    int GetDocumentCount() const;
+
+    // Статистика запросов ко всем версиям: они пишут в один recorder, и публикация ее не сбрасывает
+    SearchStats GetStats() const;
+
+private:
+    // Изменение промежуточного индекса, которое Publish повторяет на экземпляре предыдущей версии
+    struct Operation {
+        bool is_removal;
+        int document_id;
+        std::string document;
+        DocumentStatus status;
+        std::vector<int> ratings;
+    };
+
+    SearchServer& GetStaging();
+
+    const std::shared_ptr<QueryStatsRecorder> stats_recorder_ = std::make_shared<QueryStatsRecorder>();
+    std::mutex writer_mutex_;
+    std::array<std::shared_ptr<SearchServer>, 2> versions_;  // опубликованный и промежуточный
+    std::atomic<size_t> published_index_{0};  // какой из versions_ опубликован
+    std::vector<Operation> pending_operations_;  // изменения после последней публикации
+    mutable ReaderEpochs reader_epochs_;
+};
+
+template <typename... Args>
+std::vector<Document> SnapshotSearchServer::FindTopDocuments(Args&&... args) const {
+    const auto guard = reader_epochs_.Pin();
+    return versions_[published_index_.load()]->FindTopDocuments(std::forward<Args>(args)...);
+}
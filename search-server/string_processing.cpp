@@ -2,23 +2,35 @@
 #include <string>
 #include <vector>
 
-std::vector<std::string> SplitIntoWords(const std::string& text) {
-    std::vector<std::string> words;
-    std::string word;
-    for (const char c : text) {
-        if (c == ' ') {
-            if (!word.empty()) {
-                words.push_back(word);
-                word.clear();
-            }
+namespace {
+
+template <typename Words>
+void AppendWords(std::string_view text, Words& words) {
+    while (true) {
+        const auto begin = text.find_first_not_of(' ');
+        if (begin == text.npos) {
+            break;
         }
-        else {
-            word += c;
+        text.remove_prefix(begin);
+        const auto end = text.find(' ');
+        words.push_back(text.substr(0, end));
+        if (end == text.npos) {
+            break;
         }
+        text.remove_prefix(end);
     }
-    if (!word.empty()) {
-        words.push_back(word);
-    }
+}
+
+}  // namespace
+
+std::vector<std::string_view> SplitIntoWords(std::string_view text) {
+    std::vector<std::string_view> words;
+    AppendWords(text, words);
+    return words;
+}
 
+std::pmr::vector<std::string_view> SplitIntoWords(std::string_view text, std::pmr::memory_resource* resource) {
+    std::pmr::vector<std::string_view> words(resource);
+    AppendWords(text, words);
     return words;
-}
\ No newline at end of file
+}
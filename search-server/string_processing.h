@@ -1,5 +1,11 @@
 #pragma once
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 
-std::vector<std::string> SplitIntoWords(const std::string& text);
\ No newline at end of file
+// Слова возвращаются как string_view на исходный текст, поэтому текст должен жить дольше результата
+std::vector<std::string_view> SplitIntoWords(std::string_view text);
+
+// То же, но вектор слов берет память из resource (например, из арены запроса)
+std::pmr::vector<std::string_view> SplitIntoWords(std::string_view text, std::pmr::memory_resource* resource);
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "term_dictionary.h"
+#include <functional>
+#include <stdexcept>
+
+TermDictionary::TermDictionary(const std::vector<std::string_view>& sorted_terms) {
+    size_t text_size = 0;
+    for (const std::string_view term : sorted_terms) {
+        text_size += term.size();
+    }
+    if (text_size >= std::numeric_limits<uint32_t>::max() || sorted_terms.size() >= TERM_NOT_FOUND) {
+        throw std::length_error("term dictionary is too large");
+    }
+    text_.reserve(text_size);
+    offsets_.reserve(sorted_terms.size() + 1);
+    offsets_.push_back(0);
+    for (const std::string_view term : sorted_terms) {
+        text_.insert(text_.end(), term.begin(), term.end());
+        offsets_.push_back(static_cast<uint32_t>(text_.size()));
+    }
+
+    size_t slot_count = 1;
+    while (slot_count < sorted_terms.size() * 2) {
+        slot_count *= 2;
+    }
+    hash_slots_.assign(slot_count, 0);
+    const size_t mask = slot_count - 1;
+    for (uint32_t term_id = 0; term_id < sorted_terms.size(); ++term_id) {
+        size_t slot = std::hash<std::string_view>{}(sorted_terms[term_id]) & mask;
+        while (hash_slots_[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        hash_slots_[slot] = term_id + 1;
+    }
+}
+
+size_t TermDictionary::size() const {
+    return offsets_.empty() ? 0 : offsets_.size() - 1;
+}
+
+bool TermDictionary::empty() const {
+    return size() == 0;
+}
+
+std::string_view TermDictionary::GetTerm(uint32_t term_id) const {
+    return { text_.data() + offsets_[term_id], offsets_[term_id + 1] - offsets_[term_id] };
+}
+
+uint32_t TermDictionary::Find(std::string_view term) const {
+    if (hash_slots_.empty()) {
+        return TERM_NOT_FOUND;
+    }
+    const size_t mask = hash_slots_.size() - 1;
+    for (size_t slot = std::hash<std::string_view>{}(term) & mask; hash_slots_[slot] != 0; slot = (slot + 1) & mask) {
+        const uint32_t term_id = hash_slots_[slot] - 1;
+        if (GetTerm(term_id) == term) {
+            return term_id;
+        }
+    }
+    return TERM_NOT_FOUND;
+}
+
+bool TermDictionary::Contains(std::string_view term) const {
+    return Find(term) != TERM_NOT_FOUND;
+}
+
+std::pair<uint32_t, uint32_t> TermDictionary::FindPrefix(std::string_view prefix) const {
+    // Первое слово не меньше префикса, затем первое слово после него, которое с префикса не начинается
+    uint32_t first = 0;
+    uint32_t last = static_cast<uint32_t>(size());
+    while (first < last) {
+        const uint32_t middle = first + (last - first) / 2;
+        if (GetTerm(middle) < prefix) {
+            first = middle + 1;
+        }
+        else {
+            last = middle;
+        }
+    }
+    uint32_t prefix_end = first;
+    last = static_cast<uint32_t>(size());
+    while (prefix_end < last) {
+        const uint32_t middle = prefix_end + (last - prefix_end) / 2;
+        if (GetTerm(middle).substr(0, prefix.size()) == prefix) {
+            prefix_end = middle + 1;
+        }
+        else {
+            last = middle;
+        }
+    }
+    return { first, prefix_end };
+}
+
+size_t TermDictionary::GetMemoryUsage() const {
+    return text_.capacity() + offsets_.capacity() * sizeof(uint32_t) + hash_slots_.capacity() * sizeof(uint32_t);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+const uint32_t TERM_NOT_FOUND = std::numeric_limits<uint32_t>::max();
+
+// Неизменяемый словарь: слова по возрастанию, тексты всех слов подряд в одном массиве.
+// Номер слова (term id) - его место в этом порядке, 0..size()-1.
+//
+// Точный поиск идет по хеш-таблице с открытой адресацией (номера слов, заполнена не больше чем наполовину),
+// поиск по префиксу - двоичным поиском по отсортированным словам: слова с общим префиксом идут подряд.
+// Тексты не сжимаются общими префиксами, чтобы GetTerm отдавал string_view без копирования. При перемещении
+// словаря массив текстов не переезжает, и такие string_view остаются действительными.
+class TermDictionary {
+public:
+    TermDictionary() = default;
+
+    // Слова должны быть отсортированы по возрастанию и без повторов; тексты копируются
+    explicit TermDictionary(const std::vector<std::string_view>& sorted_terms);
+
+    size_t size() const;
+    bool empty() const;
+
+    std::string_view GetTerm(uint32_t term_id) const;
+
+    // Номер слова или TERM_NOT_FOUND
+    uint32_t Find(std::string_view term) const;
+    bool Contains(std::string_view term) const;
+
+    // Номера слов, начинающихся с prefix: [first, last)
+    std::pair<uint32_t, uint32_t> FindPrefix(std::string_view prefix) const;
+
+    // Байт в массивах словаря
+    size_t GetMemoryUsage() const;
+
+private:
+    std::vector<char> text_;
+    std::vector<uint32_t> offsets_;  // начало слова в text_; последний элемент - конец последнего слова
+    std::vector<uint32_t> hash_slots_;  // номер слова + 1, 0 - свободно; размер - степень двойки
+};
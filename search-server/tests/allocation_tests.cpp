@@ -0,0 +1,74 @@
+#include <string>
+#include <vector>
+#include "alloc_counter.h"
+#include "query_arena.h"
+#include "search_server.h"
+#include "string_processing.h"
+#include "test_suites.h"
+
+using namespace std;
+
+namespace {
+
+// Вызовы operator new во время function
+template <typename Function>
+size_t CountAllocations(Function function) {
+    const size_t count_before = GetThreadNewCount();
+    function();
+    return GetThreadNewCount() - count_before;
+}
+
+SearchServer MakeServer() {
+    SearchServer search_server("a the of"s);
+    const vector<string> words = {"white"s, "cat"s, "fashionable"s, "collar"s, "fluffy"s, "tail"s, "groomed"s,
+                                  "dog"s, "expressive"s, "eyes"s, "starling"s, "evgeny"s};
+    for (int id = 0; id < 200; ++id) {
+        string text;
+        for (size_t i = 0; i < 6; ++i) {
+            text += words[(id * 7 + i * 5) % words.size()] + " the "s;
+        }
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 10});
+    }
+    return search_server;
+}
+
+// Слова текста - string_view на сам текст, без копий
+void TestSplitIntoWordsViews() {
+    const string text = "  fluffy  cat with   tail "s;
+    const auto words = SplitIntoWords(text);
+    ASSERT_EQUAL(words, vector<string_view>({"fluffy"sv, "cat"sv, "with"sv, "tail"sv}));
+    for (const string_view word : words) {
+        ASSERT(word.data() >= text.data() && word.data() + word.size() <= text.data() + text.size());
+    }
+    QueryArenaScope arena_scope;
+    SplitIntoWords(text, arena_scope.GetResource());  // прогрев арены
+    ASSERT_EQUAL(CountAllocations([&] { SplitIntoWords(text, arena_scope.GetResource()); }), 0u);
+}
+
+// Прогретый запрос берет у operator new только память под результат, сколько бы в нем ни было слов
+void TestQueryAllocationsPerWord() {
+    const SearchServer search_server = MakeServer();
+    const string short_query = "cat"s;
+    string long_query;
+    for (int i = 0; i < 40; ++i) {
+        long_query += (i % 3 == 0 ? "-missing"s : "tail"s) + to_string(i) + " fluffy the white "s;
+    }
+    long_query += "-eyes c*"s;
+    const vector<string> queries = {short_query, long_query};
+    for (const string& query : queries) {
+        search_server.FindTopDocuments(query);
+    }
+    for (const string& query : queries) {
+        vector<Document> documents;
+        const size_t allocation_count = CountAllocations([&] { documents = search_server.FindTopDocuments(query); });
+        ASSERT(!documents.empty());
+        ASSERT_EQUAL_HINT(allocation_count, 1u, query);
+    }
+}
+
+}  // namespace
+
+void TestAllocations(TestRunner& runner) {
+    RUN_TEST(runner, TestSplitIntoWordsViews);
+    RUN_TEST(runner, TestQueryAllocationsPerWord);
+}
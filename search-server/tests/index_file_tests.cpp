@@ -0,0 +1,308 @@
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "index_file.h"
+#include "search_server.h"
+#include "test_suites.h"
+
+using namespace std;
+
+namespace {
+
+using RelevanceById = map<int, double>;
+
+// Временный файл, удаляется в деструкторе
+class TempFile {
+public:
+    explicit TempFile(const string& name)
+        : path_("search_server_test_"s + name + ".idx"s) {
+    }
+
+    ~TempFile() {
+        remove(path_.c_str());
+    }
+
+    const string& GetPath() const {
+        return path_;
+    }
+
+private:
+    string path_;
+};
+
+RelevanceById FindRelevances(const SearchServer& search_server, const string& query, DocumentStatus status) {
+    RelevanceById result;
+    for (const Document& document : search_server.FindTopDocuments(query, status)) {
+        result[document.id] = document.relevance;
+    }
+    return result;
+}
+
+// Индекс, у которого номера документов не совпадают с порядком id: документы добавлены не по возрастанию id,
+// часть удалена, одно слово появилось после Freeze
+SearchServer MakeShuffledServer() {
+    SearchServer search_server("and in at"s);
+    for (int i = 0; i < 200; ++i) {
+        const int id = (i * 37) % 200 * 3;
+        search_server.AddDocument(id, "word"s + to_string(i % 17) + " word"s + to_string(i % 5) + " common"s,
+                                  static_cast<DocumentStatus>(i % 4), {i % 10, i % 3});
+    }
+    search_server.Freeze();
+    for (int id = 0; id < 600; id += 9) {
+        if (search_server.HasDocument(id)) {
+            search_server.RemoveDocument(id);
+        }
+    }
+    search_server.AddDocument(1000, "fresh word3"s, DocumentStatus::ACTUAL, {5});
+    return search_server;
+}
+
+// После записи и загрузки совпадают документы, выдача и настройки поиска
+void TestRoundTrip() {
+    for (const PostingFormat format : {PostingFormat::PLAIN, PostingFormat::COMPRESSED}) {
+        SearchServer search_server = MakeShuffledServer();
+        search_server.SetPostingFormat(format);
+        search_server.SetMaxResultDocumentCount(1000);
+        search_server.SetQueryMode(QueryMode::ALL_WORDS);
+        search_server.SetDynamicPruning(true);
+        const TempFile file("round_trip"s);
+        search_server.SaveIndex(file.GetPath());
+        const SearchServer loaded = SearchServer::OpenIndex(file.GetPath());
+
+        ASSERT(loaded.GetPostingFormat() == format);
+        ASSERT_EQUAL(loaded.GetMaxResultDocumentCount(), 1000u);
+        ASSERT(loaded.GetQueryMode() == QueryMode::ALL_WORDS);
+        ASSERT(loaded.IsDynamicPruningEnabled());
+        ASSERT_EQUAL(loaded.GetDocumentCount(), search_server.GetDocumentCount());
+        ASSERT_EQUAL(loaded.GetWordCount(), search_server.GetWordCount());
+        for (const int document_id : search_server) {
+            ASSERT(loaded.GetWordFrequencies(document_id) == search_server.GetWordFrequencies(document_id));
+        }
+        for (const string& query : {"common word3"s, "word1 -word2"s, "fresh"s, "word1*"s}) {
+            for (const DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::REMOVED}) {
+                ASSERT(FindRelevances(loaded, query, status) == FindRelevances(search_server, query, status));
+            }
+        }
+    }
+}
+
+// Записывает файл индекса с заданными документами и одним словом со списком вхождений (все TF равны 0.5)
+void WriteCraftedIndex(const string& path, const vector<int>& document_ids, const vector<int>& ordinals,
+                       double max_term_freq = 0.5) {
+    BinaryWriter writer;
+    writer.Write(static_cast<uint64_t>(MAX_RESULT_DOCUMENT_COUNT));
+    writer.Write(static_cast<int32_t>(QueryMode::ANY_WORD));
+    writer.Write(static_cast<int32_t>(PostingFormat::PLAIN));
+    writer.Write(static_cast<int32_t>(0));
+    writer.Write(static_cast<uint64_t>(0));
+    writer.Write(static_cast<uint64_t>(document_ids.size()));
+    for (const int document_id : document_ids) {
+        writer.Write(static_cast<int32_t>(document_id));
+        writer.Write(static_cast<int32_t>(0));
+        writer.Write(static_cast<int32_t>(DocumentStatus::ACTUAL));
+    }
+    writer.Write(static_cast<uint64_t>(1));
+    writer.WriteString("cat"sv);
+    writer.Write(static_cast<uint64_t>(ordinals.size()));
+    writer.Write(max_term_freq);
+    writer.Align();
+    writer.WriteArray(ordinals);
+    writer.Align();
+    writer.WriteArray(vector<double>(ordinals.size(), 0.5));
+    WriteIndexFile(path, writer.GetBuffer());
+}
+
+// Некорректные id и номера, испорченные и обрезанные файлы отвергаются
+void TestInvalidFiles() {
+    const TempFile file("invalid"s);
+    WriteCraftedIndex(file.GetPath(), {1, 5, 9}, {0, 2});
+    ASSERT_EQUAL(SearchServer::OpenIndex(file.GetPath()).FindTopDocuments("cat"s).size(), 2u);
+
+    WriteCraftedIndex(file.GetPath(), {-1, 5, 9}, {0, 2});
+    ASSERT_THROWS(SearchServer::OpenIndex(file.GetPath()), runtime_error);
+    WriteCraftedIndex(file.GetPath(), {1, 9, 5}, {0, 2});
+    ASSERT_THROWS(SearchServer::OpenIndex(file.GetPath()), runtime_error);
+    WriteCraftedIndex(file.GetPath(), {1, 5, 5}, {0, 2});
+    ASSERT_THROWS(SearchServer::OpenIndex(file.GetPath()), runtime_error);
+    WriteCraftedIndex(file.GetPath(), {1, 5, 9}, {2, 0});
+    ASSERT_THROWS(SearchServer::OpenIndex(file.GetPath()), runtime_error);
+    WriteCraftedIndex(file.GetPath(), {1, 5, 9}, {1, 1});
+    ASSERT_THROWS(SearchServer::OpenIndex(file.GetPath()), runtime_error);
+    WriteCraftedIndex(file.GetPath(), {1, 5, 9}, {0, 3});
+    ASSERT_THROWS(SearchServer::OpenIndex(file.GetPath()), runtime_error);
+    WriteCraftedIndex(file.GetPath(), {1, 5, 9}, {-1, 2});
+    ASSERT_THROWS(SearchServer::OpenIndex(file.GetPath()), runtime_error);
+    WriteCraftedIndex(file.GetPath(), {1, 5, 9}, {0, 2}, 0.25);
+    ASSERT_THROWS(SearchServer::OpenIndex(file.GetPath()), runtime_error);
+    WriteCraftedIndex(file.GetPath(), {1, 5, 9}, {0, 2}, -1.0);
+    ASSERT_THROWS(SearchServer::OpenIndex(file.GetPath(), IndexVerification::TRUSTED), runtime_error);
+
+    const string payload = "payload"s;
+    WriteIndexFile(file.GetPath(), payload);
+    const MappedFile mapped(file.GetPath());
+    ASSERT_EQUAL(CheckIndexFile(mapped.GetData()), payload);
+    string data(mapped.GetData());
+    data.back() ^= 1;
+    ASSERT_THROWS(CheckIndexFile(data), runtime_error);
+    ASSERT_EQUAL(CheckIndexFile(data, false).size(), payload.size());
+    ASSERT_THROWS(CheckIndexFile(mapped.GetData().substr(0, mapped.GetData().size() - 1)), runtime_error);
+    ASSERT_THROWS(CheckIndexFile(mapped.GetData().substr(0, 4)), runtime_error);
+    ASSERT_THROWS(SearchServer::OpenIndex("search_server_test_missing.idx"s), runtime_error);
+}
+
+// Загруженный индекс читает списки вхождений из файла, копирует список при изменении и строит прямой индекс
+// при обращении; без проверки контрольная сумма не читается
+void TestMappedIndex() {
+    for (const IndexVerification verification : {IndexVerification::FULL, IndexVerification::TRUSTED}) {
+        SearchServer search_server = MakeShuffledServer();
+        search_server.SetMaxResultDocumentCount(1000);
+        const TempFile file("mapped"s);
+        search_server.SaveIndex(file.GetPath());
+        SearchServer loaded = SearchServer::OpenIndex(file.GetPath(), verification);
+        ASSERT_EQUAL(loaded.GetPostingMemoryUsage(), 0u);
+        for (const string& query : {"common word3"s, "word1 -word2"s, "word1*"s}) {
+            ASSERT(FindRelevances(loaded, query, DocumentStatus::ACTUAL)
+                   == FindRelevances(search_server, query, DocumentStatus::ACTUAL));
+        }
+
+        // Копия держит отображение и после удаления исходного сервера
+        SearchServer copy = [&file, verification] {
+            const SearchServer opened = SearchServer::OpenIndex(file.GetPath(), verification);
+            return SearchServer(opened);
+        }();
+        ASSERT(FindRelevances(copy, "word1 -word2"s, DocumentStatus::ACTUAL)
+               == FindRelevances(search_server, "word1 -word2"s, DocumentStatus::ACTUAL));
+
+        // Прямой индекс строится по спискам вхождений при первом обращении
+        const int document_id = *search_server.begin();
+        ASSERT(loaded.GetWordFrequencies(document_id) == search_server.GetWordFrequencies(document_id));
+        const auto [matched_words, status] = loaded.MatchDocument("common -missing"s, document_id);
+        ASSERT_EQUAL(matched_words.size(), 1u);
+        ASSERT(status == get<1>(search_server.MatchDocument("common"s, document_id)));
+
+        // Изменения копируют только затронутые списки
+        loaded.RemoveDocument(document_id);
+        search_server.RemoveDocument(document_id);
+        loaded.AddDocument(3000, "word1 brand new"s, DocumentStatus::ACTUAL, {4});
+        search_server.AddDocument(3000, "word1 brand new"s, DocumentStatus::ACTUAL, {4});
+        ASSERT(loaded.GetPostingMemoryUsage() > 0);
+        ASSERT(loaded.GetPostingMemoryUsage() < search_server.GetPostingMemoryUsage());
+        for (const string& query : {"common word3"s, "word1 -word2"s, "brand"s}) {
+            ASSERT(FindRelevances(loaded, query, DocumentStatus::ACTUAL)
+                   == FindRelevances(search_server, query, DocumentStatus::ACTUAL));
+        }
+        for (const int id : search_server) {
+            ASSERT(loaded.GetWordFrequencies(id) == search_server.GetWordFrequencies(id));
+        }
+        loaded.Freeze();
+        ASSERT(FindRelevances(loaded, "brand word1"s, DocumentStatus::ACTUAL)
+               == FindRelevances(search_server, "brand word1"s, DocumentStatus::ACTUAL));
+
+        // Испорченный TF: с проверкой файл отвергается, без нее загружается
+        {
+            fstream stream(file.GetPath(), ios::in | ios::out | ios::binary);
+            stream.seekp(-1, ios::end);
+            stream.put('\x7f');
+        }
+        if (verification == IndexVerification::FULL) {
+            ASSERT_THROWS(SearchServer::OpenIndex(file.GetPath(), verification), runtime_error);
+        }
+        else {
+            ASSERT_EQUAL(SearchServer::OpenIndex(file.GetPath(), verification).GetDocumentCount(),
+                         MakeShuffledServer().GetDocumentCount());
+        }
+    }
+}
+
+// Прямой индекс строится один раз, даже если к нему обращаются из нескольких потоков сразу
+void TestConcurrentForwardIndexBuild() {
+    const SearchServer search_server = MakeShuffledServer();
+    const TempFile file("forward_index"s);
+    search_server.SaveIndex(file.GetPath());
+    const SearchServer loaded = SearchServer::OpenIndex(file.GetPath(), IndexVerification::TRUSTED);
+    vector<int> document_ids(search_server.begin(), search_server.end());
+    vector<size_t> matched_counts(8);
+    vector<thread> threads;
+    for (size_t thread_index = 0; thread_index < matched_counts.size(); ++thread_index) {
+        threads.emplace_back([&, thread_index] {
+            for (size_t i = thread_index; i < document_ids.size(); i += matched_counts.size()) {
+                matched_counts[thread_index] += get<0>(loaded.MatchDocument("common word1"s, document_ids[i])).size();
+            }
+        });
+    }
+    size_t matched_count = 0;
+    for (size_t thread_index = 0; thread_index < threads.size(); ++thread_index) {
+        threads[thread_index].join();
+        matched_count += matched_counts[thread_index];
+    }
+    size_t expected_count = 0;
+    for (const int document_id : document_ids) {
+        expected_count += get<0>(search_server.MatchDocument("common word1"s, document_id)).size();
+    }
+    ASSERT_EQUAL(matched_count, expected_count);
+}
+
+// Запись идет во временный файл и заменяет прежний только при Commit; отображенный прежний файл не портится
+void TestAtomicWrite() {
+    const TempFile file("atomic"s);
+    const string temp_path = file.GetPath() + ".tmp"s;
+    const string old_payload = "old payload"s;
+    WriteIndexFile(file.GetPath(), old_payload);
+    const MappedFile old_file(file.GetPath());
+
+    // Данные больше буфера записи, частями разного размера
+    string new_payload;
+    {
+        IndexFileWriter writer(file.GetPath());
+        for (int i = 0; i < 3000; ++i) {
+            const string part(static_cast<size_t>(i % 7 == 0 ? 5000 : i % 13), static_cast<char>('a' + i % 26));
+            writer.WriteBytes(part);
+            new_payload += part;
+        }
+        const vector<double> large_array((1 << 20) / sizeof(double) + 3, 0.25);
+        writer.WriteArray(large_array);
+        new_payload.append(reinterpret_cast<const char*>(large_array.data()), large_array.size() * sizeof(double));
+        // До Commit на месте прежний файл
+        ASSERT_EQUAL(CheckIndexFile(MappedFile(file.GetPath()).GetData()), old_payload);
+        writer.Commit();
+    }
+    ASSERT(CheckIndexFile(MappedFile(file.GetPath()).GetData()) == new_payload);
+    ASSERT_EQUAL(CheckIndexFile(old_file.GetData()), old_payload);
+    ASSERT(fopen(temp_path.c_str(), "rb") == nullptr);
+
+    // Без Commit файл не меняется, временный удаляется
+    {
+        IndexFileWriter writer(file.GetPath());
+        writer.WriteBytes("abandoned"sv);
+    }
+    ASSERT(CheckIndexFile(MappedFile(file.GetPath()).GetData()) == new_payload);
+    ASSERT(fopen(temp_path.c_str(), "rb") == nullptr);
+
+    // SaveIndex поверх файла, с которого открыт сервер
+    SearchServer search_server = MakeShuffledServer();
+    search_server.SetMaxResultDocumentCount(1000);
+    search_server.SaveIndex(file.GetPath());
+    const SearchServer loaded = SearchServer::OpenIndex(file.GetPath());
+    const RelevanceById expected = FindRelevances(search_server, "word1 -word2"s, DocumentStatus::ACTUAL);
+    search_server.AddDocument(2000, "newcomer"s, DocumentStatus::ACTUAL, {1});
+    search_server.SaveIndex(file.GetPath());
+    ASSERT_EQUAL(loaded.GetDocumentCount() + 1, search_server.GetDocumentCount());
+    ASSERT(FindRelevances(loaded, "word1 -word2"s, DocumentStatus::ACTUAL) == expected);
+    ASSERT_EQUAL(SearchServer::OpenIndex(file.GetPath()).FindTopDocuments("newcomer"s).size(), 1u);
+
+    ASSERT_THROWS(search_server.SaveIndex("search_server_missing_directory/index.idx"s), runtime_error);
+}
+
+}  // namespace
+
+void TestIndexFile(TestRunner& runner) {
+    RUN_TEST(runner, TestRoundTrip);
+    RUN_TEST(runner, TestInvalidFiles);
+    RUN_TEST(runner, TestMappedIndex);
+    RUN_TEST(runner, TestConcurrentForwardIndexBuild);
+    RUN_TEST(runner, TestAtomicWrite);
+}
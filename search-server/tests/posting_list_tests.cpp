@@ -0,0 +1,136 @@
+#include <limits>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "posting_list.h"
+#include "search_server.h"
+#include "test_suites.h"
+
+using namespace std;
+
+namespace {
+
+using PostingPairs = vector<pair<int, double>>;
+
+// Содержимое списка через Cursor: пары (id, TF)
+PostingPairs ReadPostings(const PostingList& postings) {
+    PostingPairs result;
+    for (PostingList::Cursor cursor(postings); !cursor.AtEnd(); cursor.Next()) {
+        result.emplace_back(cursor.GetDocumentId(), cursor.GetTermFreq());
+    }
+    return result;
+}
+
+void CheckPostings(const PostingList& postings, const map<int, double>& expected) {
+    ASSERT_EQUAL(ReadPostings(postings), PostingPairs(expected.begin(), expected.end()));
+    ASSERT_EQUAL(postings.size(), expected.size());
+    // Advance к каждому id и к промежуткам между ними
+    PostingList::Cursor cursor(postings);
+    for (const auto& [document_id, term_freq] : expected) {
+        cursor.Advance(document_id - 1);
+        ASSERT(!cursor.AtEnd());
+        cursor.Advance(document_id);
+        ASSERT_EQUAL(cursor.GetDocumentId(), document_id);
+        ASSERT_EQUAL(cursor.GetTermFreq(), term_freq);
+    }
+    cursor.Advance(numeric_limits<int>::max());
+    ASSERT(cursor.AtEnd());
+}
+
+// Вставки в середину, удаления и дописывание в сжатый список не распаковывают его, содержимое совпадает с эталоном
+void TestCompressedEdits() {
+    mt19937 generator(42);
+    PostingList postings;
+    map<int, double> expected;
+    for (int document_id = 0; document_id < 3000; document_id += 3) {
+        const double term_freq = static_cast<float>(1.0 / (1 + document_id % 17));
+        postings.Add(document_id, term_freq);
+        expected[document_id] = term_freq;
+    }
+    postings.Compress();
+    for (int step = 0; step < 4000; ++step) {
+        const int document_id = uniform_int_distribution(0, 4000)(generator);
+        if (step % 3 == 0) {
+            ASSERT_EQUAL(postings.Remove(document_id), expected.erase(document_id) != 0);
+        }
+        else {
+            const double term_freq = static_cast<float>(1.0 / (1 + step % 13));
+            postings.Add(document_id, term_freq);
+            expected[document_id] = static_cast<float>(expected[document_id] + term_freq);
+        }
+        ASSERT(postings.IsCompressed());
+        if (step % 500 == 0) {
+            CheckPostings(postings, expected);
+        }
+    }
+    CheckPostings(postings, expected);
+    for (const auto& [document_id, _] : expected) {
+        ASSERT(postings.Contains(document_id));
+    }
+
+    // Удаление всего списка и повторное заполнение
+    for (const auto& [document_id, _] : expected) {
+        ASSERT(postings.Remove(document_id));
+    }
+    ASSERT(postings.empty());
+    ASSERT(postings.IsCompressed());
+    postings.Add(7, 0.5);
+    ASSERT_EQUAL(ReadPostings(postings), PostingPairs({{7, 0.5}}));
+}
+
+// TF округляется один раз: распаковка и повторное сжатие значения не меняют
+void TestTermFreqRoundTrip() {
+    PostingList postings;
+    for (int document_id = 0; document_id < 1000; ++document_id) {
+        postings.Add(document_id, 1.0 / (3 + document_id));
+    }
+    postings.Compress();
+    const auto compressed = ReadPostings(postings);
+    for (int round = 0; round < 3; ++round) {
+        postings.Decompress();
+        ASSERT_EQUAL(ReadPostings(postings), compressed);
+        postings.Compress();
+        ASSERT_EQUAL(ReadPostings(postings), compressed);
+    }
+}
+
+// Релевантность в сжатом формате не дрейфует от перекодирований и правок
+void TestCompressedServerRelevance() {
+    SearchServer search_server;
+    for (int id = 0; id < 600; ++id) {
+        search_server.AddDocument(id, "cat dog"s + (id % 3 == 0 ? " bird"s : ""s) + (id % 7 == 0 ? " cat"s : ""s),
+                                  DocumentStatus::ACTUAL, {id % 5});
+    }
+    search_server.SetMaxResultDocumentCount(1000);
+    search_server.SetPostingFormat(PostingFormat::COMPRESSED);
+    // При равной релевантности порядок не определен, поэтому сравниваются релевантности по id
+    const auto find_relevances = [&search_server] {
+        map<int, double> relevances;
+        for (const Document& document : search_server.FindTopDocuments("cat bird"s)) {
+            relevances[document.id] = document.relevance;
+        }
+        return relevances;
+    };
+    const auto reference = find_relevances();
+    ASSERT_EQUAL(reference.size(), 600u);
+    for (int round = 0; round < 3; ++round) {
+        search_server.SetPostingFormat(PostingFormat::PLAIN);
+        search_server.SetPostingFormat(PostingFormat::COMPRESSED);
+        search_server.AddDocument(1000, "cat fish"s, DocumentStatus::ACTUAL, {});
+        search_server.RemoveDocument(1000);
+        search_server.Freeze();
+        ASSERT(find_relevances() == reference);
+    }
+    // Прямой индекс хранит те же округленные TF, что и списки
+    const auto& word_freqs = search_server.GetWordFrequencies(7);
+    ASSERT_EQUAL(word_freqs.at("cat"sv), static_cast<double>(static_cast<float>(2.0 / 3.0)));
+}
+
+}  // namespace
+
+void TestPostingList(TestRunner& runner) {
+    RUN_TEST(runner, TestCompressedEdits);
+    RUN_TEST(runner, TestTermFreqRoundTrip);
+    RUN_TEST(runner, TestCompressedServerRelevance);
+}
@@ -0,0 +1,66 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "process_queries.h"
+#include "test_suites.h"
+
+using namespace std;
+
+namespace {
+
+vector<int> GetIds(const vector<Document>& documents) {
+    vector<int> ids;
+    for (const Document& document : documents) {
+        ids.push_back(document.id);
+    }
+    return ids;
+}
+
+SearchServer MakeServer() {
+    SearchServer search_server("and with"s);
+    int id = 0;
+    for (const string& text : {"funny pet and nasty rat"s, "funny pet with curly hair"s, "funny pet and not very nasty rat"s,
+                               "pet with rat and rat and rat"s, "nasty rat with curly hair"s}) {
+        search_server.AddDocument(++id, text, DocumentStatus::ACTUAL, {1, 2});
+    }
+    return search_server;
+}
+
+// Результаты идут в порядке запросов и совпадают с отдельными FindTopDocuments
+void TestProcessQueriesOrder() {
+    const SearchServer search_server = MakeServer();
+    const vector<string> queries = {"nasty rat -not"s, "not very funny nasty pet"s, "curly hair"s, "missing"s};
+    const auto results = ProcessQueries(search_server, queries);
+    ASSERT_EQUAL(results.size(), queries.size());
+    size_t document_count = 0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        ASSERT_EQUAL(GetIds(results[i]), GetIds(search_server.FindTopDocuments(queries[i])));
+        document_count += results[i].size();
+    }
+    const JoinedDocuments joined = ProcessQueriesJoined(search_server, queries);
+    ASSERT_EQUAL(joined.size(), document_count);
+    ASSERT_EQUAL(static_cast<size_t>(distance(joined.begin(), joined.end())), document_count);
+}
+
+// Некорректный запрос не завершает программу внутри параллельного шага: бросается исключение первого из них
+void TestProcessQueriesInvalidQuery() {
+    const SearchServer search_server = MakeServer();
+    vector<string> queries(64, "funny pet"s);
+    queries[40] = "--rat"s;
+    queries[50] = "rat\x03"s;
+    try {
+        ProcessQueries(search_server, queries);
+        ASSERT_HINT(false, "invalid query must throw"s);
+    }
+    catch (const invalid_argument& e) {
+        ASSERT_EQUAL(string(e.what()), "invalid query (double minus)"s);
+    }
+    ASSERT_THROWS(ProcessQueriesJoined(search_server, queries), invalid_argument);
+}
+
+}  // namespace
+
+void TestProcessQueries(TestRunner& runner) {
+    RUN_TEST(runner, TestProcessQueriesOrder);
+    RUN_TEST(runner, TestProcessQueriesInvalidQuery);
+}
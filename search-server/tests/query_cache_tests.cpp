@@ -0,0 +1,127 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "query_cache.h"
+#include "search_server.h"
+#include "test_suites.h"
+
+using namespace std;
+
+namespace {
+
+SearchServer MakeServer() {
+    SearchServer search_server("and in at"s);
+    search_server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    search_server.AddDocument(3, "big cat fancy collar"s, DocumentStatus::ACTUAL, {1, 2, 8});
+    search_server.AddDocument(4, "big dog sparrow"s, DocumentStatus::BANNED, {1, 3, 2});
+    return search_server;
+}
+
+vector<int> GetIds(const vector<Document>& documents) {
+    vector<int> ids;
+    for (const Document& document : documents) {
+        ids.push_back(document.id);
+    }
+    return ids;
+}
+
+// Повтор запроса - попадание с тем же результатом, что у сервера
+void TestHitsAndMisses() {
+    const SearchServer search_server = MakeServer();
+    QueryCache cache(search_server, 8, 1);
+    const vector<int> expected = GetIds(search_server.FindTopDocuments("curly cat"s));
+    ASSERT_EQUAL(GetIds(cache.FindTopDocuments("curly cat"s)), expected);
+    ASSERT_EQUAL(cache.GetHits(), 0u);
+    ASSERT_EQUAL(cache.GetMisses(), 1u);
+    ASSERT_EQUAL(GetIds(cache.FindTopDocuments("curly cat"s)), expected);
+    ASSERT_EQUAL(cache.GetHits(), 1u);
+    ASSERT_EQUAL(cache.GetMisses(), 1u);
+    cache.Clear();
+    cache.FindTopDocuments("curly cat"s);
+    ASSERT_EQUAL(cache.GetMisses(), 2u);
+}
+
+// Порядок слов, повторы и стоп-слова не меняют запись; другие минус-слова - другая запись
+void TestCanonicalQueriesShareEntry() {
+    const SearchServer search_server = MakeServer();
+    QueryCache cache(search_server, 8, 1);
+    const vector<int> expected = GetIds(search_server.FindTopDocuments("cat collar -tail"s));
+    for (const string& query : {"cat collar -tail"s, "collar cat -tail"s, "cat cat collar -tail -tail"s,
+                                "cat and collar in -tail"s}) {
+        ASSERT_EQUAL_HINT(GetIds(cache.FindTopDocuments(query)), expected, query);
+    }
+    ASSERT_EQUAL(cache.GetMisses(), 1u);
+    ASSERT_EQUAL(cache.GetHits(), 3u);
+    ASSERT_EQUAL(GetIds(cache.FindTopDocuments("cat collar"s)), GetIds(search_server.FindTopDocuments("cat collar"s)));
+    ASSERT_EQUAL(GetIds(cache.FindTopDocuments("cat -collar"s)), GetIds(search_server.FindTopDocuments("cat -collar"s)));
+    ASSERT_EQUAL(cache.GetMisses(), 3u);
+}
+
+// Фильтр по статусу и предикат с меткой того же вида не делят запись
+void TestFiltersDoNotCollide() {
+    const SearchServer search_server = MakeServer();
+    QueryCache cache(search_server, 8, 1);
+    const auto all_documents = [](int, DocumentStatus, int) {
+        return true;
+    };
+    ASSERT_EQUAL(GetIds(cache.FindTopDocuments("big dog"s, DocumentStatus::BANNED)), vector<int>({4}));
+    ASSERT_EQUAL(GetIds(cache.FindTopDocuments("big dog"s, "status:2"s, all_documents)),
+                 GetIds(search_server.FindTopDocuments("big dog"s, all_documents)));
+    ASSERT_EQUAL(GetIds(cache.FindTopDocuments("big dog"s, "status\0" "2"s, all_documents)),
+                 GetIds(search_server.FindTopDocuments("big dog"s, all_documents)));
+    ASSERT_EQUAL(GetIds(cache.FindTopDocuments("big dog"s)), GetIds(search_server.FindTopDocuments("big dog"s)));
+    ASSERT_EQUAL(cache.GetMisses(), 4u);
+    ASSERT_EQUAL(GetIds(cache.FindTopDocuments("big dog"s, DocumentStatus::BANNED)), vector<int>({4}));
+    ASSERT_EQUAL(cache.GetHits(), 1u);
+}
+
+// Каждое изменение индекса и числа результатов делает записи устаревшими: кеш отдает новую выдачу
+void TestInvalidation() {
+    SearchServer search_server = MakeServer();
+    QueryCache cache(search_server, 8, 1);
+    ASSERT_EQUAL(GetIds(cache.FindTopDocuments("cat"s)), GetIds(search_server.FindTopDocuments("cat"s)));
+
+    search_server.AddDocument(5, "cat cat"s, DocumentStatus::ACTUAL, {9});
+    ASSERT_EQUAL(GetIds(cache.FindTopDocuments("cat"s)), GetIds(search_server.FindTopDocuments("cat"s)));
+    ASSERT_EQUAL(GetIds(cache.FindTopDocuments("cat"s)).front(), 5);
+
+    search_server.RemoveDocument(5);
+    ASSERT_EQUAL(GetIds(cache.FindTopDocuments("cat"s)), GetIds(search_server.FindTopDocuments("cat"s)));
+    ASSERT_EQUAL(cache.FindTopDocuments("cat"s).size(), 2u);
+
+    search_server.SetMaxResultDocumentCount(1);
+    ASSERT_EQUAL(cache.FindTopDocuments("cat"s).size(), 1u);
+    ASSERT_EQUAL(cache.GetMisses(), 4u);
+    ASSERT_EQUAL(cache.GetHits(), 2u);
+}
+
+// При заполненном шарде вытесняется давно не использованная запись
+void TestLruEviction() {
+    const SearchServer search_server = MakeServer();
+    QueryCache cache(search_server, 2, 1);
+    cache.FindTopDocuments("cat"s);
+    cache.FindTopDocuments("dog"s);
+    cache.FindTopDocuments("cat"s);  // cat становится недавней
+    cache.FindTopDocuments("collar"s);  // вытесняет dog
+    ASSERT_EQUAL(cache.GetMisses(), 3u);
+    ASSERT_EQUAL(cache.GetHits(), 1u);
+    cache.FindTopDocuments("cat"s);
+    cache.FindTopDocuments("collar"s);
+    ASSERT_EQUAL(cache.GetHits(), 3u);
+    cache.FindTopDocuments("dog"s);
+    ASSERT_EQUAL(cache.GetMisses(), 4u);
+
+    ASSERT_THROWS(QueryCache(search_server, 0), invalid_argument);
+    ASSERT_THROWS(QueryCache(search_server, 2, 0), invalid_argument);
+}
+
+}  // namespace
+
+void TestQueryCache(TestRunner& runner) {
+    RUN_TEST(runner, TestHitsAndMisses);
+    RUN_TEST(runner, TestCanonicalQueriesShareEntry);
+    RUN_TEST(runner, TestFiltersDoNotCollide);
+    RUN_TEST(runner, TestInvalidation);
+    RUN_TEST(runner, TestLruEviction);
+}
@@ -0,0 +1,98 @@
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "read_input_functions.h"
+#include "search_server.h"
+#include "test_suites.h"
+
+using namespace std;
+
+namespace {
+
+// Выдача и частоты слов совпадают у двух серверов
+void AssertSameIndex(const SearchServer& loaded, const SearchServer& expected) {
+    ASSERT_EQUAL(loaded.GetDocumentCount(), expected.GetDocumentCount());
+    for (const int document_id : expected) {
+        ASSERT_HINT(loaded.HasDocument(document_id), to_string(document_id));
+        ASSERT(loaded.GetWordFrequencies(document_id) == expected.GetWordFrequencies(document_id));
+    }
+    const auto any_status = [](int, DocumentStatus, int) {
+        return true;
+    };
+    for (const string& query : {"cat"s, "dog collar"s, "curly fancy big"s}) {
+        const vector<Document> documents = loaded.FindTopDocuments(query, any_status);
+        const vector<Document> expected_documents = expected.FindTopDocuments(query, any_status);
+        ASSERT_EQUAL_HINT(documents.size(), expected_documents.size(), query);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            ASSERT_EQUAL_HINT(documents[i].id, expected_documents[i].id, query);
+            ASSERT_EQUAL_HINT(documents[i].rating, expected_documents[i].rating, query);
+            ASSERT_HINT(abs(documents[i].relevance - expected_documents[i].relevance) < EPSILON, query);
+        }
+    }
+}
+
+// Окончания CRLF, пустые строки и несколько кусков дают тот же индекс, что AddDocument
+void TestLoadDocuments() {
+    const string input_text = "1\t0\t1 2 3\tcurly cat\r\n"s
+                              "\r\n"s
+                              "2\t1\t\tbig dog\r\n"s
+                              "\n"s
+                              "3\t0\t-5 5\tcat dog\r\n"s
+                              "4\t2\t7\tfancy collar"s;
+    SearchServer loaded;
+    istringstream input(input_text);
+    const LoadStats stats = LoadDocuments(loaded, input, 2);
+    ASSERT_EQUAL(stats.documents, 4u);
+    ASSERT_EQUAL(stats.bytes, input_text.size() + 1);  // у последней строки нет перевода строки
+
+    SearchServer expected;
+    expected.AddDocument(1, "curly cat"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    expected.AddDocument(2, "big dog"s, DocumentStatus::IRRELEVANT, {});
+    expected.AddDocument(3, "cat dog"s, DocumentStatus::ACTUAL, {-5, 5});
+    expected.AddDocument(4, "fancy collar"s, DocumentStatus::BANNED, {7});
+    AssertSameIndex(loaded, expected);
+
+    istringstream empty_input(""s);
+    ASSERT_EQUAL(LoadDocuments(loaded, empty_input, 2).documents, 0u);
+    ASSERT_THROWS(LoadDocuments(loaded, empty_input, 0), invalid_argument);
+}
+
+// Ошибка в строке 4 (второй кусок из строк 3 и 4) называет эту строку; первый кусок уже внесен,
+// строка 3 из того же куска - нет
+void TestLoadDocumentsErrors() {
+    const string good_lines = "1\t0\t1\tcurly cat\r\n"s
+                              "2\t0\t2\tbig dog\r\n"s
+                              "3\t0\t3\tfancy collar\r\n"s;
+    for (const auto& [bad_line, message] : vector<pair<string, string>>{
+             {"x4\t0\t1\tcat"s, "line 4: invalid document id"s},
+             {"99999999999\t0\t1\tcat"s, "line 4: invalid document id"s},
+             {"4\t9\t1\tcat"s, "line 4: invalid document status"s},
+             {"4\t-1\t1\tcat"s, "line 4: invalid document status"s},
+             {"4\t\t1\tcat"s, "line 4: invalid document status"s},
+             {"4\t0\t2 a\tcat"s, "line 4: invalid rating"s},
+             {"4\t0\t1.5\tcat"s, "line 4: invalid rating"s}}) {
+        SearchServer search_server;
+        istringstream input(good_lines + bad_line + "\r\n5\t0\t5\tcat\r\n"s);
+        string error;
+        try {
+            LoadDocuments(search_server, input, 2);
+        }
+        catch (const invalid_argument& e) {
+            error = e.what();
+        }
+        ASSERT_EQUAL_HINT(error, message, bad_line);
+        ASSERT_EQUAL_HINT(search_server.GetDocumentCount(), 2, bad_line);
+        ASSERT_HINT(search_server.HasDocument(1) && search_server.HasDocument(2), bad_line);
+        ASSERT_HINT(!search_server.HasDocument(3), bad_line);
+    }
+}
+
+}  // namespace
+
+void TestReadInput(TestRunner& runner) {
+    RUN_TEST(runner, TestLoadDocuments);
+    RUN_TEST(runner, TestLoadDocumentsErrors);
+}
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "request_queue.h"
+#include "search_server.h"
+#include "test_suites.h"
+
+using namespace std;
+
+namespace {
+
+const int WINDOW_SIZE = 1440;
+
+SearchServer MakeServer() {
+    SearchServer search_server;
+    search_server.AddDocument(1, "curly cat"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "big dog"s, DocumentStatus::ACTUAL, {2});
+    return search_server;
+}
+
+// Счетчик запросов без результата следует за окном, в том числе после вытеснения по кругу
+void TestNoResultWindow() {
+    const SearchServer search_server = MakeServer();
+    RequestQueue request_queue(search_server);
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 0);
+    ASSERT_EQUAL(request_queue.GetNoResultRate(), 0.0);
+
+    deque<bool> window;  // true - запрос без результата
+    mt19937 generator(7);
+    for (int request = 0; request < 3 * WINDOW_SIZE + 100; ++request) {
+        // Серии пустых и непустых ответов разной длины, чтобы вытеснялись оба вида
+        const bool is_empty = (request / 100) % 3 == 0 || uniform_int_distribution(0, 4)(generator) == 0;
+        request_queue.AddFindRequest(is_empty ? "sparrow"s : "cat"s);
+        window.push_back(is_empty);
+        if (window.size() > static_cast<size_t>(WINDOW_SIZE)) {
+            window.pop_front();
+        }
+        if (request % 97 == 0 || request == WINDOW_SIZE - 1 || request == WINDOW_SIZE) {
+            const int expected = static_cast<int>(count(window.begin(), window.end(), true));
+            ASSERT_EQUAL_HINT(request_queue.GetNoResultRequests(), expected, to_string(request));
+            ASSERT_HINT(abs(request_queue.GetNoResultRate() - expected * 1.0 / window.size()) < 1e-12, to_string(request));
+        }
+    }
+}
+
+// Процентили задержек не меньше точных и больше них не более чем на 25%
+void TestLatencyPercentiles() {
+    const SearchServer search_server = MakeServer();
+    RequestQueue request_queue(search_server);
+    ASSERT_EQUAL(request_queue.GetLatencyPercentile(0.5).count(), 0);
+
+    mt19937 generator(11);
+    deque<int64_t> window;
+    const auto now = RequestQueue::Clock::now();
+    for (int request = 0; request < 2 * WINDOW_SIZE + 300; ++request) {
+        // Задержки от наносекунды до десятков миллисекунд, равномерно по порядку величины
+        const auto latency = static_cast<int64_t>(exp(uniform_real_distribution(0.0, 17.0)(generator)));
+        request_queue.AddRequestRecord("q"s, 1, chrono::nanoseconds(latency), now);
+        window.push_back(latency);
+        if (window.size() > static_cast<size_t>(WINDOW_SIZE)) {
+            window.pop_front();
+        }
+    }
+    vector<int64_t> sorted(window.begin(), window.end());
+    sort(sorted.begin(), sorted.end());
+    for (const double percentile : {0.0, 0.01, 0.5, 0.9, 0.99, 1.0}) {
+        const size_t rank = max<size_t>(1, static_cast<size_t>(ceil(percentile * sorted.size())));
+        const int64_t expected = max<int64_t>(sorted[rank - 1], 1);
+        const int64_t estimate = request_queue.GetLatencyPercentile(percentile).count();
+        ASSERT_HINT(estimate >= expected, to_string(percentile));
+        ASSERT_HINT(estimate <= expected * 5 / 4, to_string(percentile));
+    }
+}
+
+// Запросы в секунду по самому старому и самому новому запросу окна
+void TestQueriesPerSecond() {
+    const SearchServer search_server = MakeServer();
+    RequestQueue request_queue(search_server);
+    const auto start = RequestQueue::Clock::now();
+    request_queue.AddRequestRecord("q"s, 1, 1ms, start);
+    ASSERT_EQUAL(request_queue.GetQueriesPerSecond(), 0.0);
+    for (int request = 1; request < WINDOW_SIZE + 500; ++request) {
+        request_queue.AddRequestRecord("q"s, 1, 1ms, start + request * 10ms);
+        if (request == 100 || request >= WINDOW_SIZE) {
+            ASSERT_HINT(abs(request_queue.GetQueriesPerSecond() - 100.0) < 1e-6, to_string(request));
+        }
+    }
+}
+
+// Запись из многих потоков без блокировок: после всех записей счетчики соответствуют окну
+void TestConcurrentRequests() {
+    const SearchServer search_server = MakeServer();
+    RequestQueue request_queue(search_server);
+    for (const bool is_empty : {true, false, true}) {
+        atomic_int failure_count = 0;
+        vector<thread> threads;
+        for (int thread_index = 0; thread_index < 4; ++thread_index) {
+            threads.emplace_back([&request_queue, &failure_count, is_empty] {
+                for (int request = 0; request < WINDOW_SIZE / 2; ++request) {
+                    request_queue.AddFindRequest(is_empty ? "sparrow"s : "dog"s);
+                    const double rate = request_queue.GetNoResultRate();
+                    if (rate < 0.0 || rate > 1.0 || request_queue.GetLatencyPercentile(0.99).count() < 0) {
+                        ++failure_count;
+                    }
+                }
+            });
+        }
+        for (thread& thread : threads) {
+            thread.join();
+        }
+        ASSERT_EQUAL(failure_count.load(), 0);
+        // Все запросы окна одного вида: окно целиком вытеснено запросами этого круга
+        ASSERT_EQUAL(request_queue.GetNoResultRequests(), is_empty ? WINDOW_SIZE : 0);
+        ASSERT_EQUAL(request_queue.GetNoResultRate(), is_empty ? 1.0 : 0.0);
+        ASSERT(request_queue.GetLatencyPercentile(1.0).count() > 0);
+        ASSERT(request_queue.GetQueriesPerSecond() > 0.0);
+    }
+}
+
+}  // namespace
+
+void TestRequestQueue(TestRunner& runner) {
+    RUN_TEST(runner, TestNoResultWindow);
+    RUN_TEST(runner, TestLatencyPercentiles);
+    RUN_TEST(runner, TestQueriesPerSecond);
+    RUN_TEST(runner, TestConcurrentRequests);
+}
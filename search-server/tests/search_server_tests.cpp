@@ -0,0 +1,555 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <execution>
+#include <forward_list>
+#include <list>
+#include <random>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "paginator.h"
+#include "search_server.h"
+#include "test_suites.h"
+
+using namespace std;
+
+namespace {
+
+vector<int> GetIds(const vector<Document>& documents) {
+    vector<int> ids;
+    for (const Document& document : documents) {
+        ids.push_back(document.id);
+    }
+    return ids;
+}
+
+SearchServer MakeAnimalServer() {
+    SearchServer search_server("and in at"s);
+    search_server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    search_server.AddDocument(3, "big cat fancy collar "s, DocumentStatus::ACTUAL, {1, 2, 8});
+    search_server.AddDocument(4, "big dog sparrow Eugene"s, DocumentStatus::ACTUAL, {1, 3, 2});
+    search_server.AddDocument(5, "big dog sparrow Vasiliy"s, DocumentStatus::BANNED, {1, 1, 1});
+    return search_server;
+}
+
+// Стоп-слова не находятся и не участвуют в TF
+void TestExcludeStopWords() {
+    SearchServer search_server("in the"s);
+    search_server.AddDocument(42, "cat in the city"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    ASSERT(search_server.FindTopDocuments("in"s).empty());
+    const auto documents = search_server.FindTopDocuments("cat"s);
+    ASSERT_EQUAL(documents.size(), 1u);
+    ASSERT_EQUAL(documents[0].id, 42);
+    ASSERT_EQUAL(search_server.GetWordFrequencies(42).size(), 2u);
+}
+
+// Документ с минус-словом не находится
+void TestExcludeMinusWords() {
+    const SearchServer search_server = MakeAnimalServer();
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("dog -collar"s)), vector<int>({4}));
+    ASSERT(search_server.FindTopDocuments("-dog"s).empty());
+}
+
+// Релевантность - сумма TF-IDF, выдача по убыванию релевантности, затем рейтинга
+void TestRelevanceAndOrder() {
+    const SearchServer search_server = MakeAnimalServer();
+    const auto documents = search_server.FindTopDocuments("curly cat"s);
+    ASSERT_EQUAL(GetIds(documents), vector<int>({1, 3, 2}));
+    const double expected = 0.5 * log(5.0 / 2.0) + 0.25 * log(5.0 / 2.0);
+    ASSERT(abs(documents[0].relevance - expected) < EPSILON);
+    ASSERT_EQUAL(documents[0].rating, (7 + 2 + 7) / 3);
+    for (size_t i = 1; i < documents.size(); ++i) {
+        ASSERT(!SearchServer::IsMoreRelevant(documents[i], documents[i - 1]));
+    }
+}
+
+// Фильтр по статусу и предикату
+void TestFilters() {
+    const SearchServer search_server = MakeAnimalServer();
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("sparrow"s, DocumentStatus::BANNED)), vector<int>({5}));
+    const auto even = search_server.FindTopDocuments("big dog"s, [](int id, DocumentStatus, int) {
+        return id % 2 == 0;
+    });
+    ASSERT_EQUAL(GetIds(even), vector<int>({4, 2}));
+}
+
+// Совпавшие слова документа; минус-слово дает пустой список
+void TestMatchDocument() {
+    const SearchServer search_server = MakeAnimalServer();
+    const auto [words, status] = search_server.MatchDocument("fancy dog cat"s, 2);
+    ASSERT_EQUAL(words, vector<string_view>({"dog"sv, "fancy"sv}));
+    ASSERT(status == DocumentStatus::ACTUAL);
+    const auto [par_words, par_status] = search_server.MatchDocument(execution::par, "dog fancy dog cat"s, 2);
+    ASSERT_EQUAL(par_words, words);
+    ASSERT(get<0>(search_server.MatchDocument("dog -collar"s, 2)).empty());
+    ASSERT_THROWS(search_server.MatchDocument("dog"s, 100), out_of_range);
+}
+
+// Некорректные запросы и документы - std::invalid_argument
+void TestInvalidInput() {
+    SearchServer search_server = MakeAnimalServer();
+    ASSERT_THROWS(search_server.FindTopDocuments("--cat"s), invalid_argument);
+    ASSERT_THROWS(search_server.FindTopDocuments("cat -"s), invalid_argument);
+    ASSERT_THROWS(search_server.FindTopDocuments("ca\x12t"s), invalid_argument);
+    ASSERT_THROWS(search_server.FindTopDocuments("*"s), invalid_argument);
+    ASSERT_THROWS(search_server.AddDocument(1, "duplicate"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+    ASSERT_THROWS(search_server.AddDocument(-1, "negative"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+    ASSERT_THROWS(search_server.AddDocument(9, "bad\x01word"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 5);
+}
+
+// Удаление документа: больше не находится, слово без документов исчезает
+void TestRemoveDocument() {
+    SearchServer search_server = MakeAnimalServer();
+    search_server.RemoveDocument(1);
+    search_server.RemoveDocument(execution::par, 3);
+    search_server.RemoveDocument(100);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 3);
+    ASSERT(search_server.FindTopDocuments("cat"s).empty());
+    ASSERT(search_server.GetWordFrequencies(1).empty());
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("curly"s)), vector<int>({2}));
+    search_server.AddDocument(1, "tail"s, DocumentStatus::ACTUAL, {});
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("tail"s)), vector<int>({1}));
+}
+
+// Пакетная загрузка дает тот же индекс, что AddDocument, и не меняет индекс при ошибке
+void TestAddDocuments() {
+    const SearchServer expected = MakeAnimalServer();
+    const vector<string> texts = {
+        "curly cat curly tail"s, "curly dog and fancy collar"s, "big cat fancy collar "s,
+        "big dog sparrow Eugene"s, "big dog sparrow Vasiliy"s,
+    };
+    vector<RawDocument> documents = {
+        { 1, texts[0], DocumentStatus::ACTUAL, {7, 2, 7} }, { 2, texts[1], DocumentStatus::ACTUAL, {1, 2, 3} },
+        { 3, texts[2], DocumentStatus::ACTUAL, {1, 2, 8} }, { 4, texts[3], DocumentStatus::ACTUAL, {1, 3, 2} },
+        { 5, texts[4], DocumentStatus::BANNED, {1, 1, 1} },
+    };
+    for (const bool is_parallel : {false, true}) {
+        SearchServer search_server("and in at"s);
+        if (is_parallel) {
+            search_server.AddDocuments(execution::par, documents);
+        }
+        else {
+            search_server.AddDocuments(documents);
+        }
+        for (const string& query : {"curly cat"s, "big dog -collar"s, "fancy sparrow tail"s}) {
+            const auto actual_documents = search_server.FindTopDocuments(query);
+            const auto expected_documents = expected.FindTopDocuments(query);
+            ASSERT_EQUAL(GetIds(actual_documents), GetIds(expected_documents));
+            for (size_t i = 0; i < actual_documents.size(); ++i) {
+                ASSERT(abs(actual_documents[i].relevance - expected_documents[i].relevance) < EPSILON);
+            }
+        }
+    }
+    SearchServer search_server("and in at"s);
+    documents.push_back({ 6, "bad\x02text"sv, DocumentStatus::ACTUAL, {} });
+    ASSERT_THROWS(search_server.AddDocuments(execution::par, documents), invalid_argument);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 0);
+}
+
+// Последовательный и параллельный поиск, режимы и форматы списков дают одинаковую выдачу
+void TestPoliciesAndFormats() {
+    SearchServer search_server = MakeAnimalServer();
+    for (const PostingFormat format : {PostingFormat::PLAIN, PostingFormat::COMPRESSED}) {
+        search_server.SetPostingFormat(format);
+        for (const string& query : {"curly cat"s, "big dog -collar"s, "c* -fancy"s}) {
+            ASSERT_EQUAL(GetIds(search_server.FindTopDocuments(execution::par, query)),
+                         GetIds(search_server.FindTopDocuments(query)));
+        }
+        search_server.SetQueryMode(QueryMode::ALL_WORDS);
+        ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("big dog"s)), vector<int>({4}));
+        ASSERT_EQUAL(GetIds(search_server.FindTopDocuments(execution::par, "big dog"s)), vector<int>({4}));
+        search_server.SetQueryMode(QueryMode::ANY_WORD);
+    }
+    search_server.SetDynamicPruning(true);
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("curly cat dog"s)), vector<int>({1, 2, 3, 4}));
+}
+
+// Отсечение MaxScore дает ту же выдачу, что полный перебор: случайный корпус с повторяющимися текстами
+// (равная релевантность, разные рейтинги), минус-слова, фильтры по статусу и предикату, K от 1 до 20
+// меньше числа найденных документов, оба формата списков
+void TestDynamicPruningMatchesExhaustive() {
+    mt19937 generator(2024);
+    const auto random_word = [&generator] {
+        // Неравномерные частоты: у частых слов длинные списки, которые отсечение пропускает
+        const int word = min(uniform_int_distribution(0, 39)(generator), uniform_int_distribution(0, 39)(generator));
+        return "w"s + to_string(word);
+    };
+    SearchServer search_server;
+    vector<string> texts;
+    for (int id = 0; id < 400; ++id) {
+        if (id >= 20 && id % 4 == 0) {
+            texts.push_back(texts[uniform_int_distribution<size_t>(0, texts.size() - 1)(generator)]);
+        }
+        else {
+            string text;
+            for (int count = uniform_int_distribution(1, 8)(generator); count > 0; --count) {
+                text += random_word() + " "s;
+            }
+            texts.push_back(text);
+        }
+        const auto status = static_cast<DocumentStatus>(uniform_int_distribution(0, 9)(generator) < 7
+                                                        ? 0 : uniform_int_distribution(1, 3)(generator));
+        search_server.AddDocument(id, texts.back(), status, {id});  // рейтинги различны: порядок задан однозначно
+    }
+
+    const auto is_divisible_by_three = [](int document_id, DocumentStatus, int) {
+        return document_id % 3 == 0;
+    };
+    const auto find = [&](const string& query, int filter) {
+        if (filter == 0) {
+            return search_server.FindTopDocuments(query);
+        }
+        if (filter == 1) {
+            return search_server.FindTopDocuments(query, DocumentStatus::BANNED);
+        }
+        return search_server.FindTopDocuments(query, is_divisible_by_three);
+    };
+
+    size_t pruned_comparison_count = 0;
+    size_t boundary_tie_count = 0;
+    SearchServer::ResetPruningStats();
+    for (const PostingFormat format : {PostingFormat::PLAIN, PostingFormat::COMPRESSED}) {
+        search_server.SetPostingFormat(format);
+        for (int query_index = 0; query_index < 60; ++query_index) {
+            string query;
+            for (int count = uniform_int_distribution(1, 4)(generator); count > 0; --count) {
+                query += random_word() + " "s;
+            }
+            for (int count = uniform_int_distribution(0, 2)(generator) - 1; count > 0; --count) {
+                query += "-"s + random_word() + " "s;
+            }
+            for (int filter = 0; filter < 3; ++filter) {
+                search_server.SetDynamicPruning(false);
+                search_server.SetMaxResultDocumentCount(1000);
+                const vector<Document> all_documents = find(query, filter);
+                const size_t match_count = all_documents.size();
+                for (size_t count = 1; count <= 20 && count < match_count; ++count) {
+                    // Равная релевантность на границе K: отбор решает рейтинг
+                    if (abs(all_documents[count - 1].relevance - all_documents[count].relevance) < EPSILON) {
+                        ++boundary_tie_count;
+                    }
+                    search_server.SetMaxResultDocumentCount(count);
+                    search_server.SetDynamicPruning(false);
+                    const vector<Document> expected = find(query, filter);
+                    search_server.SetDynamicPruning(true);
+                    const vector<Document> documents = find(query, filter);
+                    const string hint = query + "/ filter "s + to_string(filter) + ", K "s + to_string(count);
+                    ASSERT_EQUAL_HINT(documents.size(), count, hint);
+                    for (size_t i = 0; i < count; ++i) {
+                        ASSERT_EQUAL_HINT(documents[i].id, expected[i].id, hint);
+                        ASSERT_EQUAL_HINT(documents[i].relevance, expected[i].relevance, hint);
+                        ASSERT_EQUAL_HINT(documents[i].rating, expected[i].rating, hint);
+                    }
+                    ++pruned_comparison_count;
+                }
+            }
+        }
+    }
+    ASSERT(pruned_comparison_count > 500);
+    ASSERT(boundary_tie_count > 100);
+    const SearchServer::PruningStats stats = SearchServer::GetPruningStats();
+    ASSERT(stats.scored_postings < stats.query_postings);
+}
+
+// Параллельная загрузка (новые слова и слова словаря после Freeze) и параллельный поиск по частям номеров
+// дают те же частоты и ту же релевантность, что последовательные
+void TestParallelIngestAndSearch() {
+    using RelevanceById = map<int, double>;
+    const auto make_text = [](int id) {
+        string text;
+        for (int i = 0; i < 3 + id % 5; ++i) {
+            text += "w"s + to_string((id * 7 + i * 13) % (id < 6000 ? 300 : 500)) + " "s;
+        }
+        return text;
+    };
+    const auto to_map = [](const vector<Document>& documents) {
+        RelevanceById result;
+        for (const Document& document : documents) {
+            result[document.id] = document.relevance;
+        }
+        return result;
+    };
+    vector<string> texts;
+    for (int id = 0; id < 10000; ++id) {
+        texts.push_back(make_text(id));
+    }
+    for (const PostingFormat format : {PostingFormat::PLAIN, PostingFormat::COMPRESSED}) {
+        SearchServer expected;
+        SearchServer search_server;
+        expected.SetPostingFormat(format);
+        search_server.SetPostingFormat(format);
+        vector<RawDocument> batch;
+        for (int id = 0; id < 10000; ++id) {
+            expected.AddDocument(id, texts[id], static_cast<DocumentStatus>(id % 2), {id % 9});
+            if (id < 4000) {
+                search_server.AddDocument(id, texts[id], static_cast<DocumentStatus>(id % 2), {id % 9});
+            }
+            else {
+                batch.push_back({ id, texts[id], static_cast<DocumentStatus>(id % 2), {id % 9} });
+            }
+        }
+        search_server.Freeze();
+        search_server.AddDocuments(execution::par, batch);
+        ASSERT_EQUAL(search_server.GetDocumentCount(), expected.GetDocumentCount());
+        for (const int id : {0, 3999, 4000, 7777, 9999}) {
+            ASSERT(search_server.GetWordFrequencies(id) == expected.GetWordFrequencies(id));
+        }
+
+        search_server.SetMaxResultDocumentCount(10000);
+        expected.SetMaxResultDocumentCount(10000);
+        const auto filter = [](int id, DocumentStatus, int rating) { return id % 3 != 0 && rating != 4; };
+        for (const string& query : {"w1 w14 w200 -w27"s, "w400 w7 w8 w9"s, "w301 -w5 -w6"s}) {
+            const RelevanceById relevances = to_map(expected.FindTopDocuments(query, filter));
+            ASSERT(!relevances.empty());
+            for (const SearchServer* server : {&expected, &search_server}) {
+                const RelevanceById parallel_relevances = to_map(server->FindTopDocuments(execution::par, query, filter));
+                ASSERT_EQUAL(parallel_relevances.size(), relevances.size());
+                for (const auto& [id, relevance] : relevances) {
+                    ASSERT(parallel_relevances.count(id) != 0);
+                    ASSERT(abs(parallel_relevances.at(id) - relevance) < EPSILON);
+                }
+            }
+        }
+    }
+}
+
+// Префиксные слова раскрываются словами индекса
+void TestPrefixQuery() {
+    const SearchServer search_server = MakeAnimalServer();
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("spa*"s, DocumentStatus::BANNED)), vector<int>({5}));
+    ASSERT_EQUAL(GetIds(search_server.FindTopDocuments("big -col*"s)), vector<int>({4}));
+}
+
+// Страницы выдачи совпадают с соответствующими кусками полной выдачи
+void TestDocumentsPage() {
+    SearchServer search_server = MakeAnimalServer();
+    search_server.SetMaxResultDocumentCount(100);
+    const auto all_documents = search_server.FindTopDocuments("curly big cat dog"s);
+    ASSERT_EQUAL(all_documents.size(), 4u);
+    for (size_t page = 0; page < 3; ++page) {
+        const auto documents = search_server.FindDocumentsPage("curly big cat dog"s, page, 3);
+        const size_t first = min(page * 3, all_documents.size());
+        const size_t last = min(first + 3, all_documents.size());
+        ASSERT_EQUAL(GetIds(documents), GetIds(vector<Document>(all_documents.begin() + first,
+                                                                all_documents.begin() + last)));
+    }
+    ASSERT_THROWS(search_server.FindDocumentsPage("cat"s, 0, 0), invalid_argument);
+    // page * page_size переполняет size_t: в остатке от деления это была бы первая страница
+    const size_t huge_page_size = numeric_limits<size_t>::max() / 2 + 1;
+    ASSERT(search_server.FindDocumentsPage("cat"s, 2, huge_page_size).empty());
+    ASSERT(search_server.FindDocumentsPage("cat"s, numeric_limits<size_t>::max(), 3).empty());
+    ASSERT_EQUAL(search_server.FindDocumentsPage("cat"s, 0, huge_page_size).size(), 2u);
+}
+
+// Страницы Paginator по порядку: размеры страниц и их элементы
+template <typename Container>
+vector<vector<int>> GetPages(const Container& container, size_t page_size) {
+    vector<vector<int>> pages;
+    for (const auto& page : Paginate(container, page_size)) {
+        pages.emplace_back(page.Begin(), page.End());
+        ASSERT_EQUAL(page.size(), pages.back().size());
+    }
+    return pages;
+}
+
+// Постраничный обход двунаправленного и однонаправленного списков: страницы ровно делят диапазон,
+// последняя страница короче, пустой диапазон и нулевой размер страницы
+void TestPaginator() {
+    for (const auto& [page_size, expected] : vector<pair<size_t, vector<vector<int>>>>{
+             {2, {{1, 2}, {3, 4}, {5, 6}}},
+             {4, {{1, 2, 3, 4}, {5, 6}}},
+             {6, {{1, 2, 3, 4, 5, 6}}},
+             {10, {{1, 2, 3, 4, 5, 6}}}}) {
+        const list<int> numbers = {1, 2, 3, 4, 5, 6};
+        const forward_list<int> forward_numbers(numbers.begin(), numbers.end());
+        ASSERT_EQUAL_HINT(GetPages(numbers, page_size), expected, to_string(page_size));
+        ASSERT_EQUAL_HINT(GetPages(forward_numbers, page_size), expected, to_string(page_size));
+    }
+
+    const forward_list<int> empty;
+    const auto paginator = Paginate(empty, 3);
+    ASSERT(paginator.begin() == paginator.end());
+    ASSERT(GetPages(empty, 1).empty());
+    ASSERT_THROWS(Paginate(empty, 0), invalid_argument);
+    ASSERT_THROWS(Paginate(list<int>{1, 2}, 0), invalid_argument);
+}
+
+// Обход id и id по порядковому номеру
+void TestDocumentIds() {
+    const SearchServer search_server = MakeAnimalServer();
+    const vector<int> ids(search_server.begin(), search_server.end());
+    ASSERT_EQUAL(ids.size(), 5u);
+    for (int index = 0; index < search_server.GetDocumentCount(); ++index) {
+        ASSERT_EQUAL(search_server.GetDocumentId(index), ids[index]);
+    }
+    ASSERT_THROWS(search_server.GetDocumentId(5), out_of_range);
+
+    // После удаления номера перестают идти по возрастанию id, но обход и доступ по номеру совпадают
+    SearchServer changed_server = MakeAnimalServer();
+    changed_server.RemoveDocument(ids[1]);
+    changed_server.AddDocument(0, "white cat"s, DocumentStatus::ACTUAL, {1});
+    const vector<int> changed_ids(changed_server.begin(), changed_server.end());
+    ASSERT_EQUAL(changed_ids.size(), 5u);
+    for (int index = 0; index < changed_server.GetDocumentCount(); ++index) {
+        ASSERT_EQUAL(changed_server.GetDocumentId(index), changed_ids[index]);
+    }
+    ASSERT_EQUAL(changed_server.GetDocumentId(1), 5);
+    ASSERT_EQUAL(changed_server.GetDocumentId(4), 0);
+    ASSERT_THROWS(changed_server.GetDocumentId(-1), out_of_range);
+}
+
+// После удалений номера остаются плотными, а поиск дает то же, что индекс, собранный только из оставшихся
+void TestRemoveKeepsOrdinalsDense() {
+    const vector<string> words = {"cat"s, "dog"s, "bird"s, "fish"s, "fox"s, "owl"s, "bat"s};
+    const auto make_text = [&words](int id) {
+        string text;
+        for (int i = 0; i < 2 + id % 4; ++i) {
+            text += words[(id * 3 + i * i) % words.size()] + " "s;
+        }
+        return text;
+    };
+    for (const PostingFormat format : {PostingFormat::PLAIN, PostingFormat::COMPRESSED}) {
+        SearchServer search_server;
+        search_server.SetPostingFormat(format);
+        for (int id = 0; id < 1000; ++id) {
+            search_server.AddDocument(id, make_text(id), static_cast<DocumentStatus>(id % 3), {id % 11});
+        }
+        SearchServer expected;
+        for (int id = 0; id < 1000; ++id) {
+            if (id % 5 == 0 || id % 7 == 0) {
+                expected.AddDocument(id, make_text(id), static_cast<DocumentStatus>(id % 3), {id % 11});
+            }
+            else if (id % 2 == 0) {
+                search_server.RemoveDocument(id);
+            }
+            else {
+                search_server.RemoveDocument(execution::par, id);
+            }
+        }
+        ASSERT_EQUAL(search_server.GetDocumentCount(), expected.GetDocumentCount());
+        vector<int> ids(search_server.begin(), search_server.end());
+        ASSERT_EQUAL(ids.size(), static_cast<size_t>(expected.GetDocumentCount()));
+        sort(ids.begin(), ids.end());
+        ASSERT_EQUAL(ids, vector<int>(expected.begin(), expected.end()));
+
+        search_server.SetMaxResultDocumentCount(1000);
+        expected.SetMaxResultDocumentCount(1000);
+        for (const string& query : {"cat bird -owl"s, "fox bat fish"s, "dog"s}) {
+            for (const DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+                const auto documents = search_server.FindTopDocuments(query, status);
+                const auto expected_documents = expected.FindTopDocuments(query, status);
+                ASSERT_EQUAL(documents.size(), expected_documents.size());
+                map<int, pair<double, int>> found;
+                for (const Document& document : documents) {
+                    found[document.id] = { document.relevance, document.rating };
+                }
+                for (const Document& document : expected_documents) {
+                    ASSERT(found.count(document.id) != 0);
+                    ASSERT(abs(found[document.id].first - document.relevance) < EPSILON);
+                    ASSERT_EQUAL(found[document.id].second, document.rating);
+                }
+            }
+        }
+        // Новые документы после удалений получают номера в конце
+        search_server.AddDocument(5000, "cat cat"s, DocumentStatus::ACTUAL, {});
+        ASSERT_EQUAL(search_server.FindTopDocuments("cat"s).front().id, 5000);
+        ASSERT_EQUAL(*prev(search_server.end()), 5000);
+    }
+}
+
+// Накопитель релевантности очищается и после исключения из предиката, а поиск из предиката не портит внешний
+void TestAccumulatorCleanup() {
+    SearchServer big_server;
+    for (int id = 0; id < 100; ++id) {
+        big_server.AddDocument(id, "cat dog"s, DocumentStatus::ACTUAL, {id});
+    }
+    const SearchServer small_server = MakeAnimalServer();
+    const vector<Document> expected = small_server.FindTopDocuments("curly cat"s);
+
+    int call_count = 0;
+    const auto throwing_filter = [&call_count](int, DocumentStatus, int) {
+        if (++call_count == 50) {
+            throw runtime_error("filter failed");
+        }
+        return true;
+    };
+    ASSERT_THROWS(big_server.FindTopDocuments("cat"s, throwing_filter), runtime_error);
+    const vector<Document> documents = small_server.FindTopDocuments("curly cat"s);
+    ASSERT_EQUAL(GetIds(documents), GetIds(expected));
+    for (size_t i = 0; i < documents.size(); ++i) {
+        ASSERT(abs(documents[i].relevance - expected[i].relevance) < EPSILON);
+    }
+
+    const auto nested_filter = [&small_server, &expected](int, DocumentStatus, int) {
+        return GetIds(small_server.FindTopDocuments("curly cat"s)) == GetIds(expected);
+    };
+    const vector<Document> nested_documents = small_server.FindTopDocuments("curly cat"s, nested_filter);
+    ASSERT_EQUAL(GetIds(nested_documents), GetIds(expected));
+    for (size_t i = 0; i < nested_documents.size(); ++i) {
+        ASSERT(abs(nested_documents[i].relevance - expected[i].relevance) < EPSILON);
+    }
+}
+
+// Копия начинает со своей пустой статистики, общий recorder задается явно, а записи удаленных серверов
+// не копятся в таблице потока
+void TestStatsRecorder() {
+    const uint64_t one = QUERY_STATS_ENABLED ? 1 : 0;
+    SearchServer search_server = MakeAnimalServer();
+    search_server.FindTopDocuments("cat"s);
+    SearchServer copy = search_server;
+    copy.FindTopDocuments("dog"s);
+    copy.FindTopDocuments("dog"s);
+    ASSERT_EQUAL(search_server.GetStats().query_count, one);
+    ASSERT_EQUAL(copy.GetStats().query_count, 2 * one);
+
+    const auto recorder = make_shared<QueryStatsRecorder>();
+    search_server.SetStatsRecorder(recorder);
+    copy.SetStatsRecorder(recorder);
+    search_server.FindTopDocuments("cat"s);
+    copy.FindTopDocuments("dog"s);
+    ASSERT_EQUAL(recorder->GetStats().query_count, 2 * one);
+    ASSERT_EQUAL(search_server.GetStats().query_count, 2 * one);
+    ASSERT_THROWS(copy.SetStatsRecorder(nullptr), invalid_argument);
+
+    // Перемещенный сервер продолжает писать в тот же recorder
+    const SearchServer moved = move(copy);
+    moved.FindTopDocuments("cat"s);
+    ASSERT_EQUAL(moved.GetStats().query_count, 3 * one);
+
+    for (int server = 0; server < 1000; ++server) {
+        SearchServer temporary;
+        temporary.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, {1});
+        temporary.FindTopDocuments("cat"s);
+        search_server.FindTopDocuments("cat"s);
+    }
+    ASSERT_HINT(QueryStatsRecorder::GetThreadTableSize() < 64, to_string(QueryStatsRecorder::GetThreadTableSize()));
+}
+
+}  // namespace
+
+void TestSearchServer(TestRunner& runner) {
+    RUN_TEST(runner, TestExcludeStopWords);
+    RUN_TEST(runner, TestExcludeMinusWords);
+    RUN_TEST(runner, TestRelevanceAndOrder);
+    RUN_TEST(runner, TestFilters);
+    RUN_TEST(runner, TestMatchDocument);
+    RUN_TEST(runner, TestInvalidInput);
+    RUN_TEST(runner, TestRemoveDocument);
+    RUN_TEST(runner, TestAddDocuments);
+    RUN_TEST(runner, TestPoliciesAndFormats);
+    RUN_TEST(runner, TestDynamicPruningMatchesExhaustive);
+    RUN_TEST(runner, TestParallelIngestAndSearch);
+    RUN_TEST(runner, TestPrefixQuery);
+    RUN_TEST(runner, TestDocumentsPage);
+    RUN_TEST(runner, TestPaginator);
+    RUN_TEST(runner, TestDocumentIds);
+    RUN_TEST(runner, TestRemoveKeepsOrdinalsDense);
+    RUN_TEST(runner, TestAccumulatorCleanup);
+    RUN_TEST(runner, TestStatsRecorder);
+}
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+#include "search_server.h"
+#include "segmented_search_server.h"
+#include "test_suites.h"
+
+using namespace std;
+
+namespace {
+
+string MakeText(int document_id) {
+    return "w"s + to_string(document_id % 13) + " w"s + to_string(document_id % 5) + " w"s + to_string(document_id % 31);
+}
+
+// Выдача совпадает с одним SearchServer с теми же документами. Порядок документов с равной релевантностью
+// и рейтингом не задан, поэтому сравниваются релевантности и рейтинги по порядку.
+void AssertSameResults(const SegmentedSearchServer& segmented, const SearchServer& expected, const string& query) {
+    const vector<Document> documents = segmented.FindTopDocuments(query);
+    const vector<Document> expected_documents = expected.FindTopDocuments(query);
+    ASSERT_EQUAL_HINT(documents.size(), expected_documents.size(), query);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        ASSERT_HINT(abs(documents[i].relevance - expected_documents[i].relevance) < EPSILON, query);
+        ASSERT_EQUAL_HINT(documents[i].rating, expected_documents[i].rating, query);
+    }
+}
+
+// Документ, удаленный из запечатанного сегмента и добавленный снова, находится, а его старая копия - нет
+void TestReAddRemovedSealedId() {
+    SegmentedSearchServer segmented(""sv, 2);
+    segmented.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, {1});
+    segmented.AddDocument(2, "dog"s, DocumentStatus::ACTUAL, {2});
+    segmented.RemoveDocument(1);
+    segmented.AddDocument(1, "cat fox"s, DocumentStatus::ACTUAL, {3});
+
+    const vector<Document> documents = segmented.FindTopDocuments("cat"s);
+    ASSERT_EQUAL(documents.size(), 1u);
+    ASSERT_EQUAL(documents.front().id, 1);
+    ASSERT_EQUAL(documents.front().rating, 3);
+    SearchServer expected;
+    expected.AddDocument(2, "dog"s, DocumentStatus::ACTUAL, {2});
+    expected.AddDocument(1, "cat fox"s, DocumentStatus::ACTUAL, {3});
+    for (const string& query : {"cat"s, "dog fox"s, "cat dog"s}) {
+        AssertSameResults(segmented, expected, query);
+    }
+
+    // Новая копия тоже запечатывается и сливается со старой; удаляется только живая копия
+    segmented.AddDocument(3, "cat dog"s, DocumentStatus::ACTUAL, {4});
+    expected.AddDocument(3, "cat dog"s, DocumentStatus::ACTUAL, {4});
+    segmented.WaitForMerges();
+    AssertSameResults(segmented, expected, "cat fox"s);
+    segmented.RemoveDocument(1);
+    expected.RemoveDocument(1);
+    segmented.WaitForMerges();
+    AssertSameResults(segmented, expected, "cat fox"s);
+    ASSERT_EQUAL(segmented.GetDocumentCount(), 2);
+}
+
+// Добавления, удаления и повторные добавления с частыми запечатываниями и слияниями
+void TestMatchesSingleServer() {
+    SegmentedSearchServer segmented(""sv, 8);
+    SearchServer expected;
+    const vector<string> queries = {"w1 w2"s, "w3 -w4"s, "w7 w20 w30"s, "w0"s};
+    for (int step = 0; step < 600; ++step) {
+        const int document_id = step % 150;
+        if (expected.HasDocument(document_id)) {
+            segmented.RemoveDocument(document_id);
+            expected.RemoveDocument(document_id);
+        }
+        else {
+            const string text = MakeText(step);
+            segmented.AddDocument(document_id, text, DocumentStatus::ACTUAL, {step % 7});
+            expected.AddDocument(document_id, text, DocumentStatus::ACTUAL, {step % 7});
+        }
+        if (step % 37 == 0) {
+            for (const string& query : queries) {
+                AssertSameResults(segmented, expected, query);
+            }
+        }
+    }
+    segmented.WaitForMerges();
+    ASSERT_EQUAL(segmented.GetDocumentCount(), expected.GetDocumentCount());
+    for (const string& query : queries) {
+        AssertSameResults(segmented, expected, query);
+    }
+    ASSERT(segmented.GetStats().merge_count > 0);
+    // Запечатывания и слияния не сбрасывают статистику запросов: 17 проверок по 4 запроса и 4 в конце
+    ASSERT_EQUAL(segmented.GetQueryStats().query_count, QUERY_STATS_ENABLED ? 72u : 0u);
+}
+
+// Поиск из нескольких потоков, пока писатель добавляет и удаляет документы, а фоновый поток сливает сегменты
+void TestConcurrentQueries() {
+    SegmentedSearchServer segmented(""sv, 16);
+    atomic_bool stop = false;
+    atomic_int failure_count = 0;
+    vector<thread> readers;
+    for (int reader = 0; reader < 3; ++reader) {
+        readers.emplace_back([&segmented, &stop, &failure_count] {
+            for (int iteration = 0; !stop; ++iteration) {
+                try {
+                    const auto documents = segmented.FindTopDocuments("w"s + to_string(iteration % 31) + " w1"s);
+                    if (documents.size() > static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT)) {
+                        ++failure_count;
+                    }
+                }
+                catch (...) {
+                    ++failure_count;
+                }
+            }
+        });
+    }
+    SearchServer expected;
+    exception_ptr writer_error;
+    try {
+        for (int step = 0; step < 3000; ++step) {
+            const int document_id = (step * 7) % 1000;
+            if (expected.HasDocument(document_id)) {
+                segmented.RemoveDocument(document_id);
+                expected.RemoveDocument(document_id);
+            }
+            else {
+                segmented.AddDocument(document_id, MakeText(step), DocumentStatus::ACTUAL, {step % 9});
+                expected.AddDocument(document_id, MakeText(step), DocumentStatus::ACTUAL, {step % 9});
+            }
+        }
+    }
+    catch (...) {
+        writer_error = current_exception();
+    }
+    stop = true;
+    for (thread& reader : readers) {
+        reader.join();
+    }
+    if (writer_error) {
+        rethrow_exception(writer_error);
+    }
+    ASSERT_EQUAL(failure_count.load(), 0);
+    segmented.WaitForMerges();
+    for (const string& query : {"w1 w2"s, "w3 -w4"s, "w12 w29"s}) {
+        AssertSameResults(segmented, expected, query);
+    }
+}
+
+}  // namespace
+
+void TestSegmentedSearchServer(TestRunner& runner) {
+    RUN_TEST(runner, TestReAddRemovedSealedId);
+    RUN_TEST(runner, TestMatchesSingleServer);
+    RUN_TEST(runner, TestConcurrentQueries);
+}
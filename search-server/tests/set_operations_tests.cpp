@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <vector>
+#include "posting_set_operations.h"
+#include "test_suites.h"
+
+using namespace std;
+
+namespace {
+
+using Positions = vector<uint32_t>;
+
+vector<int> GenerateSortedIds(mt19937& generator, size_t size, int max_value) {
+    uniform_int_distribution<int> distribution(0, max_value);
+    vector<int> ids;
+    while (ids.size() < size) {
+        ids.push_back(distribution(generator));
+        if (ids.size() == size) {
+            sort(ids.begin(), ids.end());
+            ids.erase(unique(ids.begin(), ids.end()), ids.end());
+        }
+    }
+    return ids;
+}
+
+// Позиции элементов a, которые есть (is_contained) или которых нет в b
+Positions FindPositions(const vector<int>& a, const vector<int>& b, bool is_contained) {
+    Positions positions;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (binary_search(b.begin(), b.end(), a[i]) == is_contained) {
+            positions.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    return positions;
+}
+
+// Результат дописывается после уже лежащих в out значений
+template <typename Value>
+vector<Value> WithoutPrefix(const pmr::vector<Value>& out) {
+    return vector<Value>(out.begin() + 1, out.end());
+}
+
+// Каждый доступный набор команд дает то же, что эталон на std::binary_search и std::set_union, на случайных
+// массивах разных длин и плотностей: пустых, короче и длиннее блока, сильно разной длины (поиск галопом)
+void TestKernelsMatchStd() {
+    const SetOperationsKernel initial_kernel = GetSetOperationsKernel();
+    const vector<size_t> sizes = {0, 1, 3, 4, 7, 8, 9, 15, 16, 17, 31, 64, 100, 1000, 5000};
+    for (const SetOperationsKernel kernel :
+         {SetOperationsKernel::SCALAR, SetOperationsKernel::SSE42, SetOperationsKernel::AVX2}) {
+        SetSetOperationsKernel(kernel);
+        if (GetSetOperationsKernel() != kernel) {
+            continue;  // процессор не поддерживает этот набор команд
+        }
+        const string hint = GetSetOperationsKernelName(kernel);
+        mt19937 generator(42);
+        for (const size_t a_size : sizes) {
+            for (const size_t b_size : sizes) {
+                for (const int max_value : {static_cast<int>(max(a_size, b_size)) * 2 + 1, 1'000'000}) {
+                    const vector<int> a = GenerateSortedIds(generator, a_size, max_value);
+                    const vector<int> b = GenerateSortedIds(generator, b_size, max_value);
+
+                    pmr::vector<uint32_t> positions = {7};
+                    IntersectSorted(a, b, positions);
+                    ASSERT_EQUAL_HINT(WithoutPrefix(positions), FindPositions(a, b, true), hint);
+
+                    positions = {7};
+                    DifferenceSorted(a, b, positions);
+                    ASSERT_EQUAL_HINT(WithoutPrefix(positions), FindPositions(a, b, false), hint);
+
+                    pmr::vector<int> united = {-1};
+                    UnionSorted(a, b, united);
+                    vector<int> expected;
+                    set_union(a.begin(), a.end(), b.begin(), b.end(), back_inserter(expected));
+                    ASSERT_EQUAL_HINT(WithoutPrefix(united), expected, hint);
+                }
+            }
+        }
+    }
+    SetSetOperationsKernel(initial_kernel);
+}
+
+}  // namespace
+
+void TestSetOperations(TestRunner& runner) {
+    RUN_TEST(runner, TestKernelsMatchStd);
+}
@@ -0,0 +1,103 @@
+#include <cmath>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "search_server.h"
+#include "sharded_search_server.h"
+#include "test_suites.h"
+
+using namespace std;
+
+namespace {
+
+string MakeText(int document_id) {
+    return "w"s + to_string(document_id % 11) + " w"s + to_string(document_id % 4) + " w"s + to_string(document_id % 23);
+}
+
+// Выдача совпадает с одним SearchServer с теми же документами (см. segmented_tests.cpp)
+void AssertSameResults(const ShardedSearchServer& sharded, const SearchServer& expected, const string& query) {
+    const vector<Document> documents = sharded.FindTopDocuments(query);
+    const vector<Document> expected_documents = expected.FindTopDocuments(query);
+    ASSERT_EQUAL_HINT(documents.size(), expected_documents.size(), query);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        ASSERT_HINT(abs(documents[i].relevance - expected_documents[i].relevance) < EPSILON, query);
+        ASSERT_EQUAL_HINT(documents[i].rating, expected_documents[i].rating, query);
+    }
+}
+
+// Добавление пачками и по одному, удаление и поиск в запущенных шардах
+void TestMatchesSingleServer() {
+    ShardedSearchServer sharded(3, "w0"sv);
+    SearchServer expected("w0"sv);
+    vector<string> texts;
+    vector<RawDocument> batch;
+    for (int id = 0; id < 60; ++id) {
+        texts.push_back(MakeText(id));
+    }
+    for (int id = 0; id < 40; ++id) {
+        batch.push_back({ id, texts[id], DocumentStatus::ACTUAL, {id % 5} });
+    }
+    sharded.AddDocuments(batch);
+    expected.AddDocuments(batch);
+    for (int id = 40; id < 60; ++id) {
+        sharded.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id % 5});
+        expected.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id % 5});
+    }
+    for (int id = 0; id < 60; id += 7) {
+        sharded.RemoveDocument(id);
+        expected.RemoveDocument(id);
+    }
+    ASSERT_EQUAL(sharded.GetDocumentCount(), expected.GetDocumentCount());
+    for (const string& query : {"w1 w2"s, "w3 -w2"s, "w0 w7 w20"s}) {
+        AssertSameResults(sharded, expected, query);
+    }
+    ASSERT_EQUAL(get<0>(sharded.MatchDocument("w1 w5"s, 1)), vector<string>({"w1"s}));
+    ASSERT_THROWS(sharded.MatchDocument("w1"s, 0), out_of_range);
+}
+
+// Некорректный документ одного шарда отменяет пачку целиком: документы других шардов удаляются,
+// исключение - исходное, без вложенной ошибки отката
+void TestAddDocumentsRollback() {
+    const size_t shard_count = 3;
+    ShardedSearchServer sharded(shard_count);
+    sharded.AddDocument(100, "cat"s, DocumentStatus::ACTUAL, {1});
+
+    vector<RawDocument> batch;
+    vector<char> has_shard(shard_count);
+    for (int id = 0; id < 30; ++id) {
+        batch.push_back({ id, "cat dog"sv, DocumentStatus::ACTUAL, {2} });
+        has_shard[ShardedSearchServer::GetShardIndex(id, shard_count)] = 1;
+    }
+    for (const char has_documents : has_shard) {
+        ASSERT(has_documents);  // пачка задевает все шарды
+    }
+    batch.push_back({ 30, "bad\x01word"sv, DocumentStatus::ACTUAL, {3} });
+
+    bool is_thrown = false;
+    try {
+        sharded.AddDocuments(batch);
+    }
+    catch (const invalid_argument& e) {
+        is_thrown = true;
+        ASSERT(dynamic_cast<const nested_exception*>(&e) == nullptr);
+    }
+    ASSERT(is_thrown);
+    ASSERT_EQUAL(sharded.GetDocumentCount(), 1);
+    const vector<Document> documents = sharded.FindTopDocuments("cat dog"s);
+    ASSERT_EQUAL(documents.size(), 1u);
+    ASSERT_EQUAL(documents.front().id, 100);
+
+    // Откат вернул шарды в прежнее состояние: те же id добавляются снова
+    batch.pop_back();
+    sharded.AddDocuments(batch);
+    ASSERT_EQUAL(sharded.GetDocumentCount(), 31);
+    ASSERT_EQUAL(sharded.FindTopDocuments("dog"s).size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+}
+
+}  // namespace
+
+void TestShardedSearchServer(TestRunner& runner) {
+    RUN_TEST(runner, TestMatchesSingleServer);
+    RUN_TEST(runner, TestAddDocumentsRollback);
+}
@@ -0,0 +1,197 @@
+#include <atomic>
+#include <exception>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "snapshot_search_server.h"
+#include "test_suites.h"
+
+using namespace std;
+
+namespace {
+
+using RelevanceById = map<int, double>;
+
+RelevanceById FindRelevances(const SearchServer& search_server, const string& query) {
+    RelevanceById result;
+    for (const Document& document : search_server.FindTopDocuments(query)) {
+        result[document.id] = document.relevance;
+    }
+    return result;
+}
+
+string MakeText(int document_id) {
+    return "common w"s + to_string(document_id % 50) + " w"s + to_string(document_id % 7);
+}
+
+// Изменения видны только после Publish, а удерживаемая версия не меняется
+void TestPublishVisibility() {
+    SnapshotSearchServer search_server;
+    search_server.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 0);
+    search_server.Publish();
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 1);
+
+    const shared_ptr<const SearchServer> held = search_server.GetSnapshot();
+    search_server.AddDocument(2, "cat dog"s, DocumentStatus::ACTUAL, {2});
+    search_server.Publish();
+    search_server.RemoveDocument(1);
+    search_server.Publish();
+    search_server.AddDocument(3, "dog"s, DocumentStatus::ACTUAL, {3});
+    search_server.Publish();
+    ASSERT_EQUAL(held->GetDocumentCount(), 1);
+    ASSERT_EQUAL(held->FindTopDocuments("cat"s).size(), 1u);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 2);
+    ASSERT_EQUAL(search_server.FindTopDocuments("cat"s).size(), 1u);
+    ASSERT_EQUAL(search_server.FindTopDocuments("cat"s).front().id, 2);
+    ASSERT_EQUAL(get<0>(search_server.MatchDocument("dog"s, 3)), vector<string>({"dog"s}));
+}
+
+// Читатели ищут и держат версии, пока писатель добавляет, удаляет и публикует. После каждой публикации
+// опубликованная версия совпадает с индексом, собранным теми же изменениями без публикаций.
+void TestConcurrentPublish() {
+    SnapshotSearchServer search_server;
+    SearchServer expected;
+    atomic_bool stop = false;
+    atomic_int failure_count = 0;
+
+    vector<thread> readers;
+    for (int reader = 0; reader < 4; ++reader) {
+        readers.emplace_back([&search_server, &stop, &failure_count, reader] {
+            shared_ptr<const SearchServer> held;
+            int held_count = 0;
+            for (int iteration = 0; !stop; ++iteration) {
+                try {
+                    if (iteration % 64 == reader) {
+                        held = search_server.GetSnapshot();
+                        held_count = held->GetDocumentCount();
+                    }
+                    const int document_count = search_server.GetDocumentCount();
+                    const auto documents = search_server.FindTopDocuments("common w"s + to_string(iteration % 50));
+                    if (documents.size() > static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT)
+                        || (held != nullptr && held->GetDocumentCount() != held_count)
+                        || document_count < 0) {
+                        ++failure_count;
+                    }
+                    try {
+                        search_server.MatchDocument("common"s, iteration % 2000);
+                    }
+                    catch (const out_of_range&) {
+                        // документа еще нет или он удален
+                    }
+                }
+                catch (...) {
+                    ++failure_count;
+                }
+            }
+        });
+    }
+
+    // Проваленная проверка писателя не должна оставить читателей работать: они останавливаются в любом случае
+    exception_ptr writer_error;
+    try {
+        int next_id = 0;
+        for (int publish = 0; publish < 200; ++publish) {
+            for (int i = 0; i < 10; ++i, ++next_id) {
+                search_server.AddDocument(next_id, MakeText(next_id), DocumentStatus::ACTUAL, {next_id % 5});
+                expected.AddDocument(next_id, MakeText(next_id), DocumentStatus::ACTUAL, {next_id % 5});
+            }
+            if (publish % 3 == 2) {
+                search_server.RemoveDocument(next_id - 25);
+                expected.RemoveDocument(next_id - 25);
+            }
+            search_server.Publish();
+            const shared_ptr<const SearchServer> snapshot = search_server.GetSnapshot();
+            ASSERT_EQUAL(snapshot->GetDocumentCount(), expected.GetDocumentCount());
+            if (publish % 10 == 0) {
+                for (const string& query : {"common"s, "w3 w4"s, "w17 -w2"s}) {
+                    ASSERT(FindRelevances(*snapshot, query) == FindRelevances(expected, query));
+                }
+            }
+        }
+    }
+    catch (...) {
+        writer_error = current_exception();
+    }
+    stop = true;
+    for (thread& reader : readers) {
+        reader.join();
+    }
+    if (writer_error) {
+        rethrow_exception(writer_error);
+    }
+    ASSERT_EQUAL(failure_count.load(), 0);
+    ASSERT(FindRelevances(*search_server.GetSnapshot(), "w5 w6"s) == FindRelevances(expected, "w5 w6"s));
+}
+
+// Читателей больше, чем ячеек ReaderEpochs: первые SLOT_COUNT занимают все ячейки разом, остальные ждут
+// в Pin, пока писатель публикует версии
+void TestMoreReadersThanSlots() {
+    SnapshotSearchServer search_server;
+    search_server.AddDocument(0, "common"s, DocumentStatus::ACTUAL, {1});
+    search_server.Publish();
+    const int reader_count = static_cast<int>(ReaderEpochs::SLOT_COUNT) + 16;
+    atomic_int entered_count = 0;
+    atomic_int finished_count = 0;
+    atomic_int failure_count = 0;
+    vector<thread> readers;
+    for (int reader = 0; reader < reader_count; ++reader) {
+        readers.emplace_back([&] {
+            // Фильтр вызывается внутри Pin: первый вызов ждет, пока заняты все ячейки
+            bool has_entered = false;
+            const auto wait_all_slots = [&entered_count, &has_entered](int, DocumentStatus, int) {
+                if (!has_entered) {
+                    has_entered = true;
+                    for (++entered_count; entered_count < static_cast<int>(ReaderEpochs::SLOT_COUNT);) {
+                        this_thread::yield();
+                    }
+                }
+                return true;
+            };
+            if (search_server.FindTopDocuments("common"s, wait_all_slots).empty()) {
+                ++failure_count;
+            }
+            for (int iteration = 0; iteration < 20; ++iteration) {
+                if (search_server.FindTopDocuments("common"s).empty()) {
+                    ++failure_count;
+                }
+            }
+            ++finished_count;
+        });
+    }
+    for (int id = 1; finished_count < reader_count; ++id) {
+        search_server.AddDocument(id, "common w"s + to_string(id), DocumentStatus::ACTUAL, {id % 5});
+        search_server.Publish();
+    }
+    for (thread& reader : readers) {
+        reader.join();
+    }
+    ASSERT_EQUAL(entered_count.load(), reader_count);
+    ASSERT_EQUAL(failure_count.load(), 0);
+}
+
+// Статистика запросов копится по всем версиям и не сбрасывается публикациями
+void TestStatsSurvivePublish() {
+    SnapshotSearchServer search_server;
+    for (int publish = 0; publish < 5; ++publish) {
+        search_server.AddDocument(publish, MakeText(publish), DocumentStatus::ACTUAL, {1});
+        search_server.Publish();
+        for (int query = 0; query < 3; ++query) {
+            search_server.FindTopDocuments("common"s);
+        }
+        search_server.GetSnapshot()->FindTopDocuments("w1"s);
+    }
+    ASSERT_EQUAL(search_server.GetStats().query_count, QUERY_STATS_ENABLED ? 20u : 0u);
+}
+
+}  // namespace
+
+void TestSnapshotSearchServer(TestRunner& runner) {
+    RUN_TEST(runner, TestPublishVisibility);
+    RUN_TEST(runner, TestConcurrentPublish);
+    RUN_TEST(runner, TestMoreReadersThanSlots);
+    RUN_TEST(runner, TestStatsSurvivePublish);
+}
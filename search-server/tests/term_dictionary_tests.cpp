@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "search_server.h"
+#include "term_dictionary.h"
+#include "test_suites.h"
+
+using namespace std;
+
+namespace {
+
+using TermRange = pair<uint32_t, uint32_t>;
+
+// Поиск присутствующих и отсутствующих слов, номера слов по порядку
+void TestExactLookup() {
+    const vector<string_view> terms = {"apple"sv, "apricot"sv, "banana"sv, "zebra"sv, "zoo"sv};
+    const TermDictionary dictionary(terms);
+    ASSERT_EQUAL(dictionary.size(), terms.size());
+    ASSERT(!dictionary.empty());
+    for (uint32_t term_id = 0; term_id < terms.size(); ++term_id) {
+        ASSERT_EQUAL(dictionary.GetTerm(term_id), terms[term_id]);
+        ASSERT_EQUAL(dictionary.Find(terms[term_id]), term_id);
+        ASSERT(dictionary.Contains(terms[term_id]));
+    }
+    for (const string_view absent : {""sv, "app"sv, "apples"sv, "cherry"sv, "zooo"sv, "Apple"sv}) {
+        ASSERT_EQUAL_HINT(dictionary.Find(absent), TERM_NOT_FOUND, string(absent));
+        ASSERT_HINT(!dictionary.Contains(absent), string(absent));
+    }
+}
+
+// Слова с одной начальной ячейкой хеш-таблицы: цепочка проб проходит через конец таблицы в начало
+void TestHashCollisions() {
+    // Четыре слова - восемь ячеек; все слова и отсутствующее слово начинают с последней ячейки
+    const size_t mask = 7;
+    vector<string> colliding;
+    for (int i = 0; colliding.size() < 5; ++i) {
+        string term = "t"s + to_string(i);
+        if ((hash<string_view>{}(term) & mask) == mask) {
+            colliding.push_back(move(term));
+        }
+    }
+    const string absent = colliding.back();
+    colliding.pop_back();
+    sort(colliding.begin(), colliding.end());
+    const TermDictionary dictionary(vector<string_view>(colliding.begin(), colliding.end()));
+    for (uint32_t term_id = 0; term_id < colliding.size(); ++term_id) {
+        ASSERT_EQUAL_HINT(dictionary.Find(colliding[term_id]), term_id, colliding[term_id]);
+    }
+    ASSERT_EQUAL_HINT(dictionary.Find(absent), TERM_NOT_FOUND, absent);
+}
+
+void TestEmptyDictionary() {
+    const TermDictionary dictionary;
+    ASSERT(dictionary.empty());
+    ASSERT_EQUAL(dictionary.size(), 0u);
+    ASSERT_EQUAL(dictionary.Find("cat"sv), TERM_NOT_FOUND);
+    ASSERT_EQUAL(dictionary.Find(""sv), TERM_NOT_FOUND);
+    ASSERT(dictionary.FindPrefix("c"sv) == TermRange(0, 0));
+    ASSERT(dictionary.FindPrefix(""sv) == TermRange(0, 0));
+
+    const TermDictionary built_empty(vector<string_view>{});
+    ASSERT(built_empty.empty());
+    ASSERT_EQUAL(built_empty.Find("cat"sv), TERM_NOT_FOUND);
+}
+
+// Диапазоны префиксов, в том числе у первого и последнего слова и за краями словаря
+void TestPrefixRanges() {
+    const TermDictionary dictionary({"apple"sv, "apricot"sv, "banana"sv, "zebra"sv, "zoo"sv});
+    ASSERT(dictionary.FindPrefix(""sv) == TermRange(0, 5));
+    ASSERT(dictionary.FindPrefix("a"sv) == TermRange(0, 2));
+    ASSERT(dictionary.FindPrefix("apple"sv) == TermRange(0, 1));
+    ASSERT(dictionary.FindPrefix("applesauce"sv) == TermRange(1, 1));
+    ASSERT(dictionary.FindPrefix("b"sv) == TermRange(2, 3));
+    ASSERT(dictionary.FindPrefix("z"sv) == TermRange(3, 5));
+    ASSERT(dictionary.FindPrefix("zoo"sv) == TermRange(4, 5));
+    ASSERT(dictionary.FindPrefix("zz"sv) == TermRange(5, 5));
+    ASSERT(dictionary.FindPrefix("0"sv) == TermRange(0, 0));
+}
+
+// Слово есть в словаре, если у него есть документы. Слова после Freeze живут в дереве новых слов,
+// опустевшее слово словаря остается в нем, но не находится; Freeze убирает его совсем.
+void TestFrozenAndAddedWords() {
+    using WordCounts = vector<pair<string_view, int>>;
+    SearchServer search_server;
+    search_server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "cat"s, DocumentStatus::ACTUAL, {2});
+    search_server.Freeze();
+    search_server.AddDocument(3, "fox cat"s, DocumentStatus::ACTUAL, {3});
+    ASSERT(search_server.GetQueryWordDocumentCounts("bird cat dog fox"s) == WordCounts({{"cat"sv, 3}, {"dog"sv, 1}, {"fox"sv, 1}}));
+    ASSERT_EQUAL(search_server.FindTopDocuments("fox"s).size(), 1u);
+    ASSERT_EQUAL(search_server.FindTopDocuments("f*"s).size(), 1u);
+
+    // Последний документ слова из словаря и слова из дерева
+    search_server.RemoveDocument(1);
+    search_server.RemoveDocument(3);
+    ASSERT(search_server.GetQueryWordDocumentCounts("cat dog fox"s) == WordCounts({{"cat"sv, 1}}));
+    ASSERT(search_server.FindTopDocuments("dog"s).empty());
+    ASSERT(search_server.FindTopDocuments("d* f*"s).empty());
+    ASSERT(get<0>(search_server.MatchDocument("dog fox cat"s, 2)) == vector<string_view>({"cat"sv}));
+
+    search_server.Freeze();
+    ASSERT(search_server.GetQueryWordDocumentCounts("cat dog fox"s) == WordCounts({{"cat"sv, 1}}));
+    // Слово, убранное из словаря, после Freeze возвращается как новое
+    search_server.AddDocument(4, "dog"s, DocumentStatus::ACTUAL, {4});
+    ASSERT(search_server.GetQueryWordDocumentCounts("cat dog"s) == WordCounts({{"cat"sv, 1}, {"dog"sv, 1}}));
+    ASSERT_EQUAL(search_server.FindTopDocuments("d*"s).size(), 1u);
+}
+
+}  // namespace
+
+void TestTermDictionary(TestRunner& runner) {
+    RUN_TEST(runner, TestExactLookup);
+    RUN_TEST(runner, TestHashCollisions);
+    RUN_TEST(runner, TestEmptyDictionary);
+    RUN_TEST(runner, TestPrefixRanges);
+    RUN_TEST(runner, TestFrozenAndAddedWords);
+}
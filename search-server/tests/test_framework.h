@@ -0,0 +1,102 @@
+#pragma once
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Проверки тестов. Проваленная проверка бросает TestFailure с местом и текстом проверки,
+// TestRunner печатает результат каждого теста и считает проваленные.
+class TestFailure : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+template <typename First, typename Second>
+std::ostream& operator<<(std::ostream& out, const std::pair<First, Second>& value) {
+    return out << '(' << value.first << ", " << value.second << ')';
+}
+
+template <typename Element>
+std::ostream& operator<<(std::ostream& out, const std::vector<Element>& values) {
+    out << '[';
+    bool is_first = true;
+    for (const auto& value : values) {
+        out << (is_first ? "" : ", ") << value;
+        is_first = false;
+    }
+    return out << ']';
+}
+
+inline void AssertImpl(bool value, const std::string& expr_str, const std::string& file, const std::string& func,
+                       unsigned line, const std::string& hint) {
+    if (!value) {
+        std::ostringstream out;
+        out << file << "(" << line << "): " << func << ": ASSERT(" << expr_str << ") failed.";
+        if (!hint.empty()) {
+            out << " Hint: " << hint;
+        }
+        throw TestFailure(out.str());
+    }
+}
+
+template <typename T, typename U>
+void AssertEqualImpl(const T& t, const U& u, const std::string& t_str, const std::string& u_str,
+                     const std::string& file, const std::string& func, unsigned line, const std::string& hint) {
+    if (!(t == u)) {
+        std::ostringstream out;
+        out << file << "(" << line << "): " << func << ": ASSERT_EQUAL(" << t_str << ", " << u_str << ") failed: "
+            << t << " != " << u << ".";
+        if (!hint.empty()) {
+            out << " Hint: " << hint;
+        }
+        throw TestFailure(out.str());
+    }
+}
+
+#define ASSERT(expr) AssertImpl(!!(expr), #expr, __FILE__, __FUNCTION__, __LINE__, "")
+
+#define ASSERT_HINT(expr, hint) AssertImpl(!!(expr), #expr, __FILE__, __FUNCTION__, __LINE__, (hint))
+
+#define ASSERT_EQUAL(a, b) AssertEqualImpl((a), (b), #a, #b, __FILE__, __FUNCTION__, __LINE__, "")
+
+#define ASSERT_EQUAL_HINT(a, b, hint) AssertEqualImpl((a), (b), #a, #b, __FILE__, __FUNCTION__, __LINE__, (hint))
+
+// Выражение должно бросить исключение типа exception_type (или производного)
+#define ASSERT_THROWS(expr, exception_type)                                                             \
+    do {                                                                                                \
+        bool is_thrown = false;                                                                         \
+        try {                                                                                           \
+            (void)(expr);                                                                               \
+        }                                                                                               \
+        catch (const exception_type&) {                                                                 \
+            is_thrown = true;                                                                           \
+        }                                                                                               \
+        AssertImpl(is_thrown, #expr " throws " #exception_type, __FILE__, __FUNCTION__, __LINE__, ""); \
+    } while (false)
+
+class TestRunner {
+public:
+    template <typename TestFunc>
+    void RunTest(TestFunc func, const std::string& test_name) {
+        try {
+            func();
+            std::cerr << test_name << " OK" << std::endl;
+        }
+        catch (const std::exception& e) {
+            ++fail_count_;
+            std::cerr << test_name << " fail: " << e.what() << std::endl;
+        }
+    }
+
+    int GetFailCount() const {
+        return fail_count_;
+    }
+
+private:
+    int fail_count_ = 0;
+};
+
+#define RUN_TEST(runner, func) (runner).RunTest((func), #func)
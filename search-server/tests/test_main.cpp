@@ -0,0 +1,51 @@
+#include <cstring>
+#include <iostream>
+#include "test_suites.h"
+
+namespace {
+
+struct TestSuite {
+    const char* name;
+    void (*run)(TestRunner&);
+};
+
+const TestSuite TEST_SUITES[] = {
+    { "search_server", TestSearchServer },
+    { "process_queries", TestProcessQueries },
+    { "allocations", TestAllocations },
+    { "posting_list", TestPostingList },
+    { "index_file", TestIndexFile },
+    { "snapshot", TestSnapshotSearchServer },
+    { "set_operations", TestSetOperations },
+    { "segmented", TestSegmentedSearchServer },
+    { "term_dictionary", TestTermDictionary },
+    { "read_input", TestReadInput },
+    { "query_cache", TestQueryCache },
+    { "request_queue", TestRequestQueue },
+#if SEARCH_SERVER_SHARDS
+    { "sharded", TestShardedSearchServer },
+#endif
+};
+
+}  // namespace
+
+// Без аргументов запускаются все наборы, иначе - перечисленные по имени
+int main(int argc, char* argv[]) {
+    TestRunner runner;
+    int run_count = 0;
+    for (const TestSuite& suite : TEST_SUITES) {
+        bool is_selected = argc == 1;
+        for (int i = 1; i < argc; ++i) {
+            is_selected = is_selected || std::strcmp(argv[i], suite.name) == 0;
+        }
+        if (is_selected) {
+            suite.run(runner);
+            ++run_count;
+        }
+    }
+    if (run_count == 0) {
+        std::cerr << "Unknown test suite" << std::endl;
+        return 2;
+    }
+    return runner.GetFailCount() == 0 ? 0 : 1;
+}
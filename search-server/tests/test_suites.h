@@ -0,0 +1,20 @@
+#pragma once
+
+#include "test_framework.h"
+
+// Наборы тестов; каждый регистрируется в CTest отдельным тестом (см. test_main.cpp)
+void TestSearchServer(TestRunner& runner);
+void TestProcessQueries(TestRunner& runner);
+void TestAllocations(TestRunner& runner);
+void TestPostingList(TestRunner& runner);
+void TestIndexFile(TestRunner& runner);
+void TestSnapshotSearchServer(TestRunner& runner);
+void TestSetOperations(TestRunner& runner);
+void TestSegmentedSearchServer(TestRunner& runner);
+void TestTermDictionary(TestRunner& runner);
+void TestReadInput(TestRunner& runner);
+void TestQueryCache(TestRunner& runner);
+void TestRequestQueue(TestRunner& runner);
+#if SEARCH_SERVER_SHARDS
+void TestShardedSearchServer(TestRunner& runner);
+#endif